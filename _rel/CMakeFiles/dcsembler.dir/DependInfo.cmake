@@ -0,0 +1,41 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/Alignment.cpp" "CMakeFiles/dcsembler.dir/src/Alignment.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Alignment.cpp.o.d"
+  "/root/repo/src/Archive.cpp" "CMakeFiles/dcsembler.dir/src/Archive.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Archive.cpp.o.d"
+  "/root/repo/src/Assembler.cpp" "CMakeFiles/dcsembler.dir/src/Assembler.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Assembler.cpp.o.d"
+  "/root/repo/src/Compression.cpp" "CMakeFiles/dcsembler.dir/src/Compression.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Compression.cpp.o.d"
+  "/root/repo/src/Corpus.cpp" "CMakeFiles/dcsembler.dir/src/Corpus.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Corpus.cpp.o.d"
+  "/root/repo/src/DeadCode.cpp" "CMakeFiles/dcsembler.dir/src/DeadCode.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/DeadCode.cpp.o.d"
+  "/root/repo/src/Elf.cpp" "CMakeFiles/dcsembler.dir/src/Elf.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Elf.cpp.o.d"
+  "/root/repo/src/Linker.cpp" "CMakeFiles/dcsembler.dir/src/Linker.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Linker.cpp.o.d"
+  "/root/repo/src/Listing.cpp" "CMakeFiles/dcsembler.dir/src/Listing.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Listing.cpp.o.d"
+  "/root/repo/src/LiteralPool.cpp" "CMakeFiles/dcsembler.dir/src/LiteralPool.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/LiteralPool.cpp.o.d"
+  "/root/repo/src/MappedOutput.cpp" "CMakeFiles/dcsembler.dir/src/MappedOutput.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/MappedOutput.cpp.o.d"
+  "/root/repo/src/MemoryInit.cpp" "CMakeFiles/dcsembler.dir/src/MemoryInit.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/MemoryInit.cpp.o.d"
+  "/root/repo/src/Options.cpp" "CMakeFiles/dcsembler.dir/src/Options.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Options.cpp.o.d"
+  "/root/repo/src/Packing.cpp" "CMakeFiles/dcsembler.dir/src/Packing.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Packing.cpp.o.d"
+  "/root/repo/src/Peephole.cpp" "CMakeFiles/dcsembler.dir/src/Peephole.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Peephole.cpp.o.d"
+  "/root/repo/src/PerfCounters.cpp" "CMakeFiles/dcsembler.dir/src/PerfCounters.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/PerfCounters.cpp.o.d"
+  "/root/repo/src/Profiler.cpp" "CMakeFiles/dcsembler.dir/src/Profiler.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Profiler.cpp.o.d"
+  "/root/repo/src/Relaxation.cpp" "CMakeFiles/dcsembler.dir/src/Relaxation.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Relaxation.cpp.o.d"
+  "/root/repo/src/Scheduler.cpp" "CMakeFiles/dcsembler.dir/src/Scheduler.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Scheduler.cpp.o.d"
+  "/root/repo/src/Simulator.cpp" "CMakeFiles/dcsembler.dir/src/Simulator.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Simulator.cpp.o.d"
+  "/root/repo/src/Stats.cpp" "CMakeFiles/dcsembler.dir/src/Stats.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/Stats.cpp.o.d"
+  "/root/repo/src/SymbolMap.cpp" "CMakeFiles/dcsembler.dir/src/SymbolMap.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/SymbolMap.cpp.o.d"
+  "/root/repo/src/main.cpp" "CMakeFiles/dcsembler.dir/src/main.cpp.o" "gcc" "CMakeFiles/dcsembler.dir/src/main.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,55 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dcsembler.dir/src/Alignment.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Alignment.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Archive.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Archive.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Assembler.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Assembler.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Compression.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Compression.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Corpus.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Corpus.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/DeadCode.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/DeadCode.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Elf.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Elf.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Linker.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Linker.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Listing.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Listing.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/LiteralPool.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/LiteralPool.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/MappedOutput.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/MappedOutput.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/MemoryInit.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/MemoryInit.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Options.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Options.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Packing.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Packing.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Peephole.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Peephole.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/PerfCounters.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/PerfCounters.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Profiler.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Profiler.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Relaxation.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Relaxation.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Scheduler.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Scheduler.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Simulator.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Simulator.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/Stats.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/Stats.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/SymbolMap.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/SymbolMap.cpp.o.d"
+  "CMakeFiles/dcsembler.dir/src/main.cpp.o"
+  "CMakeFiles/dcsembler.dir/src/main.cpp.o.d"
+  "dcsembler"
+  "dcsembler.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dcsembler.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dcs-ar.dir/dcs-ar.cpp.o"
+  "CMakeFiles/dcs-ar.dir/dcs-ar.cpp.o.d"
+  "dcs-ar"
+  "dcs-ar.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dcs-ar.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
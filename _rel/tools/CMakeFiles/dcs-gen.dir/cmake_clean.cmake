@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dcs-gen.dir/dcs-gen.cpp.o"
+  "CMakeFiles/dcs-gen.dir/dcs-gen.cpp.o.d"
+  "dcs-gen"
+  "dcs-gen.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dcs-gen.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
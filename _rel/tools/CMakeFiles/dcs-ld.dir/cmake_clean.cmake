@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dcs-ld.dir/dcs-ld.cpp.o"
+  "CMakeFiles/dcs-ld.dir/dcs-ld.cpp.o.d"
+  "dcs-ld"
+  "dcs-ld.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dcs-ld.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
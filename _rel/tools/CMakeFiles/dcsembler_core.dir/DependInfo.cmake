@@ -0,0 +1,40 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/Alignment.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Alignment.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Alignment.cpp.o.d"
+  "/root/repo/src/Archive.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Archive.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Archive.cpp.o.d"
+  "/root/repo/src/Assembler.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Assembler.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Assembler.cpp.o.d"
+  "/root/repo/src/Compression.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Compression.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Compression.cpp.o.d"
+  "/root/repo/src/Corpus.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Corpus.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Corpus.cpp.o.d"
+  "/root/repo/src/DeadCode.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/DeadCode.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/DeadCode.cpp.o.d"
+  "/root/repo/src/Elf.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Elf.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Elf.cpp.o.d"
+  "/root/repo/src/Linker.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Linker.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Linker.cpp.o.d"
+  "/root/repo/src/Listing.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Listing.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Listing.cpp.o.d"
+  "/root/repo/src/LiteralPool.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/LiteralPool.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/LiteralPool.cpp.o.d"
+  "/root/repo/src/MappedOutput.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/MappedOutput.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/MappedOutput.cpp.o.d"
+  "/root/repo/src/MemoryInit.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/MemoryInit.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/MemoryInit.cpp.o.d"
+  "/root/repo/src/Options.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Options.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Options.cpp.o.d"
+  "/root/repo/src/Packing.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Packing.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Packing.cpp.o.d"
+  "/root/repo/src/Peephole.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Peephole.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Peephole.cpp.o.d"
+  "/root/repo/src/PerfCounters.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/PerfCounters.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/PerfCounters.cpp.o.d"
+  "/root/repo/src/Profiler.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Profiler.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Profiler.cpp.o.d"
+  "/root/repo/src/Relaxation.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Relaxation.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Relaxation.cpp.o.d"
+  "/root/repo/src/Scheduler.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Scheduler.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Scheduler.cpp.o.d"
+  "/root/repo/src/Simulator.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Simulator.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Simulator.cpp.o.d"
+  "/root/repo/src/Stats.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/Stats.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/Stats.cpp.o.d"
+  "/root/repo/src/SymbolMap.cpp" "tools/CMakeFiles/dcsembler_core.dir/__/src/SymbolMap.cpp.o" "gcc" "tools/CMakeFiles/dcsembler_core.dir/__/src/SymbolMap.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,51 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dcsembler_core.dir/__/src/Alignment.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Alignment.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Archive.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Archive.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Assembler.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Assembler.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Compression.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Compression.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Corpus.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Corpus.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/DeadCode.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/DeadCode.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Elf.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Elf.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Linker.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Linker.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Listing.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Listing.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/LiteralPool.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/LiteralPool.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/MappedOutput.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/MappedOutput.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/MemoryInit.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/MemoryInit.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Options.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Options.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Packing.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Packing.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Peephole.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Peephole.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/PerfCounters.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/PerfCounters.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Profiler.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Profiler.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Relaxation.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Relaxation.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Scheduler.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Scheduler.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Simulator.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Simulator.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/Stats.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/Stats.cpp.o.d"
+  "CMakeFiles/dcsembler_core.dir/__/src/SymbolMap.cpp.o"
+  "CMakeFiles/dcsembler_core.dir/__/src/SymbolMap.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dcsembler_core.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
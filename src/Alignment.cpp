@@ -0,0 +1,105 @@
+#include "Alignment.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Assembler.hpp"
+#include "Relaxation.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+vector<AlignmentSite> alignmentSites{};
+
+namespace {
+
+/// addi x0, x0, 0
+constexpr uint32_t nop = 0x00000013;
+
+auto byLine(const AlignmentSite& site, int lineNumber) -> bool {
+    return site.lineNumber < lineNumber;
+}
+
+}
+
+auto alignmentDirective(char* const tokens[], size_t tokenCount, int lineNumber) -> optional<uint32_t> {
+    if (tokenCount == 0 or tokens[0][0] != '.') return {};
+
+    const bool powerOfTwo = strcmp(tokens[0], ".align") == 0 or strcmp(tokens[0], ".p2align") == 0;
+    if (not powerOfTwo and strcmp(tokens[0], ".balign") != 0) return {};
+
+    if (tokenCount < 2) {
+        printf(RED "Error:" RESET " '" YELLOW "%s" RESET "' on line %i needs an alignment.\n", tokens[0], lineNumber);
+        exit(EXIT_FAILURE);
+    }
+
+    const long long asked = strtoll(tokens[1], nullptr, 0);
+    const long long bytes = powerOfTwo ? (asked >= 0 and asked < 32 ? 1ll << asked : -1) : asked;
+    if (bytes <= 0 or (bytes & (bytes - 1)) != 0 or bytes > (long long) maxAlignment) {
+        printf(RED "Error:" RESET " Can't align to '" YELLOW "%s" RESET "' on line %i - it has to come to a power of"
+               " two, up to %u bytes.\n", tokens[1], lineNumber, maxAlignment);
+        exit(EXIT_FAILURE);
+    }
+    return (uint32_t) bytes;
+}
+
+auto noteAlignment(char* const tokens[], size_t tokenCount, int lineNumber) -> void {
+    // Under a word, every instruction is aligned already.
+    const auto alignment = alignmentDirective(tokens, tokenCount, lineNumber);
+    if (alignment and *alignment >= 4) alignmentSites.push_back({instructionIndex, lineNumber, *alignment});
+}
+
+auto alignLoopHeads(uint32_t alignment) -> int {
+    vector<AlignmentSite> heads{};
+    for (const auto& site : relaxableSites) {
+        if (site.kind != RelaxableSite::Kind::branch) continue;
+        const Label* label = labels.lookup(site.target);
+        if (label and label->instructionIndex <= site.instructionIndex) {
+            heads.push_back({label->instructionIndex, label->declaredOnLine, alignment});
+        }
+    }
+    sort(heads.begin(), heads.end(), [](const auto& a, const auto& b) { return a.lineNumber < b.lineNumber; });
+    heads.erase(unique(heads.begin(), heads.end(), [](const auto& a, const auto& b) { return a.lineNumber == b.lineNumber; }),
+                heads.end());
+    const int count = (int) heads.size();
+
+    // One site per line, so the emit pass can find it - the bigger alignment wins, and does for both.
+    vector<AlignmentSite> merged{};
+    merged.reserve(alignmentSites.size() + heads.size());
+    merge(alignmentSites.begin(), alignmentSites.end(), heads.begin(), heads.end(), back_inserter(merged),
+          [](const auto& a, const auto& b) { return a.lineNumber < b.lineNumber; });
+    size_t kept = 0;
+    for (const auto& site : merged) {
+        if (kept > 0 and merged[kept - 1].lineNumber == site.lineNumber) {
+            merged[kept - 1].alignment = max(merged[kept - 1].alignment, site.alignment);
+        } else {
+            merged[kept++] = site;
+        }
+    }
+    merged.resize(kept);
+    alignmentSites = move(merged);
+
+    return count;
+}
+
+auto alignmentOn(int lineNumber) -> const AlignmentSite* {
+    const auto site = lower_bound(alignmentSites.begin(), alignmentSites.end(), lineNumber, byLine);
+    return site != alignmentSites.end() and site->lineNumber == lineNumber ? &*site : nullptr;
+}
+
+auto emitAlignment(int lineNumber) -> void {
+    if (const AlignmentSite* site = alignmentOn(lineNumber)) {
+        for (int i = 0; i < site->padding; i++) emitInstruction(nop);
+    }
+}
+
+auto largestAlignment() -> uint32_t {
+    uint32_t largest = 4;
+    for (const auto& site : alignmentSites) largest = max(largest, site.alignment);
+    return largest;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Somewhere the program is padded out with nops to a boundary - an `.align`, `.p2align` or
+/// `.balign`, or (with --alignLoops) a label a branch goes back to.
+///
+/// Anything on the instruction the padding comes before - labels included, even ones declared
+/// before the directive - ends up after it. For anything that jumps there, that's where it was
+/// going anyway.
+struct AlignmentSite {
+    /// As the label pass counted it. Once relaxSites has laid the program out, where the padding
+    /// starts in it (and -O keeps that up to date).
+    int instructionIndex = 0;
+    /// The line the padding is emitted on - the directive's, or the label's.
+    int lineNumber = 0;
+    /// In bytes - a power of two.
+    uint32_t alignment = 4;
+    /// How many nops, once relaxSites has laid the program out.
+    int padding = 0;
+};
+
+/// Every alignment site, in line order (and so instruction order) - filled in by the label pass
+/// and alignLoopHeads, laid out by relaxSites, and read by the emit pass, on any thread.
+extern vector<AlignmentSite> alignmentSites;
+
+/// The most anything can be aligned to, in bytes.
+inline constexpr uint32_t maxAlignment = 4096;
+
+/// How many bytes it takes to get from `offset` to the next multiple of `alignment` (a power of two).
+inline auto paddingFor(uint32_t offset, uint32_t alignment) -> uint32_t {
+    return (0u - offset) & (alignment - 1);
+}
+
+/// What an alignment directive (`.align n` and `.p2align n` are to 2^n bytes, `.balign n` to n)
+/// asks for, in bytes - or nothing, if these tokens aren't one. Anything after the alignment (a
+/// fill, a limit) is ignored: padding is always nops. Exits with an error for an alignment that
+/// isn't a power of two, or is over maxAlignment.
+auto alignmentDirective(char* const tokens[], size_t tokenCount, int lineNumber) -> optional<uint32_t>;
+
+/// For the label pass: records the site, if these tokens are an alignment directive.
+auto noteAlignment(char* const tokens[], size_t tokenCount, int lineNumber) -> void;
+
+/// Adds a site, aligned to `alignment` bytes, for every label a conditional branch goes back to -
+/// the head of a loop, which is fetched again every time round. Goes between the label pass and
+/// relaxSites. Returns how many labels that was.
+auto alignLoopHeads(uint32_t alignment) -> int;
+
+/// The site padded out on `lineNumber` - nullptr if there isn't one.
+auto alignmentOn(int lineNumber) -> const AlignmentSite*;
+
+/// For the emit pass: the nops for the site on `lineNumber`, if there is one.
+auto emitAlignment(int lineNumber) -> void;
+
+/// The most any site asks for - and so what the start of the program has to be aligned to for them
+/// all to hold. 4 without any.
+auto largestAlignment() -> uint32_t;
+
+}
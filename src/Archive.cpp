@@ -0,0 +1,246 @@
+#include "Archive.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <set>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+// The tables are read and written as they sit in memory.
+static_assert(endian::native == endian::little, "Archives assume a little-endian host");
+
+namespace {
+
+auto alignUp(size_t n, size_t alignment) -> size_t {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+auto definedGlobals(const ObjectFile& object) -> vector<string_view> {
+    vector<string_view> names{};
+    for (const auto& symbol : object.symbols) {
+        if (ELF32_ST_BIND(symbol.st_info) == STB_GLOBAL and symbol.st_shndx != SHN_UNDEF) {
+            names.push_back(object.symbolName(symbol));
+        }
+    }
+    return names;
+}
+
+}
+
+auto buildArchive(const vector<ArchiveMember>& members, vector<uint8_t>& archive) -> bool {
+    vector<ObjectFile> objects(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        objects[i].path = members[i].name;
+        objects[i].contents = members[i].contents;
+        if (not parseObjectFile(objects[i])) return false;
+    }
+
+    struct Symbol {
+        string_view name;
+        uint32_t member;
+    };
+    vector<Symbol> index{};
+    for (size_t i = 0; i < objects.size(); i++) {
+        for (auto name : definedGlobals(objects[i])) index.push_back({name, (uint32_t) i});
+    }
+    sort(index.begin(), index.end(), [](const Symbol& a, const Symbol& b) { return a.name < b.name; });
+
+    for (size_t i = 1; i < index.size(); i++) {
+        if (index[i].name == index[i - 1].name) {
+            fprintf(stderr, RED "Error:" RESET " '" YELLOW "%.*s" RESET "' is defined in both '%s' and '%s'.\n",
+                    (int) index[i].name.size(), index[i].name.data(),
+                    members[index[i - 1].member].name.c_str(), members[index[i].member].name.c_str());
+            return false;
+        }
+    }
+
+    string strings{};
+    auto addString = [&](string_view s) {
+        const auto offset = (uint32_t) strings.size();
+        strings.append(s);
+        strings.push_back('\0');
+        return offset;
+    };
+
+    vector<ArchiveMemberEntry> memberEntries(members.size());
+    for (size_t i = 0; i < members.size(); i++) memberEntries[i].name = addString(members[i].name);
+
+    vector<ArchiveSymbolEntry> symbolEntries(index.size());
+    for (size_t i = 0; i < index.size(); i++) symbolEntries[i] = {addString(index[i].name), index[i].member};
+
+    const size_t tablesSize = sizeof(ArchiveHeader) + memberEntries.size() * sizeof(ArchiveMemberEntry)
+                            + symbolEntries.size() * sizeof(ArchiveSymbolEntry) + strings.size();
+    size_t cursor = alignUp(tablesSize, 4);
+    for (size_t i = 0; i < members.size(); i++) {
+        memberEntries[i].offset = (uint32_t) cursor;
+        memberEntries[i].size = (uint32_t) members[i].contents.size();
+        cursor = alignUp(cursor + members[i].contents.size(), 4);
+    }
+
+    archive.assign(cursor, 0);
+
+    ArchiveHeader header{};
+    memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+    header.version = archiveVersion;
+    header.memberCount = (uint32_t) memberEntries.size();
+    header.symbolCount = (uint32_t) symbolEntries.size();
+    header.stringTableSize = (uint32_t) strings.size();
+
+    uint8_t* p = archive.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    if (not memberEntries.empty()) memcpy(p, memberEntries.data(), memberEntries.size() * sizeof(ArchiveMemberEntry));
+    p += memberEntries.size() * sizeof(ArchiveMemberEntry);
+    if (not symbolEntries.empty()) memcpy(p, symbolEntries.data(), symbolEntries.size() * sizeof(ArchiveSymbolEntry));
+    p += symbolEntries.size() * sizeof(ArchiveSymbolEntry);
+    memcpy(p, strings.data(), strings.size());
+
+    for (size_t i = 0; i < members.size(); i++) {
+        memcpy(archive.data() + memberEntries[i].offset, members[i].contents.data(), members[i].contents.size());
+    }
+
+    return true;
+}
+
+auto isArchive(string_view contents) -> bool {
+    return contents.size() >= sizeof(archiveMagic) and memcmp(contents.data(), archiveMagic, sizeof(archiveMagic)) == 0;
+}
+
+Archive::~Archive() {
+    if (mapped) munmap((void*) data, size);
+}
+
+auto Archive::open(const string& filePath) -> bool {
+    path = filePath;
+
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+    struct stat status{};
+    if (fd < 0 or fstat(fd, &status) != 0 or status.st_size == 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, RED "Error:" RESET " '%s' couldn't be read.\n", filePath.c_str());
+        return false;
+    }
+
+    void* p = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, RED "Error:" RESET " '%s' couldn't be mapped in.\n", filePath.c_str());
+        return false;
+    }
+    mapped = true;
+
+    return openFrom(string_view{(const char*) p, (size_t) status.st_size}, filePath);
+}
+
+auto Archive::openFrom(string_view contents, const string& filePath) -> bool {
+    path = filePath;
+    data = (const uint8_t*) contents.data();
+    size = contents.size();
+
+    auto broken = [&](const char* why) {
+        fprintf(stderr, RED "Error:" RESET " '%s' %s.\n", path.c_str(), why);
+        return false;
+    };
+
+    if (size < sizeof(ArchiveHeader) or not isArchive(contents)) return broken("isn't a dcs-ar archive");
+    if (header().version != archiveVersion) return broken("is from a different version of dcs-ar");
+
+    const size_t tablesSize = sizeof(ArchiveHeader) + (size_t) header().memberCount * sizeof(ArchiveMemberEntry)
+                            + (size_t) header().symbolCount * sizeof(ArchiveSymbolEntry) + header().stringTableSize;
+    if (tablesSize > size or (header().stringTableSize and strings()[header().stringTableSize - 1] != '\0')) {
+        return broken("has a broken index");
+    }
+    for (size_t i = 0; i < header().memberCount; i++) {
+        const auto& m = members()[i];
+        if (m.name >= header().stringTableSize or (size_t) m.offset + m.size > size) return broken("has a broken member table");
+    }
+    for (size_t i = 0; i < header().symbolCount; i++) {
+        const auto& s = symbols()[i];
+        if (s.name >= header().stringTableSize or s.member >= header().memberCount) return broken("has a broken symbol index");
+    }
+
+    return true;
+}
+
+auto Archive::memberName(size_t member) const -> string_view {
+    return strings() + members()[member].name;
+}
+
+auto Archive::symbolName(size_t symbol) const -> string_view {
+    return strings() + symbols()[symbol].name;
+}
+
+auto Archive::symbolMember(size_t symbol) const -> uint32_t {
+    return symbols()[symbol].member;
+}
+
+auto Archive::find(string_view symbol) const -> optional<uint32_t> {
+    const auto* begin = symbols();
+    const auto* end = begin + header().symbolCount;
+    const auto* it = lower_bound(begin, end, symbol, [&](const ArchiveSymbolEntry& entry, string_view name) {
+        return string_view{strings() + entry.name} < name;
+    });
+    if (it == end or string_view{strings() + it->name} != symbol) return {};
+    return it->member;
+}
+
+auto Archive::extract(size_t member, ObjectFile& object) const -> bool {
+    const auto& entry = members()[member];
+    object.path = path + "(" + string{memberName(member)} + ")";
+    object.contents.assign((const char*) data + entry.offset, entry.size);
+    return parseObjectFile(object);
+}
+
+auto pullArchiveMembers(vector<ObjectFile>& objects, const vector<unique_ptr<Archive>>& archives) -> bool {
+    // Names are copied, as pulling members in moves the objects (and the names in them) about.
+    unordered_set<string> defined{};
+    set<string> undefined{};
+
+    auto take = [&](const ObjectFile& object) {
+        for (auto name : definedGlobals(object)) {
+            defined.emplace(name);
+            undefined.erase(string{name});
+        }
+        for (const auto& symbol : object.symbols) {
+            if (ELF32_ST_BIND(symbol.st_info) == STB_GLOBAL and symbol.st_shndx == SHN_UNDEF) {
+                string name{object.symbolName(symbol)};
+                if (not defined.contains(name)) undefined.insert(move(name));
+            }
+        }
+    };
+    for (const auto& object : objects) take(object);
+
+    vector<vector<bool>> pulled{};
+    for (const auto& archive : archives) pulled.emplace_back(archive->memberCount(), false);
+
+    // Each round pulls in whatever defines the first symbol still missing, if anything does.
+    while (not undefined.empty()) {
+        const string name = *undefined.begin();
+        undefined.erase(undefined.begin());
+
+        for (size_t a = 0; a < archives.size(); a++) {
+            const auto member = archives[a]->find(name);
+            if (not member or pulled[a][*member]) continue;
+
+            pulled[a][*member] = true;
+            ObjectFile object{};
+            if (not archives[a]->extract(*member, object)) return false;
+            objects.push_back(move(object));
+            take(objects.back());
+            break;
+        }
+    }
+
+    return true;
+}
+
+}
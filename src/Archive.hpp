@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Linker.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// dcs-ar's archive format. Everything is little-endian, and laid out as
+///
+///     ArchiveHeader
+///     ArchiveMemberEntry[memberCount]
+///     ArchiveSymbolEntry[symbolCount]   sorted by name, bytewise
+///     string table                      member and symbol names, each NUL terminated
+///     member bodies                     each 4 byte aligned
+///
+/// so a linker can find which member defines a symbol with a binary search over the index, without
+/// reading any member it doesn't need.
+inline constexpr char archiveMagic[8] = {'!', '<', 'd', 'c', 's', 'a', 'r', '>'};
+
+struct ArchiveHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t memberCount;
+    uint32_t symbolCount;
+    uint32_t stringTableSize;
+};
+
+struct ArchiveMemberEntry {
+    uint32_t name;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+struct ArchiveSymbolEntry {
+    uint32_t name;
+    uint32_t member;
+};
+
+inline constexpr uint32_t archiveVersion = 1;
+
+/// An object to go in an archive.
+struct ArchiveMember {
+    string name{};
+    string contents{};
+};
+
+/// Indexes every global symbol the members define. Prints the problem and returns false if a member
+/// isn't an object, or two define the same symbol.
+auto buildArchive(const vector<ArchiveMember>& members, vector<uint8_t>& archive) -> bool;
+
+/// Whether the file starts like one of our archives.
+auto isArchive(string_view contents) -> bool;
+
+/// An archive, mapped in read only.
+class Archive {
+public:
+    Archive() = default;
+    ~Archive();
+
+    Archive(const Archive&) = delete;
+    auto operator=(const Archive&) -> Archive& = delete;
+
+    /// Maps the archive in and checks its header. Prints the problem and returns false if it can't.
+    auto open(const string& path) -> bool;
+    /// The same, for an archive already in memory - which must outlive this.
+    auto openFrom(string_view contents, const string& path) -> bool;
+
+    [[nodiscard]]
+    auto memberCount() const -> size_t { return header().memberCount; }
+    [[nodiscard]]
+    auto symbolCount() const -> size_t { return header().symbolCount; }
+    [[nodiscard]]
+    auto memberName(size_t member) const -> string_view;
+    [[nodiscard]]
+    auto symbolName(size_t symbol) const -> string_view;
+    [[nodiscard]]
+    auto symbolMember(size_t symbol) const -> uint32_t;
+
+    /// Which member defines `symbol` - one binary search of the index.
+    [[nodiscard]]
+    auto find(string_view symbol) const -> optional<uint32_t>;
+
+    /// Copies a member out as an object file, named `archive(member)`.
+    auto extract(size_t member, ObjectFile& object) const -> bool;
+
+    string path{};
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+
+    [[nodiscard]]
+    auto header() const -> const ArchiveHeader& { return *(const ArchiveHeader*) data; }
+    [[nodiscard]]
+    auto members() const -> const ArchiveMemberEntry* { return (const ArchiveMemberEntry*) (data + sizeof(ArchiveHeader)); }
+    [[nodiscard]]
+    auto symbols() const -> const ArchiveSymbolEntry* { return (const ArchiveSymbolEntry*) (members() + header().memberCount); }
+    [[nodiscard]]
+    auto strings() const -> const char* { return (const char*) (symbols() + header().symbolCount); }
+};
+
+/// Pulls in the archive members that define whatever the objects (and the members pulled in before
+/// them) use but don't define, until nothing more can be found - appending them to `objects`.
+/// Anything still undefined after is left for link() to report.
+auto pullArchiveMembers(vector<ObjectFile>& objects, const vector<unique_ptr<Archive>>& archives) -> bool;
+
+}
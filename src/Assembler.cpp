@@ -0,0 +1,1251 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#include <fstream>
+#include <filesystem>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <type_traits>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "BlockWriter.hpp"
+#include "LiteralPool.hpp"
+#include "Packing.hpp"
+#include "Relaxation.hpp"
+#include "Stats.hpp"
+#include "SymbolMap.hpp"
+
+#include "colors.h"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+Options opts;
+
+auto instructionOffset(int instructionIndex) -> uint32_t {
+    if (instructionOffsets.empty()) return (uint32_t) instructionIndex * 4;
+    return instructionOffsets[instructionIndex];
+}
+
+auto instructionIndexToAddress(int instructionIndex) -> int {
+    return (int) instructionOffset(instructionIndex) + *opts.startOfMemory;
+}
+
+auto LabelSet::prettyPrint() -> void {
+    cout << "Labels and their values:\n";
+    // In address order, rather than whatever order they hash into.
+    for (const auto& symbol : sortedSymbols(*this, 0)) {
+        const auto& [ instructionIndex, lineNumberDeclared ] = *lookup(symbol.name);
+
+        const auto instructionAddress = instructionIndexToAddress(instructionIndex);
+        printf("Label " GREENC("%.*s")
+                        " -> "
+                        YELLOWC("instruction no. %i (0x%x)")
+                        "/"
+                        MAGENTAC("address %i (0x%x)")
+                        "/"
+                        CYANC("line %i") "\n",
+            (int) symbol.name.size(), symbol.name.data(),
+            instructionIndex, instructionIndex,
+            instructionAddress, instructionAddress,
+            lineNumberDeclared);
+    }
+}
+
+FILE* out = nullptr;
+uint8_t* mappedOut = nullptr;
+thread_local int instructionIndex = 0;
+LabelSet labels{};
+SymbolNames globalSymbols{};
+Image image{};
+vector<uint32_t> instructionOffsets{};
+
+namespace {
+
+mutex relocationsLock{};
+
+/// Byte offset of the instruction being emitted.
+auto instructionAddressInImage() -> uint32_t {
+    return (uint32_t) instructionIndex * 4;
+}
+
+auto recordRelocation(Relocation relocation) -> void {
+    lock_guard lock{relocationsLock};
+    image.relocations.push_back(move(relocation));
+}
+
+/// Keeps hold of a conditional branch, `call` or `tail` to a label for relaxSites, which might need
+/// to make it longer.
+auto noteRelaxable(char* const tokens[], size_t tokenCount, int lineNumber) -> void {
+    if (tokenCount == 2 and isSymbolReference(tokens[1])
+        and (strcasecmp(tokens[0], "call") == 0 or strcasecmp(tokens[0], "tail") == 0)) {
+        relaxableSites.push_back({instructionIndex, lineNumber, tokens[1], RelaxableSite::Kind::call});
+        return;
+    }
+
+    if (tokenCount < 4 or tolower((unsigned char) tokens[0][0]) != 'b' or not isSymbolReference(tokens[3])) return;
+
+    for (const char* branch : {"beq", "bne", "blt", "bge", "bltu", "bgeu"}) {
+        if (strcasecmp(tokens[0], branch) == 0) {
+            relaxableSites.push_back({instructionIndex, lineNumber, tokens[3], RelaxableSite::Kind::branch});
+            return;
+        }
+    }
+}
+
+}
+
+auto immediateTo2ByteSignedOffset(int immediateAddressOfByte, int currentInstructionIndex) -> int {
+    return (immediateAddressOfByte - instructionIndexToAddress(currentInstructionIndex)) / 2;
+}
+
+auto labelTo2ByteSignedOffset(Label l, int currentInstructionIndex) -> int {
+    /// in number of bytes
+    const int labelAddress = instructionIndexToAddress(l.instructionIndex);
+    /// in number of bytes
+    const int currentAddress = instructionIndexToAddress(currentInstructionIndex);
+    return (labelAddress - currentAddress) / 2;
+}
+
+auto isComment(char* first_token) -> bool {
+    return first_token[0] == '#';
+}
+
+auto isSymbolReference(const char* token) -> bool {
+    return isalpha((unsigned char) token[0]) or token[0] == '_' or token[0] == '.' or token[0] == '$';
+}
+
+auto isLabel(char* first_token) -> bool {
+    auto len = strlen(first_token);
+    if (len == 0) {
+        return false;
+    } else {
+        return first_token[len - 1] == ':';
+    }
+}
+
+#include <cctype>
+
+auto toLower(char* s) -> char* {
+    for (char* c = s; *c != '\0'; c++) {
+        if (not islower(*c)) *c = tolower(*c);
+    }
+    return s;
+}
+
+auto regToNum(char* token) -> int {
+    // Registers are denoted as x1, x2, ..., x30, x31, x32.
+    // So just do...
+    return atoi(token + 1);
+}
+
+auto doIFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3,
+                          int setImm_5_11To) -> unsigned int {
+        // auto target = 0x00310093;
+        //    e.g. target = addi x1 x2 3
+        //                                      funct3      OP-IMM
+        //                 |---- imm ----| |-x1-||-| |-x2-||-opco-|
+        //                  0000 0000 0011 0001 0000 0000 0101 0011
+        unsigned int instruction = 0x00000000;
+
+        unsigned int immediate = atoi(tokens[3]);
+
+        if (setImm_5_11To != -1) {
+            unsigned int immediate_0_4 = (immediate & 0b11111);
+            immediate = (setImm_5_11To << 5) | (immediate_0_4);
+        }
+
+        // imm[11:0] goes to [31:20]
+        instruction = immediate; // immediate is most significant bits.
+
+        // rs1 goes to [19:15]
+        const auto rs1 = regToNum(tokens[2]); // TODO This order might be wrong.
+        instruction = (instruction << 5) | rs1;
+
+        // funct3 goes to [14:12]
+        instruction = (instruction << 3) | funct3;
+
+        // rd goes to [11:7]
+        const auto rd = regToNum(tokens[1]);
+        instruction = (instruction << 5) | rd;
+
+        // opcode goes to [6:0]
+        instruction = (instruction << 7) | opcode; // opcode is least significant bits.
+
+        return instruction;
+}
+
+auto doRFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3, int funct7) -> unsigned int {
+        // Format: R-type.
+        //         target = 0x003150b3;
+        //    e.g. target = srl x1 x2 x3
+        //                              R-type format
+        //                                      funct3
+        //                  |funct7||-rs2| |-rs1||-| |-rd-||-opco-|
+        //                  0000 0000 0011 0001 0101 0000 1011 0111
+
+        unsigned int instruction = 0x00000000;
+
+        // funct7
+        instruction = funct7;
+
+        // rs2
+        const auto rs2 = regToNum(tokens[3]);
+        instruction = (instruction << 5) | rs2;
+
+        // rs1
+        const auto rs1 = regToNum(tokens[2]);
+        instruction = (instruction << 5) | rs1;
+
+        // funct3
+        instruction = (instruction << 3) | funct3;
+
+        // rd
+        const auto rd = regToNum(tokens[1]);
+        instruction = (instruction << 5) | rd;
+
+        // opcode
+        instruction = (instruction << 7) | opcode;
+
+        return instruction;
+}
+
+auto doUFormatInstruction(char* tokens[], int tokenCount,
+                          int lineNumber, int opcode) -> unsigned int {
+    // Format: U-type.
+    // Instruction: lui <rd> <immediate value>
+    //         target = 0x000030b7;
+    //         target = lui x1 3
+    //                              U-type format
+    //                 |-------imm[31:12]------| |-rd-||-opco-|
+    //                  0000 0000 0000 0000 0011 0000 1011 0111
+    //                 <-- constant value -----> <reg-><-LUI-->
+    unsigned int immediate = atoi(tokens[2]);
+
+    unsigned int instruction = 0x00000000;
+
+    // imm goes to [31:12]
+    instruction = immediate; // immediate is most significant bits.
+
+    // rd goes to [11:7]
+    const auto rd = regToNum(tokens[1]);
+    instruction = (instruction << 5) | rd;
+
+    // opcode goes to [6:0]
+    instruction = (instruction << 7) | opcode; // opcode is least significant bits.
+
+    return instruction;
+}
+
+auto doSFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3) -> unsigned int {
+        // Format: S-type
+        //         target = SW x1, 3(x2)
+        // for us, target = SW x1 3 x2
+        //                              S-type format
+        //                          source  base    offset[4:0]
+        //                 offset[11:5]         funct3      opcode
+        //                  |offset||-rs2| |-rs1||-| |----||------|
+        //                  0000 0000 0001 0001 0010 0001 1010 0011
+
+        const int immediate_offset = atoi(tokens[2]);
+
+        if (abs(immediate_offset) > 0b111111111111) {
+            // TODO Error
+            cerr << "Error: S format instruction offset too big!\n";
+            exit(EXIT_FAILURE);
+        }
+
+        unsigned int instruction = 0x00000000;
+
+        const unsigned int offset_11_5 = (immediate_offset & (0b111111100000)) >> 5;
+        instruction = offset_11_5;
+
+        // Source register
+        const auto dataSourceRegister_rs2 = regToNum(tokens[1]);
+        instruction = (instruction << 5) | dataSourceRegister_rs2;
+
+        // Base register
+        const auto baseRegister_rs1 = regToNum(tokens[3]); // TODO Ordering wrong?
+        instruction = (instruction << 5) | baseRegister_rs1;
+
+        instruction = (instruction << 3) | funct3;
+
+        const unsigned int offset_4_0  = (immediate_offset & (0b000000011111));
+        instruction = (instruction << 5) | offset_4_0;
+
+        instruction = (instruction << 7) | opcode;
+
+        return instruction;
+}
+
+auto doBFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3) -> unsigned int {
+        // Format: B-type
+        char* destination = tokens[3];
+
+        int immediate_offset;
+
+        if (const Label* label = labels.lookup(destination)) {
+            immediate_offset = labelTo2ByteSignedOffset(*label, instructionIndex);
+        } else if (isSymbolReference(destination)) {
+            // Not one of ours - leave the offset at 0 for the linker to fill in.
+            recordRelocation({instructionAddressInImage(), destination, Relocation::Type::branch, lineNumber});
+            immediate_offset = 0;
+        } else {
+            immediate_offset = immediateTo2ByteSignedOffset(atoi(tokens[3]), instructionIndex);
+        }
+
+        const int byteOffset = immediate_offset * 2;
+        // relaxSites gave it two slots, so it fills both - even if it'd reach now, since padding can
+        // shrink once it's relaxed, and everything after it was laid out with both.
+        const bool relaxed = isRelaxed(instructionIndex);
+        if (relaxed) {
+            immediate_offset = 0;
+        } else if (not branchReaches(byteOffset)) {
+            printf(RED "Error:" RESET " The branch to '" YELLOW "%s" RESET "' on line %i is out of reach (+-4 KiB).\n",
+                   destination, lineNumber);
+            exit(EXIT_FAILURE);
+        }
+
+        unsigned int off_12   = (immediate_offset & 0b100000000000) >> (11);
+        unsigned int off_11   = (immediate_offset & 0b010000000000) >> (10);
+        unsigned int off_10_5 = (immediate_offset & 0b001111110000) >> (4);
+        unsigned int off_4_1  = (immediate_offset & 0b000000001111) >> (0);
+
+        // Build the instruction
+        unsigned int instruction = 0;
+        instruction = off_12;
+        instruction = (instruction << 6) | off_10_5;
+        instruction = (instruction << 5) | regToNum(tokens[2]);
+        instruction = (instruction << 5) | regToNum(tokens[1]);
+        instruction = (instruction << 3) | funct3;
+        instruction = (instruction << 4) | off_4_1;
+        instruction = (instruction << 1) | off_11;
+        instruction = (instruction << 7) | opcode;
+
+        if (relaxed) {
+            const auto pair = relaxedBranch(instruction, byteOffset);
+            if (not pair) {
+                printf(RED "Error:" RESET " The branch to '" YELLOW "%s" RESET "' on line %i is out of reach even of a jal (+-1 MiB).\n",
+                       destination, lineNumber);
+                exit(EXIT_FAILURE);
+            }
+            emitInstruction(pair->first);
+            return pair->second;
+        }
+
+        return instruction;
+}
+
+auto hexLine(char* line, uint32_t word) -> void {
+    // The same as fprintf's "0x%08x\n", minus fprintf.
+    static constexpr char hexDigits[] = "0123456789abcdef";
+    line[0] = '0';
+    line[1] = 'x';
+    for (int i = 9; i >= 2; i--, word >>= 4) line[i] = hexDigits[word & 0xf];
+    line[10] = '\n';
+}
+
+auto writeHexLines(FILE* f, const Image& image) -> bool {
+    BlockWriter writer{f};
+    for (size_t at = 0; at < image.size(); at += 4) {
+        hexLine(writer.reserve(hexLineLength), image.wordAt(at));
+        writer.used += hexLineLength;
+    }
+    writer.flush();
+    return writer.ok;
+}
+
+auto storeInstruction(uint8_t* output, int index, uint32_t word) -> void {
+    image.setWordAt((size_t) index * 4, word);
+
+    switch (*opts.format) {
+        case Format::binary:
+        case Format::bin: {
+            // From the image, which is little-endian whatever the host is.
+            const Packing packing = packingFrom(opts);
+            const uint8_t* bytes = image.bytes.data() + (size_t) index * 4;
+            uint8_t* to = output + packedOffsetOf((size_t) index * 4, packing);
+            if (packing.byteOrder == Endianness::big) {
+                for (int b = 0; b < 4; b++) to[b] = bytes[3 - b];
+            } else {
+                memcpy(to, bytes, 4);
+            }
+            break;
+        }
+        case Format::hexadecimal:
+        case Format::hex:
+            hexLine((char*) output + (size_t) index * hexLineLength, word);
+            break;
+        default:
+            break;
+    }
+}
+
+auto emitInstruction(unsigned int it) -> void {
+    if (mappedOut) {
+        storeInstruction(mappedOut, instructionIndex, it);
+        instructionIndex++;
+        return;
+    }
+
+    // Every format is written out whole once the emit pass is done (see writeHexLines, Packing.hpp,
+    // Elf.hpp and MemoryInit.hpp), so the image can still change - see Peephole.hpp.
+    instructionIndex++;
+    image.appendWord(it);
+}
+
+namespace {
+
+/// The M extension's instructions - all R-type, with funct7 = 0x01, told apart by funct3.
+struct MultiplyInstruction {
+    const char* mnemonic;
+    int funct3;
+};
+
+constexpr MultiplyInstruction multiplyInstructions[] = {
+    {"mul", 0b000}, {"mulh", 0b001}, {"mulhsu", 0b010}, {"mulhu", 0b011},
+    {"div", 0b100}, {"divu", 0b101}, {"rem", 0b110}, {"remu", 0b111},
+};
+
+auto multiplyInstruction(const char* mnemonic) -> const MultiplyInstruction* {
+    for (const auto& m : multiplyInstructions) {
+        if (strcmp(m.mnemonic, mnemonic) == 0) return &m;
+    }
+    return nullptr;
+}
+
+}
+
+auto parseInstructionFrom(char* tokens[], int tokenCount, int lineNumber) -> bool {
+    char* opcode = toLower(tokens[0]);
+
+    unsigned int instruction = 0x00000000;
+
+    bool matchedAnInstruction = true;
+
+    if (strlen(opcode) < 1) {
+        // TODO When?
+        cout << "strlen opcode < 1: " << opcode << '\n';
+        return false;
+    }
+
+    if (opcode[0] == '.') {
+        // TODO Test
+        // This is something like the metadata output by gcc.
+        // For example, compiling a simple C program will produce:
+        /*
+            .file	"test.c"
+            .option nopic
+            .attribute arch, "rv32i2p0"
+            .attribute unaligned_access, 0
+            .attribute stack_align, 16
+            .text
+            .align	2
+            .globl	main
+            .type	main, @function
+         */
+        // At the top of the file.
+        // We ignore these, so just return true to suggest that we're happy to continue.
+        // (Alignment directives have already been padded out by handleLine - see Alignment.hpp.)
+        if (lineNumber == literalPool.lineNumber and strcmp(opcode, ".ltorg") == 0) emitLiteralPool();
+        return true;
+    }
+    //region I-type instructions
+    else if (strcmp("addi", opcode) == 0) {
+        // ADDI (Addition Immediate)
+        // Add sign-extended 12-bit imm to register rs1, storing result in rd.
+        // Instruction: addi <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x00;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("xori", opcode) == 0) {
+        // XORI (Exclusive Or Immediate)
+        // Instruction: xori <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x04;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("ori", opcode) == 0) {
+        // ORI (Or Immediate)
+        // Instruction: ori <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x06;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("andi", opcode) == 0) {
+        // ANDI (And Immediate)
+        // Instruction: andi <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x07;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("slli", opcode) == 0) {
+        // SLTI (Shift Left Logical Immediate)
+        // Instruction: slli <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x01;
+        const int setImm_5_11To = 0x00;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, setImm_5_11To);
+    } else if (strcmp("srli", opcode) == 0) {
+        // SLRI (Shift Right Logical Immediate)
+        // Instruction: slri <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x05;
+        const int setImm_5_11To = 0x00;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, setImm_5_11To);
+    } else if (strcmp("srai", opcode) == 0) {
+        // SRAI (Shift Right Arith Immediate)
+        // Instruction: srai <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x05;
+        const int setImm_5_11To = 0x20;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, setImm_5_11To);
+    } else if (strcmp("slti", opcode) == 0) {
+        // SLTI (Set Less Than Immediate)
+        // Instruction: slti <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x02;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("jalr", opcode) == 0) {
+        // JALR (Jump and Link Reg)
+        // Instruction: jalr <rd> <imm> <rs1>
+        char* reorderedTokens[4];
+        reorderedTokens[0] = nullptr;
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+        const int machineOpcode = 0b1100111;
+        const int funct3 = 0x00;
+        // TODO Make a test for this.
+        instruction = doIFormatInstruction(reorderedTokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("ecall", opcode) == 0) {
+        // ECALL (Environment Call)
+        // Instruction: ecall
+        const int machineOpcode = 0b1110011;
+        const int funct3 = 0x00;
+        tokens[3] = (char*)"0";
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("ebreak", opcode) == 0) {
+        // EBREAK (Environment Break)
+        // Instruction: ecall
+        const int machineOpcode = 0b1110011;
+        const int funct3 = 0x00;
+        tokens[3] = (char*)"1";
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("sltiu", opcode) == 0) {
+        // SLTI (Set Less Than Immediate Unsigned)
+        // Instruction: sltiu <rd> <rs1> <imm>
+        const int machineOpcode = 0b0010011;
+        const int funct3 = 0x03;
+        instruction = doIFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("lw", opcode) == 0) {
+        // LW (Load Word).
+        // Load a 32-bit value from memory into rd.
+        // Format: I-type
+        // Instruction: lw <rd> <immediate offset> <register of base address>
+
+        // auto target = 0x00312083;
+        //         target = LW x1, 3(x2)
+        // for us, target = LW x1 3 x2
+        //                              I-type format
+        //                                       width  dest
+        //                                  base funct3 rd
+        //                  |---offset---| |----||-| |----||-opco-|
+        //                  0000 0000 0011 0001 0010 0000 1000 0011
+
+        // TODO Write a test for this
+        array<const char*, 4> reorderedTokens;
+        //char* reorderedTokens[4];
+        reorderedTokens[0] = "0"; // Doesn't matter
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+        const int funct3 = 0b010;
+        const int machineOpcode = 0b0000011;
+
+        instruction = doIFormatInstruction((char**)reorderedTokens.data(), tokenCount, lineNumber,
+                                           machineOpcode, funct3);
+    } else if (strcmp("lh", opcode) == 0) {
+        // LH (Load Half).
+        // Load a 16-bit value from memory into rd.
+        // Format: I-type
+        // Instruction: lh <rd> <immediate offset> <register of base address>
+
+        char* reorderedTokens[4];
+        reorderedTokens[0] = nullptr;
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+
+        const int funct3 = 0b001;
+        const int machineOpcode = 0b0000011;
+
+        instruction = doIFormatInstruction(reorderedTokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3);
+    } else if (strcmp("lb", opcode) == 0) {
+        // LB (Load Byte).
+        // Load a 8-bit value from memory into rd.
+        // Format: I-type
+        // Instruction: lb <rd> <immediate offset> <register of base address>
+
+        char* reorderedTokens[4];
+        reorderedTokens[0] = nullptr;
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+
+        const int funct3 = 0b000;
+        const int machineOpcode = 0b0000011;
+
+        instruction = doIFormatInstruction(reorderedTokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3);
+    } else if (strcmp("lbu", opcode) == 0) {
+        // LB (Load Byte Unsigned).
+        // Load a 8-bit value from memory into rd.
+        // Format: I-type
+        // Instruction: lb <rd> <immediate offset> <register of base address>
+
+        array<char*, 4> reorderedTokens;
+        reorderedTokens[0] = nullptr;
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+
+        const int funct3 = 0b100; // 0x4
+        const int machineOpcode = 0b0000011;
+
+        instruction = doIFormatInstruction(reorderedTokens.data(), tokenCount, lineNumber,
+                                           machineOpcode, funct3);
+    } else if (strcmp("lhu", opcode) == 0) {
+        // LH (Load Half Unsigned).
+        // Load a 16-bit value from memory into rd.
+        // Format: I-type
+        // Instruction: lb <rd> <immediate offset> <register of base address>
+
+        char* reorderedTokens[4];
+        reorderedTokens[0] = nullptr;
+        reorderedTokens[1] = tokens[1]; // rd
+        reorderedTokens[2] = tokens[3]; // rs1
+        reorderedTokens[3] = tokens[2]; // immediate value
+
+        const int funct3 = 0b101; // 0x5
+        const int machineOpcode = 0b0000011;
+
+        instruction = doIFormatInstruction(reorderedTokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3);
+    }
+    //endregion I-type instructions
+
+    //region J-type instructions
+    else if (strcmp("jal", opcode) == 0) {
+        // JAL (Jump And Link)
+        // Jump to the specified location, placing PC+4 into rd.
+        // Format: J-type.
+        // Instruction: jal <rd> <immediate value - address>
+        char* destination = tokens[2];
+
+        //         target = fd5ff0ef
+        //         _start = 0x10054
+        //         target = JAL x1, _start
+        //                              J-type format
+        //                     imm_10_1     imm_19_12
+        //                 imm20  |     imm11  |
+        //                  |     |      |     |
+        //                  ||----------|||--------|
+        //                  |--------imm off-------| |-rd-||-opco-|
+        //         target = 1111 1101 0101 1111 1111 0000 1110 1111
+        int immediate;
+        if (const Label* label = labels.lookup(destination)) {
+            immediate = labelTo2ByteSignedOffset(*label, instructionIndex);
+            //const int labelDestinationInstructionIndex = labels[destinationStr].instructionIndex;
+            //const int difference = (labelDestinationInstructionIndex - instructionIndex) / 2;
+            //immediate = difference;
+        } else if (isSymbolReference(destination)) {
+            recordRelocation({instructionAddressInImage(), destination, Relocation::Type::jal, lineNumber});
+            immediate = 0;
+        } else {
+            // const int immediateDestinationInstructionIndex = atoi(tokens[2]);
+            // const int difference = (immediateDestinationInstructionIndex - instructionIndex) / 2;
+            // immediate = difference;
+
+            // const int immediateDestinationInstructionIndex = atoi(tokens[2]);
+            // //const int difference = (immediateDestinationInstructionIndex - instructionIndex) / 2;
+            // const int difference = (immediateDestinationInstructionIndex / 2 - instructionIndex);
+            // immediate = difference;
+
+            immediate = immediateTo2ByteSignedOffset(atoi(tokens[2]), instructionIndex);
+
+            //const int immediateDestinationInstructionIndex = atoi(tokens[2]);
+            //const int difference = (immediateDestinationInstructionIndex - instructionIndex) / 2;
+            //const int difference = (immediateDestinationInstructionIndex / 2 - instructionIndex);
+            //immediate = immediateDestinationInstructionIndex;
+        }
+
+        // TODO
+        if (immediate > 0b11111111111111111111) {
+            puts("Address jump too big.");
+            exit(EXIT_FAILURE);
+        }
+
+        const unsigned int immediate_20 = (immediate &    0b10000000000000000000);
+        const unsigned int immediate_10_1 = (immediate &  0b00000000001111111111) << 9;
+        const unsigned int immediate_11 = (immediate &    0b00000000010000000000) >> 2;
+        const unsigned int immediate_19_12 = (immediate & 0b01111111100000000000) >> 11;
+
+        // const int immediate_20 = (immediate &    0b10000000000000000000) >> 19;
+        // const int immediate_10_1 = (immediate &  0b00000000001111111111);
+        // const int immediate_11 = (immediate &    0b00000000010000000000) >> 10;
+        // const int immediate_19_12 = (immediate & 0b01111111100000000000) >> 11;
+
+        instruction = immediate_20 | immediate_19_12 | immediate_11 | immediate_10_1;
+
+        // 0xfebff0ef    1111 1110 1011 1111 1111 | 0000 1110 1111
+        // 0xfdbff0ef    1111 1101 1011 1111 1111 | 0000 1110 1111
+        //               1
+
+        // instruction = immediate_20;
+        // instruction = (instruction << 10) | immediate_10_1;
+        // instruction = (instruction << 1) | immediate_11;
+        // instruction = (instruction << 8) | immediate_19_12;
+
+        const auto rd = regToNum(tokens[1]);
+        instruction = (instruction << 5) | rd;
+
+        const int JAL = 0b1101111;
+        instruction = (instruction << 7) | JAL;
+    }
+    //endregion J-type instructions
+
+    //region U-type instructions
+    else if (strcmp("lui", opcode) == 0) {
+        // LUI (Load Upper Immediate).
+        // Load a 32-bit constant to top 20 bits of register rd, filling rest with zeroes.
+        // Format: U-type.
+        // Instruction: lui <rd> <immediate value>
+
+        // auto target = 0x000030b7;
+        //         target = lui x1 3
+        //                              U-type format
+        //                 |-------imm[31:12]------| |-rd-||-opco-|
+        //                  0000 0000 0000 0000 0011 0000 1011 0111
+        //                 <-- constant value -----> <reg-><-LUI-->
+        const int LUI = 0b0110111;
+        unsigned int immediate = atoi(tokens[2]);
+
+        // imm goes to [31:12]
+        instruction = immediate; // immediate is most significant bits.
+
+        // rd goes to [11:7]
+        const auto rd = regToNum(tokens[1]);
+        instruction = (instruction << 5) | rd;
+
+        // opcode goes to [6:0]
+        instruction = (instruction << 7) | LUI; // opcode is least significant bits.
+    } else if (strcmp("auipc", opcode) == 0) {
+        // AUIPC (Add Upper IMM To PC).
+        // Format: U-type.
+        // Instruction: auipc <rd> <immediate value>
+        // Post-condition (C): rd = PC + (imm << 12) && PC updated.
+
+        const int AUIPC = 0b0010111;
+
+        // imm goes to [31:12]
+        unsigned int immediate = atoi(tokens[2]);
+        instruction = immediate; // immediate is most significant bits.
+
+        // rd goes to [11:7]
+        const auto rd = regToNum(tokens[1]);
+        instruction = (instruction << 5) | rd;
+
+        // opcode goes to [6:0]
+        instruction = (instruction << 7) | AUIPC; // opcode is least significant bits.
+    }
+    //endregion U-type instructions
+
+    //region R-type instructions
+    else if (strcmp("add", opcode) == 0) {
+        // ADD.
+        // Format: R-type.
+        // Instruction: add <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0000;
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("sub", opcode) == 0) {
+        // SUB.
+        // Format: R-type.
+        // Instruction: sub <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0x20;
+        const int funct3 = 0b0000;
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("xor", opcode) == 0) {
+        // XOR.
+        // Format: R-type.
+        // Instruction: xor <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0100; // 0x4
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("or", opcode) == 0) {
+        // OR.
+        // Format: R-type.
+        // Instruction: or <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0110; // 0x6
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("and", opcode) == 0) {
+        // AND.
+        // Format: R-type.
+        // Instruction: or <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0111; // 0x7
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("sll", opcode) == 0) {
+        // SLL. (Shift Left Logical)
+        // Logical left shift of the value in rs1 by the amount in the lower 5 bits of rs2, putting
+        // the result in rd.
+        // Format: R-type.
+        // Instruction: or <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0001; // 0x1
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("srl", opcode) == 0) {
+        // SRL (Shift Right Logical).
+        // Logical right shift of the value in rs1 by the amount in the lower 5 bits of rs2, putting
+        // the result in rd.
+        // Format: R-type.
+        // Instruction: srl <rd> <rs1> <rs2>
+
+        // auto target = 0x003150b3; // target = srl x1 x2 x3
+        //                              R-type format
+        //                                      funct3
+        //                  |funct7||-rs2| |-rs1||-| |-rd-||-opco-|
+        //                  0000 0000 0011 0001 0101 0000 1011 0111
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000;
+        const int funct3 = 0b0101;
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("sra", opcode) == 0) {
+        // SRA. (Shift Right Arithmetic)
+        // Format: R-type.
+        // Instruction: SRA <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0100000; // 0x20
+        const int funct3 = 0b0101; // 0x5
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("slt", opcode) == 0) {
+        // SLT. (Set Less Than)
+        // Format: R-type.
+        // Instruction: SLT <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000; // 0x00
+        const int funct3 = 0b0010; // 0x2
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (strcmp("sltu", opcode) == 0) {
+        // SLTU. (Set Less Than)
+        // Format: R-type.
+        // Instruction: SLT <rd> <rs1> <rs2>
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000000; // 0x00
+        const int funct3 = 0b0011; // 0x3
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, funct3, funct7);
+    } else if (const auto* multiply = multiplyInstruction(opcode)) {
+        // MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU (the M extension).
+        // Format: R-type.
+        // Instruction: mul <rd> <rs1> <rs2>
+        if (*opts.isa != Isa::rv32im) {
+            printf(RED "Error:" RESET " '" YELLOW "%s" RESET "' on line %i is in the M extension,"
+                   " which the core only has with --isa rv32im.\n", opcode, lineNumber);
+            exit(EXIT_FAILURE);
+        }
+        const int machineOpcode = 0b0110011;
+        const int funct7 = 0b0000001; // 0x01
+        instruction = doRFormatInstruction(tokens, tokenCount, lineNumber,
+                                           machineOpcode, multiply->funct3, funct7);
+    }
+    //endregion R-type instructions
+
+    //region S-type instructions
+    else if (strcmp("sw", opcode) == 0) {
+        // SW (Store Word).
+        // Store a 32-bit value from the register rs2 to memory.
+        // Format: S-type
+        // Instruction: sw <
+
+        // auto target = 0x001121a3;
+        //         target = SW x1, 3(x2)
+        // for us, target = SW x1 3 x2
+        //                              S-type format
+        //                          source  base    offset[4:0]
+        //                 offset[11:5]         funct3      opcode
+        //                  |offset||-rs2| |-rs1||-| |----||------|
+        //                  0000 0000 0001 0001 0010 0001 1010 0011
+        //         ours:    0000 0000 0001 0000 0
+
+        const int machineOpcode = 0b0100011;
+        const int funct3 = 0b010;
+        instruction = doSFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("sh", opcode) == 0) {
+        // SH (Store Half).
+        // Store a 16-bit value from the register rs2 to memory.
+        // Format: S-type
+        const int machineOpcode = 0b0100011;
+        const int funct3 = 0b001;
+        instruction = doSFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("sb", opcode) == 0) {
+        // SB (Store Byte).
+        // Store a 8-bit value from the register rs2 to memory.
+        // Format: S-type
+        const int machineOpcode = 0b0100011;
+        const int funct3 = 0b000;
+        instruction = doSFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    }
+    //endregion S-type instructions
+
+    //region B-type instructions
+    else if (strcmp("beq", opcode) == 0) {
+        // BEQ (Branch if Equal).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0b000; // 0x00
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("bne", opcode) == 0) {
+        // BNE (Branch Not Equal).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0b001; // 0x01
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("blt", opcode) == 0) {
+        // BLT (Branch Less Than).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0b100; // 0x04
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("bge", opcode) == 0) {
+        // BLT (Branch Greater Than Or Equal to).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0x5;
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("bltu", opcode) == 0) {
+        // BLTU (Branch Less Than Unsigned).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0b110; // 0x06
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    } else if (strcmp("bgeu", opcode) == 0) {
+        // BGEU (Branch Greater Than or Equal To Unsigned).
+        // Format: B-type
+        const int machineOpcode = 0b1100011;
+        const int funct3 = 0b111; // 0x07
+        instruction = doBFormatInstruction(tokens, tokenCount, lineNumber, machineOpcode, funct3);
+    }
+    //endregion B-type instructions
+
+    //region Pseudoinstructions
+    else if (strcmp("mv", opcode) == 0) {
+        // (Pseudoinstruction)
+        // Move the value in rs1 to rd.
+        // Instruction: mv <rd>, <rs1>
+        // Real instruction: addi <rd>, <rs1>, 0
+        tokens[0] = const_cast<char*>("addi");
+        tokens[1] = tokens[1];
+        tokens[2] = tokens[2];
+        tokens[3] = const_cast<char*>("0");
+        return parseInstructionFrom(tokens, 4, lineNumber);
+    } else if (strcmp("jr", opcode) == 0) {
+        // JR pseudoinstruction - jump register
+        // Instruction: jr rs
+        // Real instruction: jalr x0, 0(rs)
+        tokens[0] = const_cast<char*>("jalr");
+        tokens[3] = tokens[1];
+        tokens[1] = const_cast<char*>("x0");
+        tokens[2] = const_cast<char*>("0");
+        return parseInstructionFrom(tokens, 4, lineNumber);
+    } else if (strcmp("nop", opcode) == 0 or strcmp("noop", opcode) == 0) {
+        // nop is just an alias for addi x0, x0, 0
+        tokens[0] = const_cast<char*>("addi");
+        tokens[1] = const_cast<char*>("x0");
+        tokens[2] = const_cast<char*>("x0");
+        tokens[3] = const_cast<char*>("0");
+        return parseInstructionFrom(tokens, 4, lineNumber);
+    } else if (strcmp("ret", opcode) == 0) {
+        // RET pseudoinstruction - return from a call
+        // Instruction: ret
+        // Real instruction: jalr x0, 0(x1)
+        tokens[0] = const_cast<char*>("jalr");
+        tokens[1] = const_cast<char*>("x0");
+        tokens[2] = const_cast<char*>("0");
+        tokens[3] = const_cast<char*>("x1");
+        return parseInstructionFrom(tokens, 4, lineNumber);
+    } else if ((strcmp("call", opcode) == 0 or strcmp("tail", opcode) == 0) and tokenCount == 2) {
+        // CALL / TAIL pseudoinstructions - call a function, or jump to it for good.
+        // Instruction: call <label>, tail <label>
+        // Real instruction, while it reaches (+-1 MiB): jal x1, <label> / jal x0, <label>
+        // Otherwise: auipc x1, <hi> / jalr x1, <lo>(x1)
+        //            auipc x6, <hi> / jalr x0, <lo>(x6)
+        // relaxSites decides which - and the label pass sized it to match.
+        const bool isCall = opcode[0] == 'c';
+        if (isRelaxed(instructionIndex)) {
+            // Only ever calls to our own labels get relaxed.
+            const Label* label = labels.lookup(tokens[1]);
+            const int byteOffset = (label->instructionIndex - instructionIndex) * 4;
+            const auto [ auipc, jalr ] = farJump(isCall ? 1 : 0, isCall ? 1 : 6, byteOffset);
+            emitInstruction(auipc);
+            instruction = jalr;
+        } else {
+            tokens[0] = const_cast<char*>("jal");
+            tokens[2] = tokens[1];
+            tokens[1] = const_cast<char*>(isCall ? "x1" : "x0");
+            return parseInstructionFrom(tokens, 3, lineNumber);
+        }
+    }
+    //endregion Pseudoinstructions
+
+    //region Corner cases
+    else if (strcmp("li", opcode) == 0) {
+        // LI (Load Immediate) pseudoinstruction.
+        // Instruction: li <rd> <32 bit value>
+        // Real instructions, whichever is shortest:
+        //   addi <rd>, x0, <value>                  if it fits in 12 signed bits
+        //   lui <rd>, <upper>                       if its bottom 12 bits are all 0
+        //   lui <rd>, <upper> / addi <rd>, <rd>, <lower>
+        //   lw <rd>, <offset>(x0 or x3)             if it's in the literal pool
+        // The label pass sizes it the same way - see loadImmediateParts and LiteralPool.hpp.
+        const uint32_t value = immediateValue(tokens[2]);
+        const auto [ upper, lower ] = loadImmediateParts(value);
+        const unsigned int rd = regToNum(tokens[1]);
+
+        const unsigned int LUI = 0b0110111;
+        const unsigned int ADDI = 0b0010011;
+        const unsigned int LW = 0b0000011;
+        const unsigned int lui = (upper << 12) | (rd << 7) | LUI;
+        const int slot = upper != 0 and lower != 0 ? literalSlot(value) : -1;
+
+        if (slot >= 0) {
+            const uint32_t offset = literalPool.address + 4 * (uint32_t) slot - literalPool.baseAddress;
+            instruction = ((offset & 0xfff) << 20) | (literalPool.base << 15) | (0b010 << 12) | (rd << 7) | LW;
+        } else if (upper == 0) {
+            instruction = (((unsigned int) lower & 0xfff) << 20) | (rd << 7) | ADDI;
+        } else if (lower == 0) {
+            instruction = lui;
+        } else {
+            emitInstruction(lui);
+            instruction = (((unsigned int) lower & 0xfff) << 20) | (rd << 15) | (rd << 7) | ADDI;
+        }
+    }
+    //endregion Corner cases
+    else {
+        matchedAnInstruction = false;
+    }
+
+    if (matchedAnInstruction) {
+        emitInstruction(instruction);
+        if (*opts.verbose) {
+            printf("%-6s -> 0x%08x \n", opcode, instruction);
+        }
+        return true;
+    } else {
+        return false;
+    }
+}
+
+namespace {
+
+thread_local char* tokenizerPosition = nullptr;
+
+}
+
+auto firstToken(char* line) -> char* {
+    return strtok_r(line, tokenDelimiters, &tokenizerPosition);
+}
+
+auto nextToken() -> char* {
+    return strtok_r(nullptr, tokenDelimiters, &tokenizerPosition);
+}
+
+auto immediateValue(const char* token) -> uint32_t {
+    return (uint32_t) strtoll(token, nullptr, 0);
+}
+
+auto loadImmediateParts(uint32_t value) -> LoadImmediateParts {
+    // addi sign-extends its 12 bits, so when bit 11 is set the lui has to load one more than the
+    // top 20 bits to make up for it - which taking `lower` away first does.
+    const auto lower = (int32_t) (value << 20) >> 20;
+    const uint32_t upper = (value - (uint32_t) lower) >> 12;
+    return {upper, lower};
+}
+
+auto instructionCountFor(char* const tokens[], size_t tokenCount) -> int {
+    if (tokenCount == 0 or isComment(tokens[0]) or tokens[0][0] == '.') return 0;
+    if (strcasecmp(tokens[0], "li") == 0 and tokenCount >= 3) {
+        const uint32_t value = immediateValue(tokens[2]);
+        const auto [ upper, lower ] = loadImmediateParts(value);
+        return upper != 0 and lower != 0 and literalSlot(value) < 0 ? 2 : 1;
+    }
+    return 1;
+}
+
+auto collectTokens(char* nextToken, char* tokens[5]) -> size_t {
+    char* nothing = (char*)"";
+
+    for (int i = 0; i < 5; i++) tokens[i] = nothing;
+    size_t tokenCount = 0;
+
+    while(nextToken != nullptr && tokenCount < 5) {
+        tokens[tokenCount] = nextToken;
+        tokenCount++;
+
+        nextToken = DcsEmbler::nextToken();
+    }
+
+    return tokenCount;
+}
+
+auto handleLine(char* nextToken, int lineNumber) -> void {
+    char* tokens[5];
+    size_t tokenCount = collectTokens(nextToken, tokens);
+
+    if (*opts.verbose) {
+        printf("[%3i]: ", lineNumber);
+    }
+
+    if (tokenCount == 0) {
+        // Nothing on the line.
+        if (*opts.verbose) puts("");
+        return;
+    }
+    // Before anything else on the line - including a label, which goes after the padding.
+    if (not alignmentSites.empty()) emitAlignment(lineNumber);
+    if (isComment(tokens[0])) {
+        if (*opts.verbose) {
+            fputs("Comment line starting with > ", stdout);
+            puts(tokens[0]);
+        }
+
+        return; // Do nothing.
+    } else if (isLabel(tokens[0])) {
+        char* labelName = tokens[0];
+        labelName[strlen(labelName) - 1] = '\0';
+
+        if (tokenCount > 1) {
+            // Print out label info.
+            if (*opts.verbose) {
+                printf("(labelled as " GREENC("%s") " -> " YELLOWC("ins index 0%x") ")",
+                       labelName, instructionIndex);
+            }
+
+            // Remove the label for instruction processing.
+            tokens[0] = tokens[1];
+            tokens[1] = tokens[2];
+            tokens[2] = tokens[3];
+            tokens[3] = tokens[4];
+
+            // And continue along.
+        } else {
+            // It's just a label line.
+            if (*opts.verbose) {
+                printf("Label " GREENC("%s")
+                               " -> "
+                                YELLOWC("ins index 0x%x") "/" CYANC("line %i") "\n",
+                       labelName, instructionIndex, lineNumber);
+            }
+            return;
+        }
+    }
+
+    if (stats.enabled and tokens[0][0] != '.') {
+        stats.countMnemonic(toLower(tokens[0]));
+    }
+
+    // With the literal pool loaded off x3, the first instruction comes after setting x3 up.
+    if (lineNumber == literalPool.setupLine) emitLiteralPoolSetup();
+
+    bool didEmitInstruction = parseInstructionFrom(tokens, tokenCount, lineNumber);
+
+    if (!didEmitInstruction) {
+        printf( RED "Error:"
+                RESET " Failed to match instruction "
+                RESET "'" YELLOW "%s" RESET"'.\n", tokens[0]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+auto huntForLabels(char* nextToken, int lineNumber) -> void {
+    array<char*, 5> tokens;
+    size_t tokenCount = collectTokens(nextToken, tokens.data());
+
+    if (tokenCount == 0) {
+        // Nothing on the line.
+        return;
+    }
+    if (isComment(tokens[0])) {
+        return; // Do nothing.
+    } else if (isLabel(tokens[0])) {
+        char* labelName = tokens[0];
+        labelName[strlen(labelName) - 1] = '\0';
+        labels.insert_or_assign(labelName, Label{instructionIndex, lineNumber});
+
+        if (tokenCount > 1) {
+            noteAlignment(tokens.data() + 1, tokenCount - 1, lineNumber);
+            noteRelaxable(tokens.data() + 1, tokenCount - 1, lineNumber);
+            noteLiteral(tokens.data() + 1, tokenCount - 1, lineNumber);
+            instructionIndex += instructionCountFor(tokens.data() + 1, tokenCount - 1);
+        }
+    } else {
+        if (tokenCount > 1 and (strcmp(tokens[0], ".globl") == 0 or strcmp(tokens[0], ".global") == 0)) {
+            globalSymbols.emplace(tokens[1]);
+        }
+        noteAlignment(tokens.data(), tokenCount, lineNumber);
+        noteRelaxable(tokens.data(), tokenCount, lineNumber);
+        noteLiteral(tokens.data(), tokenCount, lineNumber);
+        instructionIndex += instructionCountFor(tokens.data(), tokenCount);
+    }
+}
+
+} // namespace DCSembler
+
+[[nodiscard]]
+auto readFileToString(const string& filePath) -> string {
+    if (not filesystem::is_regular_file(filePath)) {
+        return {};
+    }
+
+    ifstream f{filePath, ios_base::in | ios_base::binary};
+
+    if (not f.is_open()) {
+        return {};
+    }
+
+    ostringstream ss{};
+    ss << f.rdbuf();
+
+    return ss.str();
+}
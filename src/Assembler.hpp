@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Image.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+struct Label {
+    /// Holds the value of the (zero-based) index of the instruction this is.
+    /// Just counts up for each instruction, starting at 0.
+    int instructionIndex = 0;
+    /// Holds the (one-based) line number this label was found on.
+    int declaredOnLine = 0;
+};
+
+/// Lets labels be looked up straight from a token, without building a string for it first.
+struct LabelHash {
+    using is_transparent = void;
+    auto operator()(string_view name) const -> size_t { return hash<string_view>{}(name); }
+};
+
+struct LabelSet : public unordered_map<string, Label, LabelHash, equal_to<>> {
+    auto prettyPrint() -> void;
+
+    /// nullptr if there's no such label.
+    [[nodiscard]]
+    auto lookup(string_view name) const -> const Label* {
+        auto it = find(name);
+        return it == end() ? nullptr : &it->second;
+    }
+};
+
+/// A set of symbol names, searchable by string_view like LabelSet.
+using SymbolNames = unordered_set<string, LabelHash, equal_to<>>;
+
+extern Options opts;
+
+/// Where the output of the emit pass goes.
+extern FILE* out;
+/// When set, the output file is mapped in here at its final size, and emitInstruction stores each
+/// instruction (and its word in the image, which is sized up front too) at its own place instead -
+/// so lines can be emitted in any order, on any thread. See MappedOutput.hpp.
+extern uint8_t* mappedOut;
+/// The index of the instruction currently being processed, by either pass.
+/// One per thread, as each thread of a parallel emit pass starts from a different place.
+extern thread_local int instructionIndex;
+/// Filled in by the label pass (huntForLabels), read by the emit pass (handleLine).
+extern LabelSet labels;
+/// Names made visible to other objects with `.globl` (or `.global`), gathered by the label pass.
+extern SymbolNames globalSymbols;
+/// Every instruction emitted so far, in memory order.
+extern Image image;
+/// Where each instruction (and the end) starts in the image, in bytes, once --compress has made some
+/// of them 2 bytes long. Empty while every instruction is 4.
+extern vector<uint32_t> instructionOffsets;
+
+/// Where instruction `instructionIndex` starts in the image, in bytes.
+auto instructionOffset(int instructionIndex) -> uint32_t;
+auto instructionIndexToAddress(int instructionIndex) -> int;
+
+auto immediateTo2ByteSignedOffset(int immediateAddressOfByte, int currentInstructionIndex) -> int;
+auto labelTo2ByteSignedOffset(Label l, int currentInstructionIndex) -> int;
+
+auto isComment(char* first_token) -> bool;
+auto isLabel(char* first_token) -> bool;
+/// Whether a branch/jump target looks like a name (rather than a number), defined here or not.
+auto isSymbolReference(const char* token) -> bool;
+auto toLower(char* s) -> char*;
+auto regToNum(char* token) -> int;
+
+auto doIFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3,
+                          int setImm_5_11To = -1) -> unsigned int;
+auto doRFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3, int funct7) -> unsigned int;
+auto doUFormatInstruction(char* tokens[], int tokenCount,
+                          int lineNumber, int opcode) -> unsigned int;
+auto doSFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3) -> unsigned int;
+auto doBFormatInstruction(char* tokens[], int tokenCount, int lineNumber,
+                          int opcode, int funct3) -> unsigned int;
+
+/// What separates tokens on a line - `sw x1, 4(x2)` is `sw`, `x1`, `4` and `x2`.
+inline constexpr const char* tokenDelimiters = " \t,()";
+
+/// strtok_r, keeping its place per thread - the first token on a line, then the rest in turn.
+auto firstToken(char* line) -> char*;
+auto nextToken() -> char*;
+
+/// A number as `li` takes it - decimal, hex (`0x`) or octal (a leading `0`), cut down to 32 bits.
+auto immediateValue(const char* token) -> uint32_t;
+
+/// `li`'s value split into what a `lui` loads and what an `addi` (sign-extended) adds to it.
+struct LoadImmediateParts {
+    /// The top 20 bits, as lui takes them.
+    uint32_t upper = 0;
+    /// -2048 to 2047.
+    int32_t lower = 0;
+};
+auto loadImmediateParts(uint32_t value) -> LoadImmediateParts;
+
+/// How many instructions a line made of these tokens (not counting any label) comes out as - what
+/// the label pass counts, so it must agree with the emit pass. `li` is 1 or 2, depending on its value
+/// (and on whether it's in the literal pool - see LiteralPool.hpp).
+auto instructionCountFor(char* const tokens[], size_t tokenCount) -> int;
+
+/// Gathers up the rest of a line's tokens (via nextToken), given its first.
+/// Unused slots are left as empty strings. Returns how many tokens there were.
+auto collectTokens(char* nextToken, char* tokens[5]) -> size_t;
+
+/// A `0x%08x\n` line of hex output.
+inline constexpr size_t hexLineLength = 11;
+/// Writes `word` as one of those (without a terminating 0) at `line`.
+auto hexLine(char* line, uint32_t word) -> void;
+/// Hex output for the whole image, a line per instruction.
+auto writeHexLines(FILE* f, const Image& image) -> bool;
+
+/// Puts instruction number `index` at its place in the image and in `output`.
+auto storeInstruction(uint8_t* output, int index, uint32_t word) -> void;
+auto emitInstruction(unsigned int it) -> void;
+auto parseInstructionFrom(char* tokens[], int tokenCount, int lineNumber) -> bool;
+
+/// The emit pass, for a single line.
+auto handleLine(char* nextToken, int lineNumber) -> void;
+/// The label pass, for a single line.
+auto huntForLabels(char* nextToken, int lineNumber) -> void;
+
+/// Calls `handle(line, lineNumber)` for each line of `text`, cutting the lines apart in place
+/// (each newline becomes a NUL) - so neither pass has to copy a line to tokenize it.
+template<typename LineHandler>
+auto forEachLine(char* text, size_t size, LineHandler&& handle, int firstLineNumber = 1) -> void {
+    char* const end = text + size;
+    for (int lineNumber = firstLineNumber; text < end; lineNumber++) {
+        char* newline = (char*) memchr(text, '\n', end - text);
+        if (newline) *newline = '\0';
+        handle(text, lineNumber);
+        if (not newline) break;
+        text = newline + 1;
+    }
+}
+
+} // namespace DCSembler
+
+[[nodiscard]]
+auto readFileToString(const string& filePath) -> string;
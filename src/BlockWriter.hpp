@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Formats into a large buffer and hands it to stdio a block at a time, so there's no per-word
+/// printf or fwrite - memory images and listings can run to millions of lines.
+/// 64 KiB, so better off on the heap than the stack.
+struct BlockWriter {
+    static constexpr size_t blockSize = 1 << 16;
+
+    FILE* f;
+    array<char, blockSize> buffer{};
+    size_t used = 0;
+    bool ok = true;
+
+    explicit BlockWriter(FILE* f) : f(f) {}
+
+    auto flush() -> void {
+        if (used and fwrite(buffer.data(), 1, used, f) != used) ok = false;
+        used = 0;
+    }
+
+    /// Room for `n` more characters, where `n` is at most blockSize.
+    auto reserve(size_t n) -> char* {
+        if (used + n > blockSize) flush();
+        return buffer.data() + used;
+    }
+
+    auto text(const char* s) -> void {
+        text(string_view{s});
+    }
+
+    /// Any length - anything too big to buffer goes straight through.
+    auto text(string_view s) -> void {
+        if (s.size() > blockSize) {
+            flush();
+            if (fwrite(s.data(), 1, s.size(), f) != s.size()) ok = false;
+            return;
+        }
+        memcpy(reserve(s.size()), s.data(), s.size());
+        used += s.size();
+    }
+
+    auto hex(uint64_t value, unsigned digits) -> void {
+        static constexpr char hexDigits[] = "0123456789ABCDEF";
+        char* p = reserve(digits);
+        for (unsigned i = digits; i-- > 0; value >>= 4) p[i] = hexDigits[value & 0xf];
+        used += digits;
+    }
+
+    auto binary(uint64_t value, unsigned digits) -> void {
+        char* p = reserve(digits);
+        for (unsigned i = digits; i-- > 0; value >>= 1) p[i] = (char) ('0' + (value & 1));
+        used += digits;
+    }
+
+    /// Right-aligned in `width` characters, space padded.
+    auto decimal(uint64_t value, unsigned width) -> void {
+        char digits[20];
+        unsigned count = 0;
+        do {
+            digits[count++] = (char) ('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        char* p = reserve(max(width, count));
+        const unsigned padding = width > count ? width - count : 0;
+        memset(p, ' ', padding);
+        for (unsigned i = 0; i < count; i++) p[padding + i] = digits[count - 1 - i];
+        used += padding + count;
+    }
+
+    auto character(char c) -> void {
+        *reserve(1) = c;
+        used++;
+    }
+
+    /// `n` of the same character.
+    auto repeat(char c, size_t n) -> void {
+        memset(reserve(n), c, n);
+        used += n;
+    }
+};
+
+}
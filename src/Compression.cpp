@@ -0,0 +1,368 @@
+#include "Compression.hpp"
+
+#include <cinttypes>
+#include <vector>
+
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "Linker.hpp"
+#include "Relaxation.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+namespace {
+
+constexpr uint32_t JAL = 0b1101111;
+constexpr uint32_t BRANCH = 0b1100011;
+constexpr uint32_t OP_IMM = 0b0010011;
+constexpr uint32_t OP = 0b0110011;
+constexpr uint32_t LOAD = 0b0000011;
+constexpr uint32_t STORE = 0b0100011;
+
+/// RVC's quadrants - the bottom two bits.
+constexpr uint16_t C0 = 0b00;
+constexpr uint16_t C1 = 0b01;
+constexpr uint16_t C2 = 0b10;
+
+constexpr uint16_t cNop = 0x0001;
+/// addi x0, x0, 0
+constexpr uint32_t canonicalNop = 0x00000013;
+
+auto appendParcel(Image& image, uint16_t parcel) -> void {
+    image.bytes.push_back(parcel & 0xff);
+    image.bytes.push_back(parcel >> 8);
+}
+
+/// x8 to x15, which the 3-bit register fields of c.lw, c.sw, c.beqz and c.bnez can name.
+auto isCompactRegister(unsigned int r) -> bool {
+    return r >= 8 and r <= 15;
+}
+
+auto fitsSigned(int32_t value, int bits) -> bool {
+    return value >= -(1 << (bits - 1)) and value < (1 << (bits - 1));
+}
+
+auto bit(uint32_t value, int n) -> uint16_t {
+    return (uint16_t) ((value >> n) & 1);
+}
+
+auto bits(uint32_t value, int high, int low) -> uint16_t {
+    return (uint16_t) ((value >> low) & ((1u << (high - low + 1)) - 1));
+}
+
+/// c.li, c.addi: imm[5] | rd | imm[4:0]
+auto ciFormat(uint16_t funct3, unsigned int rd, int32_t immediate) -> uint16_t {
+    const auto imm = (uint32_t) immediate;
+    return (uint16_t) (funct3 << 13 | bit(imm, 5) << 12 | rd << 7 | bits(imm, 4, 0) << 2 | C1);
+}
+
+/// c.lw, c.sw: uimm[5:3] | rs1' | uimm[2] | uimm[6] | rd'/rs2'
+auto clFormat(uint16_t funct3, unsigned int rs1, unsigned int r, uint32_t offset) -> uint16_t {
+    return (uint16_t) (funct3 << 13 | bits(offset, 5, 3) << 10 | (rs1 - 8) << 7
+                       | bit(offset, 2) << 6 | bit(offset, 6) << 5 | (r - 8) << 2 | C0);
+}
+
+/// c.j, c.jal: offset[11|4|9:8|10|6|7|3:1|5]
+auto cjFormat(uint16_t funct3, int32_t byteOffset) -> uint16_t {
+    const auto o = (uint32_t) byteOffset;
+    return (uint16_t) (funct3 << 13 | bit(o, 11) << 12 | bit(o, 4) << 11 | bits(o, 9, 8) << 9
+                       | bit(o, 10) << 8 | bit(o, 6) << 7 | bit(o, 7) << 6 | bits(o, 3, 1) << 3
+                       | bit(o, 5) << 2 | C1);
+}
+
+/// c.beqz, c.bnez: offset[8|4:3] | rs1' | offset[7:6|2:1|5]
+auto cbFormat(uint16_t funct3, unsigned int rs1, int32_t byteOffset) -> uint16_t {
+    const auto o = (uint32_t) byteOffset;
+    return (uint16_t) (funct3 << 13 | bit(o, 8) << 12 | bits(o, 4, 3) << 10 | (rs1 - 8) << 7
+                       | bits(o, 7, 6) << 5 | bits(o, 2, 1) << 3 | bit(o, 5) << 2 | C1);
+}
+
+auto iType(uint32_t opcode, unsigned int rd, uint32_t funct3, unsigned int rs1, int32_t immediate) -> uint32_t {
+    return (uint32_t) immediate << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | opcode;
+}
+
+auto sType(uint32_t funct3, unsigned int rs1, unsigned int rs2, uint32_t offset) -> uint32_t {
+    return (offset >> 5) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | (offset & 0x1f) << 7 | STORE;
+}
+
+/// Sign-extends the bottom `width` bits.
+auto signExtend(uint32_t value, int width) -> int32_t {
+    return (int32_t) (value << (32 - width)) >> (32 - width);
+}
+
+}
+
+auto compressedBranchReaches(int byteOffset) -> bool {
+    return fitsSigned(byteOffset, 9);
+}
+
+auto compressedJumpReaches(int byteOffset) -> bool {
+    return fitsSigned(byteOffset, 12);
+}
+
+auto compressedForm(const DecodedInstruction& d, int byteOffset) -> optional<uint16_t> {
+    switch (d.opcode) {
+        case OP_IMM: {
+            if (d.funct3 != 0b000) return {};
+            // addi
+            if (d.rd == 0) {
+                if (d.rs1 == 0 and d.immediate == 0) return cNop;
+                return {};
+            }
+            if (d.rs1 == 0 and fitsSigned(d.immediate, 6)) return ciFormat(0b010, d.rd, d.immediate); // c.li
+            if (d.rs1 == d.rd and d.immediate != 0 and fitsSigned(d.immediate, 6)) return ciFormat(0b000, d.rd, d.immediate); // c.addi
+            if (d.rs1 != 0 and d.immediate == 0) return (uint16_t) (0b1000 << 12 | d.rd << 7 | d.rs1 << 2 | C2); // c.mv
+            return {};
+        }
+        case LOAD: {
+            if (d.funct3 != 0b010 or d.immediate < 0 or d.immediate % 4 != 0) return {};
+            // lw
+            const auto offset = (uint32_t) d.immediate;
+            if (d.rs1 == 2 and d.rd != 0 and offset < 256) {
+                // c.lwsp: uimm[5] | rd | uimm[4:2|7:6]
+                return (uint16_t) (0b010 << 13 | bit(offset, 5) << 12 | d.rd << 7 | bits(offset, 4, 2) << 4
+                                   | bits(offset, 7, 6) << 2 | C2);
+            }
+            if (isCompactRegister(d.rd) and isCompactRegister(d.rs1) and offset < 128) return clFormat(0b010, d.rs1, d.rd, offset); // c.lw
+            return {};
+        }
+        case STORE: {
+            if (d.funct3 != 0b010 or d.immediate < 0 or d.immediate % 4 != 0) return {};
+            // sw
+            const auto offset = (uint32_t) d.immediate;
+            if (d.rs1 == 2 and offset < 256) {
+                // c.swsp: uimm[5:2|7:6] | rs2
+                return (uint16_t) (0b110 << 13 | bits(offset, 5, 2) << 9 | bits(offset, 7, 6) << 7 | d.rs2 << 2 | C2);
+            }
+            if (isCompactRegister(d.rs2) and isCompactRegister(d.rs1) and offset < 128) return clFormat(0b110, d.rs1, d.rs2, offset); // c.sw
+            return {};
+        }
+        case JAL:
+            if ((d.rd != 0 and d.rd != 1) or not compressedJumpReaches(byteOffset)) return {};
+            return cjFormat(d.rd == 1 ? 0b001 : 0b101, byteOffset); // c.jal, c.j
+        case BRANCH: {
+            if ((d.funct3 != 0b000 and d.funct3 != 0b001) or not compressedBranchReaches(byteOffset)) return {};
+            // beq/bne against x0, either way round.
+            const unsigned int other = d.rs1 == 0 ? d.rs2 : d.rs2 == 0 ? d.rs1 : 0;
+            if (not isCompactRegister(other)) return {};
+            return cbFormat(d.funct3 == 0b000 ? 0b110 : 0b111, other, byteOffset); // c.beqz, c.bnez
+        }
+        default:
+            return {};
+    }
+}
+
+auto expandCompressed(uint16_t parcel) -> optional<uint32_t> {
+    const uint16_t quadrant = parcel & 0b11;
+    const uint16_t funct3 = parcel >> 13;
+    const unsigned int rd = bits(parcel, 11, 7);
+    const unsigned int rs2 = bits(parcel, 6, 2);
+    const unsigned int rs1Compact = bits(parcel, 9, 7) + 8;
+    const unsigned int rCompact = bits(parcel, 4, 2) + 8;
+
+    const int32_t ciImmediate = signExtend(bit(parcel, 12) << 5 | bits(parcel, 6, 2), 6);
+    const uint32_t clOffset = bits(parcel, 12, 10) << 3 | bit(parcel, 6) << 2 | bit(parcel, 5) << 6;
+
+    if (quadrant == C0) {
+        if (funct3 == 0b010) return iType(LOAD, rCompact, 0b010, rs1Compact, (int32_t) clOffset); // c.lw
+        if (funct3 == 0b110) return sType(0b010, rs1Compact, rCompact, clOffset); // c.sw
+        return {};
+    }
+
+    if (quadrant == C1) {
+        switch (funct3) {
+            case 0b000: return iType(OP_IMM, rd, 0b000, rd, ciImmediate); // c.addi, c.nop
+            case 0b010: return iType(OP_IMM, rd, 0b000, 0, ciImmediate); // c.li
+            case 0b001:
+            case 0b101: {
+                // c.jal, c.j
+                const int32_t offset = signExtend(bit(parcel, 12) << 11 | bit(parcel, 11) << 4 | bits(parcel, 10, 9) << 8
+                                                  | bit(parcel, 8) << 10 | bit(parcel, 7) << 6 | bit(parcel, 6) << 7
+                                                  | bits(parcel, 5, 3) << 1 | bit(parcel, 2) << 5, 12);
+                uint32_t jal = (funct3 == 0b001 ? 1u : 0u) << 7 | JAL;
+                patchJal(jal, offset);
+                return jal;
+            }
+            case 0b110:
+            case 0b111: {
+                // c.beqz, c.bnez
+                const int32_t offset = signExtend(bit(parcel, 12) << 8 | bits(parcel, 11, 10) << 3 | bits(parcel, 6, 5) << 6
+                                                  | bits(parcel, 4, 3) << 1 | bit(parcel, 2) << 5, 9);
+                uint32_t branch = rs1Compact << 15 | (funct3 == 0b110 ? 0b000u : 0b001u) << 12 | BRANCH;
+                patchBranch(branch, offset);
+                return branch;
+            }
+            default:
+                return {};
+        }
+    }
+
+    if (quadrant == C2) {
+        if (funct3 == 0b010 and rd != 0) {
+            // c.lwsp
+            const uint32_t offset = bit(parcel, 12) << 5 | bits(parcel, 6, 4) << 2 | bits(parcel, 3, 2) << 6;
+            return iType(LOAD, rd, 0b010, 2, (int32_t) offset);
+        }
+        if (funct3 == 0b110) {
+            // c.swsp
+            const uint32_t offset = bits(parcel, 12, 9) << 2 | bits(parcel, 8, 7) << 6;
+            return sType(0b010, 2, rs2, offset);
+        }
+        if (funct3 == 0b100 and bit(parcel, 12) == 0 and rd != 0 and rs2 != 0) {
+            // c.mv is add rd, x0, rs2.
+            return rs2 << 20 | rd << 7 | OP;
+        }
+    }
+
+    return {};
+}
+
+auto compressedMnemonic(uint16_t parcel) -> const char* {
+    if (parcel == cNop) return "c.nop";
+    if (not expandCompressed(parcel)) return nullptr;
+
+    const uint16_t quadrant = parcel & 0b11;
+    const uint16_t funct3 = parcel >> 13;
+    switch (quadrant << 3 | funct3) {
+        case C0 << 3 | 0b010: return "c.lw";
+        case C0 << 3 | 0b110: return "c.sw";
+        case C1 << 3 | 0b000: return "c.addi";
+        case C1 << 3 | 0b001: return "c.jal";
+        case C1 << 3 | 0b010: return "c.li";
+        case C1 << 3 | 0b101: return "c.j";
+        case C1 << 3 | 0b110: return "c.beqz";
+        case C1 << 3 | 0b111: return "c.bnez";
+        case C2 << 3 | 0b010: return "c.lwsp";
+        case C2 << 3 | 0b100: return "c.mv";
+        case C2 << 3 | 0b110: return "c.swsp";
+        default: return nullptr;
+    }
+}
+
+auto compressImage(Image& image) -> optional<CompressionReport> {
+    auto decoded = decodeProgram(image, "compressing");
+    if (not decoded) return {};
+    auto& program = *decoded;
+    const size_t count = program.size();
+
+    CompressionReport report{};
+    report.bytesBefore = image.size();
+
+    // Everything that could be 2 bytes starts off 2 bytes - jumps as if they'll be near enough.
+    vector<uint8_t> sizes(count, 4);
+    vector<size_t> jumps{};
+    for (size_t i = 0; i < count; i++) {
+        const auto& d = program[i];
+        if (d.relocated or not compressedForm(d, 0)) continue;
+        sizes[i] = 2;
+        if (d.target >= 0) jumps.push_back(i);
+    }
+    // Alignment padding is taken out, and put back in bytes, as much as each site takes now.
+    const auto& sites = alignmentSites;
+    vector<uint32_t> padding(sites.size());
+    for (const auto& site : sites) {
+        for (int i = 0; i < site.padding; i++) sizes[(size_t) (site.instructionIndex + i)] = 0;
+    }
+
+    vector<uint32_t> offsets(count + 1);
+    auto layOut = [&] {
+        uint32_t at = 0;
+        size_t site = 0;
+        for (size_t i = 0; i <= count; i++) {
+            for (; site < sites.size() and sites[site].instructionIndex == (int) i; site++) {
+                padding[site] = paddingFor(at, sites[site].alignment);
+                at += padding[site];
+            }
+            offsets[i] = at;
+            if (i < count) at += sizes[i];
+        }
+    };
+    auto distance = [&](size_t i) { return (int) offsets[program[i].target] - (int) offsets[i]; };
+
+    // Growing one can only push others out of reach, never bring them back - so this settles.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        layOut();
+        size_t stillCompressed = 0;
+        for (size_t i : jumps) {
+            if (compressedForm(program[i], distance(i))) {
+                jumps[stillCompressed++] = i;
+            } else {
+                sizes[i] = 4;
+                changed = true;
+            }
+        }
+        jumps.resize(stillCompressed);
+    }
+
+    // Everything is as close to what it jumps to as it was, or closer - bar what more padding there
+    // might now be.
+    for (size_t i = 0; i < count; i++) {
+        const auto& d = program[i];
+        if (d.target < 0 or sizes[i] != 4) continue;
+        if ((d.opcode == BRANCH and not branchReaches(distance(i))) or (d.opcode == JAL and not jalReaches(distance(i)))) {
+            printf(YELLOW "Warning:" RESET " Not compressing - realigning would put the jump at 0x%08zX out of reach.\n", i * 4);
+            return {};
+        }
+    }
+
+    image.bytes.clear();
+    size_t site = 0;
+    auto pad = [&](size_t i) {
+        for (; site < sites.size() and sites[site].instructionIndex == (int) i; site++) {
+            uint32_t left = padding[site];
+            for (; left >= 4; left -= 4) image.appendWord(canonicalNop);
+            if (left) appendParcel(image, cNop);
+        }
+    };
+    for (size_t i = 0; i < count; i++) {
+        pad(i);
+        auto& d = program[i];
+        if (sizes[i] == 0) continue;
+        const int byteOffset = d.target >= 0 ? distance(i) : 0;
+
+        if (sizes[i] == 2) {
+            const uint16_t parcel = *compressedForm(d, byteOffset);
+            appendParcel(image, parcel);
+            report.compressed[compressedMnemonic(parcel)]++;
+            continue;
+        }
+
+        if (d.target >= 0) {
+            if (d.opcode == BRANCH) {
+                patchBranch(d.word, byteOffset);
+            } else if (d.opcode == JAL) {
+                patchJal(d.word, byteOffset);
+            } else {
+                auto& jalr = program[i + 1];
+                const auto [ auipc, jump ] = farJump(jalr.rd, d.rd, byteOffset);
+                d.word = auipc;
+                jalr.word = jump;
+            }
+        }
+        image.appendWord(d.word);
+    }
+    pad(count);
+    if (image.size() % 4 != 0) appendParcel(image, cNop);
+
+    for (auto& relocation : image.relocations) relocation.offset = offsets[relocation.offset / 4];
+    instructionOffsets = move(offsets);
+    image.compressed = true;
+
+    report.bytesAfter = image.size();
+    return report;
+}
+
+auto printCompressionReport(FILE* f, const CompressionReport& report) -> void {
+    const double saved = report.bytesBefore ? 100.0 * (double) (report.bytesBefore - report.bytesAfter) / (double) report.bytesBefore : 0;
+    fprintf(f, "Compression: %zu bytes down to %zu, " YELLOWC("%.1f%%") " smaller.\n",
+            report.bytesBefore, report.bytesAfter, saved);
+    for (const auto& [ mnemonic, count ] : report.compressed) {
+        fprintf(f, "  " GREENC("%-8s") " %12" PRIu64 "\n", mnemonic.c_str(), count);
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <string>
+
+#include "Image.hpp"
+#include "Peephole.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// How far a compressed branch (c.beqz, c.bnez - +-256 B) and jump (c.j, c.jal - +-2 KiB) reach.
+auto compressedBranchReaches(int byteOffset) -> bool;
+auto compressedJumpReaches(int byteOffset) -> bool;
+
+/// The 16-bit RVC form of `d`, if it has one: c.nop, c.li, c.addi, c.mv, c.lw, c.sw, c.lwsp,
+/// c.swsp, c.j, c.jal, c.beqz and c.bnez. Branches and jumps are encoded with `byteOffset` (from
+/// themselves) rather than whatever `d` has, and have no compressed form if that's too far.
+auto compressedForm(const DecodedInstruction& d, int byteOffset) -> optional<uint16_t>;
+
+/// The 32-bit instruction a compressed one stands for - any compressedForm makes. Nothing for the
+/// rest of RVC.
+auto expandCompressed(uint16_t parcel) -> optional<uint32_t>;
+
+/// Whether a 16-bit parcel is a whole (compressed) instruction, rather than the first half of a
+/// 32-bit one.
+inline auto isCompressed(uint16_t parcel) -> bool { return (parcel & 0b11) != 0b11; }
+
+/// `c.li` and the like, for one of compressedForm's - or nullptr.
+auto compressedMnemonic(uint16_t parcel) -> const char*;
+
+struct CompressionReport {
+    size_t bytesBefore = 0;
+    size_t bytesAfter = 0;
+    /// How many of each compressed instruction there are.
+    map<string, uint64_t, less<>> compressed{};
+};
+
+/// Rewrites every instruction in the image that has a compressed form as one, and points every
+/// branch, jump and auipc/jalr pair back at what it went to. Labels stay instruction indices -
+/// instructionOffsets is filled in to say where each one now is - and relocations move to match.
+///
+/// A compressed branch or jump reaches less far, and making one bigger pushes the rest apart - so,
+/// like relaxSites, every one starts off compressed and the ones that don't reach are grown until
+/// none are left. Instructions with relocations are left 4 bytes for the linker.
+///
+/// Alignment padding (see Alignment.hpp) is laid out again in bytes - nops, then a c.nop if there
+/// are 2 left. The image is padded to a whole number of words with a c.nop. Nothing is touched, and nothing
+/// returned, if decodeProgram won't have it - or if more padding would put a 4 byte jump out of reach.
+auto compressImage(Image& image) -> optional<CompressionReport>;
+
+auto printCompressionReport(FILE* f, const CompressionReport& report) -> void;
+
+}
@@ -0,0 +1,356 @@
+#include "Corpus.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+
+namespace DcsEmbler {
+
+namespace {
+
+/// splitmix64 - tiny, and unlike the <random> distributions, gives the same numbers everywhere.
+struct Random {
+    uint64_t state;
+
+    auto next() -> uint64_t {
+        uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    /// In [0, bound).
+    auto below(uint64_t bound) -> uint64_t { return next() % bound; }
+    /// In [low, high].
+    auto between(int64_t low, int64_t high) -> int64_t { return low + (int64_t) below(high - low + 1); }
+};
+
+/// How an instruction's operands are written, which is all the generator needs to know about it.
+enum class Shape : unsigned short {
+    registers3, registerImmediate, shiftImmediate, loadStore, upper, branch, jump, move, jumpRegister,
+    bare, loadImmediate
+};
+
+struct Mnemonic {
+    const char* name;
+    Shape shape;
+};
+
+const Mnemonic knownMnemonics[] = {
+    {"add", Shape::registers3}, {"sub", Shape::registers3}, {"xor", Shape::registers3},
+    {"or", Shape::registers3}, {"and", Shape::registers3}, {"sll", Shape::registers3},
+    {"srl", Shape::registers3}, {"sra", Shape::registers3}, {"slt", Shape::registers3},
+    {"sltu", Shape::registers3},
+    {"addi", Shape::registerImmediate}, {"xori", Shape::registerImmediate},
+    {"ori", Shape::registerImmediate}, {"andi", Shape::registerImmediate},
+    {"slti", Shape::registerImmediate}, {"sltiu", Shape::registerImmediate},
+    {"slli", Shape::shiftImmediate}, {"srli", Shape::shiftImmediate}, {"srai", Shape::shiftImmediate},
+    {"lw", Shape::loadStore}, {"lh", Shape::loadStore}, {"lb", Shape::loadStore},
+    {"lbu", Shape::loadStore}, {"lhu", Shape::loadStore},
+    {"sw", Shape::loadStore}, {"sh", Shape::loadStore}, {"sb", Shape::loadStore},
+    {"jalr", Shape::loadStore},
+    {"lui", Shape::upper}, {"auipc", Shape::upper},
+    {"beq", Shape::branch}, {"bne", Shape::branch}, {"blt", Shape::branch},
+    {"bge", Shape::branch}, {"bltu", Shape::branch}, {"bgeu", Shape::branch},
+    {"jal", Shape::jump},
+    {"mv", Shape::move}, {"jr", Shape::jumpRegister},
+    {"nop", Shape::bare}, {"ecall", Shape::bare}, {"ebreak", Shape::bare},
+    {"li", Shape::loadImmediate},
+};
+
+auto findMnemonic(const string& name) -> const Mnemonic* {
+    for (const auto& m : knownMnemonics) {
+        if (name == m.name) return &m;
+    }
+    return nullptr;
+}
+
+/// Furthest a generated branch/jump goes, in instructions. A little short of the real B-type and
+/// J-type ranges, to leave room for nudging targets onto the nearest label.
+const int64_t maxBranchDistance = 900;
+const int64_t maxJumpDistance = 200000;
+
+const char* const directives[] = {
+    ".file\t\"corpus.c\"",
+    ".option nopic",
+    ".attribute arch, \"rv32i2p0\"",
+    ".attribute unaligned_access, 0",
+    ".attribute stack_align, 16",
+    ".text",
+    ".ident\t\"GCC: (GNU) 11.1.0\"",
+};
+
+const char* const commentWords[] = {
+    "loop", "counter", "load", "the", "next", "value", "save", "restore", "check", "done", "stack",
+};
+
+/// Accumulates the corpus in a string.
+struct StringSink {
+    string text{};
+    uint64_t written = 0;
+
+    auto write(const char* s, size_t n) -> void {
+        text.append(s, n);
+        written += n;
+    }
+};
+
+/// Streams the corpus out to a file.
+struct FileSink {
+    FILE* f;
+    uint64_t written = 0;
+
+    auto write(const char* s, size_t n) -> void {
+        fwrite(s, 1, n, f);
+        written += n;
+    }
+};
+
+/// Writes a whole corpus. Whether an instruction is labelled only depends on its index (and the
+/// seed), so forward branches can find their target label without knowing what comes before it.
+template<typename Sink>
+class Generator {
+    const CorpusSpec& spec;
+    Sink& sink;
+    Random random;
+
+    vector<const Mnemonic*> mnemonics{};
+    vector<int> cumulativeWeights{};
+    int totalWeight = 0;
+
+    /// Labels referred to ahead of where we've got to. Whatever's left at the end gets emitted there.
+    set<uint64_t> pendingLabels{};
+
+    char line[160];
+    char target[32];
+
+    auto put(const char* s) -> void { sink.write(s, strlen(s)); }
+
+    auto chance(double p) -> bool { return (random.next() >> 11) * 0x1.0p-53 < p; }
+
+    auto isLabelled(uint64_t index) -> bool {
+        if (index == 0) return true;
+        Random r{spec.seed ^ (index * 0xd6e8feb86659fd93)};
+        return (r.next() >> 11) * 0x1.0p-53 < spec.labelDensity;
+    }
+
+    auto labelName(uint64_t index) -> const char* {
+        snprintf(target, sizeof(target), "L%llu", (unsigned long long) index);
+        return target;
+    }
+
+    /// Picks a labelled instruction somewhere around the given distance from here, or returns false if
+    /// there isn't one in range.
+    auto pickTarget(uint64_t here, double meanDistance, int64_t maxDistance, uint64_t& chosen) -> bool {
+        const double u = (random.next() >> 11) * 0x1.0p-53;
+        int64_t distance = 1 + (int64_t) (-meanDistance * log1p(-u));
+        distance = min(distance, maxDistance);
+
+        const bool forwards = chance(spec.forwardBranchRatio);
+        const int64_t h = (int64_t) here;
+
+        // Look between here and the ideal target first, so we never go further than asked.
+        // Then the other side of the ideal target, then the other direction entirely.
+        const int64_t low = max<int64_t>(0, h - maxDistance);
+        const int64_t high = h + maxDistance;
+        const int64_t ideal = forwards ? h + distance : max<int64_t>(low, h - distance);
+
+        if (forwards) {
+            for (int64_t i = ideal; i > h; i--) if (isLabelled(i)) { chosen = i; return true; }
+            for (int64_t i = ideal + 1; i <= high; i++) if (isLabelled(i)) { chosen = i; return true; }
+        } else {
+            for (int64_t i = ideal; i <= h; i++) if (isLabelled(i)) { chosen = i; return true; }
+            for (int64_t i = ideal - 1; i >= low; i--) if (isLabelled(i)) { chosen = i; return true; }
+        }
+        for (int64_t i = h; i >= low; i--) if (isLabelled(i)) { chosen = i; return true; }
+        return false;
+    }
+
+    auto writeInstruction(uint64_t index) -> void {
+        const int pick = (int) random.below(totalWeight);
+        size_t which = 0;
+        while (cumulativeWeights[which] <= pick) which++;
+        const Mnemonic& m = *mnemonics[which];
+
+        auto reg = [&]() { return (int) random.between(1, 31); };
+
+        Shape shape = m.shape;
+        uint64_t destination = 0;
+        if (shape == Shape::branch or shape == Shape::jump) {
+            const bool branch = shape == Shape::branch;
+            const bool found = pickTarget(index,
+                                          branch ? spec.meanBranchDistance : spec.meanJumpDistance,
+                                          branch ? maxBranchDistance : maxJumpDistance, destination);
+            if (not found) {
+                // No labels anywhere near - fall back to something that doesn't need one.
+                snprintf(line, sizeof(line), "    addi x%d, x%d, 1\n", reg(), reg());
+                put(line);
+                return;
+            }
+            if (destination > index) pendingLabels.insert(destination);
+        }
+
+        switch (shape) {
+            case Shape::registers3:
+                snprintf(line, sizeof(line), "    %s x%d, x%d, x%d\n", m.name, reg(), reg(), reg());
+                break;
+            case Shape::registerImmediate:
+                snprintf(line, sizeof(line), "    %s x%d, x%d, %lld\n", m.name, reg(), reg(),
+                         (long long) random.between(-2048, 2047));
+                break;
+            case Shape::shiftImmediate:
+                snprintf(line, sizeof(line), "    %s x%d, x%d, %lld\n", m.name, reg(), reg(),
+                         (long long) random.between(0, 31));
+                break;
+            case Shape::loadStore:
+                snprintf(line, sizeof(line), "    %s x%d, %lld(x%d)\n", m.name, reg(),
+                         (long long) random.between(-512, 511) * 4, reg());
+                break;
+            case Shape::upper:
+                snprintf(line, sizeof(line), "    %s x%d, %lld\n", m.name, reg(),
+                         (long long) random.between(0, 0xfffff));
+                break;
+            case Shape::branch:
+                snprintf(line, sizeof(line), "    %s x%d, x%d, %s\n", m.name, reg(), reg(),
+                         labelName(destination));
+                break;
+            case Shape::jump:
+                snprintf(line, sizeof(line), "    %s x%d, %s\n", m.name, random.below(2) ? 0 : 1,
+                         labelName(destination));
+                break;
+            case Shape::move:
+                snprintf(line, sizeof(line), "    %s x%d, x%d\n", m.name, reg(), reg());
+                break;
+            case Shape::jumpRegister:
+                snprintf(line, sizeof(line), "    %s x%d\n", m.name, reg());
+                break;
+            case Shape::bare:
+                snprintf(line, sizeof(line), "    %s\n", m.name);
+                break;
+            case Shape::loadImmediate:
+                snprintf(line, sizeof(line), "    %s x%d, %lld\n", m.name, reg(),
+                         (long long) (int32_t) random.next());
+                break;
+        }
+
+        put(line);
+    }
+
+    auto writeComment() -> void {
+        put("# ");
+        const int words = (int) random.between(1, 6);
+        for (int w = 0; w < words; w++) {
+            if (w) put(" ");
+            put(commentWords[random.below(size(commentWords))]);
+        }
+        put("\n");
+    }
+
+public:
+    Generator(const CorpusSpec& spec, Sink& sink) : spec(spec), sink(sink), random{spec.seed} {
+        for (const auto& [ name, weight ] : spec.mix) {
+            if (weight == 0) continue;
+            totalWeight += weight;
+            mnemonics.push_back(findMnemonic(name));
+            cumulativeWeights.push_back(totalWeight);
+        }
+    }
+
+    auto run() -> void {
+        if (totalWeight == 0) return;
+
+        uint64_t index = 0;
+        while (spec.bytes ? sink.written < spec.bytes : index < spec.lines) {
+            if (spec.directiveRatio > 0 and chance(spec.directiveRatio)) {
+                put("    ");
+                put(directives[random.below(size(directives))]);
+                put("\n");
+            }
+            if (spec.commentRatio > 0 and chance(spec.commentRatio)) {
+                writeComment();
+            }
+            if (isLabelled(index)) {
+                put(labelName(index));
+                put(":\n");
+                pendingLabels.erase(index);
+            }
+
+            writeInstruction(index);
+            index++;
+        }
+
+        // Forward references past the end still need somewhere to go.
+        for (uint64_t pending : pendingLabels) {
+            put(labelName(pending));
+            put(":\n");
+        }
+    }
+};
+
+}
+
+auto defaultMnemonicMix() -> MnemonicMix {
+    return {
+        {"addi", 6}, {"add", 3}, {"sub", 1}, {"and", 1}, {"or", 1}, {"slli", 1},
+        {"lw", 3}, {"sw", 2}, {"lui", 1}, {"beq", 1}, {"bne", 1}, {"blt", 1}, {"jal", 1}, {"mv", 1},
+    };
+}
+
+auto parseMnemonicMix(const string& spec) -> MnemonicMix {
+    MnemonicMix mix{};
+
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == string::npos) end = spec.size();
+
+        const string entry = spec.substr(start, end - start);
+        const size_t equals = entry.find('=');
+        const string name = entry.substr(0, equals);
+        const int weight = equals == string::npos ? 1 : atoi(entry.c_str() + equals + 1);
+
+        if (findMnemonic(name) == nullptr or weight < 0) {
+            cerr << " [Error]: Unknown mnemonic (or bad weight) in mix: '" << entry << "'\n";
+            exit(EXIT_FAILURE);
+        }
+        mix.emplace_back(name, weight);
+
+        start = end + 1;
+    }
+
+    return mix;
+}
+
+auto generateCorpus(const CorpusSpec& spec) -> string {
+    StringSink sink{};
+    sink.text.reserve((spec.bytes ? spec.bytes : spec.lines * 24) + 64);
+    Generator<StringSink>{spec, sink}.run();
+    return move(sink.text);
+}
+
+auto generateCorpus(const CorpusSpec& spec, FILE* f) -> uint64_t {
+    FileSink sink{f};
+    Generator<FileSink>{spec, sink}.run();
+    return sink.written;
+}
+
+auto parseByteSize(const string& size) -> uint64_t {
+    char* suffix = nullptr;
+    uint64_t n = strtoull(size.c_str(), &suffix, 10);
+    switch (toupper(*suffix)) {
+        case 'G': n *= 1024;
+            [[fallthrough]];
+        case 'M': n *= 1024;
+            [[fallthrough]];
+        case 'K': n *= 1024;
+            break;
+    }
+    return n;
+}
+
+}
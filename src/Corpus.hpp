@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Relative weights of the mnemonics a synthetic corpus is made of, e.g. {{"addi", 4}, {"lw", 1}}.
+using MnemonicMix = vector<pair<string, int>>;
+
+/// Parses a mix written as `addi=4,lw=1,beq=1`. Exits with a message on anything it doesn't know.
+auto parseMnemonicMix(const string& spec) -> MnemonicMix;
+auto defaultMnemonicMix() -> MnemonicMix;
+
+/// Describes a synthetic (but valid) dcsembler source.
+struct CorpusSpec {
+    /// Number of instruction lines - labels, comments and directives come on top of these.
+    uint64_t lines = 10000;
+    /// When non-zero, keep going until at least this many bytes have been written, instead of
+    /// counting lines.
+    uint64_t bytes = 0;
+    MnemonicMix mix = defaultMnemonicMix();
+    uint64_t seed = 1;
+
+    /// Chance of any one instruction having a label in front of it.
+    double labelDensity = 1.0 / 16;
+    /// Chance of a branch or jump going forwards rather than backwards.
+    double forwardBranchRatio = 0.5;
+    /// Branch and jump distances (in instructions) are exponentially distributed with these means.
+    /// They're kept within the B-type (+-4 KiB) and J-type (+-1 MiB) ranges either way.
+    double meanBranchDistance = 16;
+    double meanJumpDistance = 256;
+
+    /// Chance of a comment line in front of any one instruction.
+    double commentRatio = 0.0;
+    /// Chance of a gcc-style directive line (`.file`, `.attribute` and friends) in front of any one
+    /// instruction. The assembler skips these.
+    double directiveRatio = 0.0;
+};
+
+/// The same spec always gives the same source.
+/// Labels are named after the (zero-based) index of the instruction they're in front of, `L<index>`.
+auto generateCorpus(const CorpusSpec& spec) -> string;
+/// Streams the corpus out, so it can be far bigger than memory. Returns the number of bytes written.
+auto generateCorpus(const CorpusSpec& spec, FILE* f) -> uint64_t;
+
+/// Understands plain byte counts, and K/M/G suffixes (powers of 1024), e.g. `10G`.
+auto parseByteSize(const string& size) -> uint64_t;
+
+}
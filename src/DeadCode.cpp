@@ -0,0 +1,125 @@
+#include "DeadCode.hpp"
+
+#include <cinttypes>
+#include <sstream>
+
+#include "Peephole.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+namespace {
+
+constexpr uint8_t JAL = 0b1101111;
+constexpr uint8_t JALR = 0b1100111;
+
+}
+
+auto parseKeepList(const string& text) -> vector<string> {
+    vector<string> names{};
+    istringstream list{text};
+    string name;
+    while (getline(list, name, ',')) {
+        if (not name.empty()) names.push_back(name);
+    }
+    return names;
+}
+
+auto removeDeadCode(Image& image, LabelSet& labels, const SymbolNames& globals, const vector<string>& keep,
+                    const optional<string>& entry) -> optional<DeadCodeReport> {
+    const size_t count = image.size() / 4;
+
+    auto program = decodeProgram(image, "removing dead code");
+    if (not program) return {};
+
+    Peephole p = Peephole::of(move(*program), labels);
+
+    // Alignment padding is out of the way already - control goes through it to what's after.
+    auto kept = [&](int i) {
+        while (i < (int) count and p.program[i].removed) i++;
+        return i;
+    };
+
+    vector<bool> reached(count + 1, false);
+    vector<int> pending{};
+    auto reach = [&](int i) {
+        i = kept(i);
+        if (not reached[i]) {
+            reached[i] = true;
+            pending.push_back(i);
+        }
+    };
+    auto reachLabel = [&](string_view name) {
+        const Label* label = labels.lookup(name);
+        if (label and label->instructionIndex >= 0 and label->instructionIndex <= (int) count) reach(label->instructionIndex);
+        return label != nullptr;
+    };
+
+    reach(0);
+    if (entry) {
+        reachLabel(*entry);
+    } else {
+        for (const char* name : {"_start", "__begin"}) reachLabel(name);
+    }
+    for (const auto& name : globals) reachLabel(name);
+    for (const auto& name : keep) {
+        if (not reachLabel(name)) {
+            printf(YELLOW "Warning:" RESET " There's no label '" YELLOW "%s" RESET "' to keep.\n", name.c_str());
+        }
+    }
+
+    while (not pending.empty()) {
+        const int i = pending.back();
+        pending.pop_back();
+        if (i == (int) count) continue;
+
+        const auto& d = p.program[i];
+        if (d.target >= 0) reach(d.target);
+        // A jump that links comes back after itself. One that doesn't, doesn't - for a jalr, it's
+        // gone wherever the register says, which is down to the keep list.
+        const bool jumpsAway = (d.opcode == JAL or d.opcode == JALR) and d.rd == 0;
+        if (not jumpsAway) reach(i + 1);
+    }
+
+    // Labels on what's about to go go with it.
+    vector<string> gone{};
+    for (const auto& [ name, label ] : labels) {
+        const int i = label.instructionIndex;
+        if (i >= 0 and i < (int) count and not reached[kept(i)]) gone.push_back(name);
+    }
+
+    DeadCodeReport report{};
+    report.instructionsBefore = (int) count;
+    bool inBlock = false;
+    for (size_t i = 0; i < count; i++) {
+        if (p.program[i].removed) continue;
+        if (reached[i]) {
+            inBlock = false;
+            continue;
+        }
+        if (not inBlock) report.blocks++;
+        inBlock = true;
+        p.remove(i);
+    }
+    if (report.blocks == 0) {
+        report.instructionsAfter = (int) count;
+        return report;
+    }
+
+    if (not p.closeUp(image, labels, "removing dead code")) return {};
+    report.instructionsAfter = p.position[count];
+
+    for (const auto& name : gone) labels.erase(name);
+    report.labels = gone.size();
+    return report;
+}
+
+auto printDeadCodeReport(FILE* f, const DeadCodeReport& report) -> void {
+    fprintf(f, "Dead code: " YELLOWC("%d") " of %d instructions removed, in %" PRIu64 " blocks, along with %" PRIu64
+               " labels - %d left.\n",
+            report.instructionsBefore - report.instructionsAfter, report.instructionsBefore, report.blocks,
+            report.labels, report.instructionsAfter);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Assembler.hpp"
+#include "Image.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+struct DeadCodeReport {
+    int instructionsBefore = 0;
+    int instructionsAfter = 0;
+    /// Runs of unreachable instructions taken out.
+    uint64_t blocks = 0;
+    /// Labels that were only on what was taken out, and went with it.
+    uint64_t labels = 0;
+};
+
+/// `a,b,c` as the names in it.
+auto parseKeepList(const string& text) -> vector<string>;
+
+/// Takes out whatever control can't get to, then closes up the gaps as -O does (see Peephole.hpp).
+///
+/// Control gets to the start of the program, to the entry label (`entry`, or else `_start` or
+/// `__begin`), to every name in `globals`, and to every label in `keep` - and from each instruction
+/// on to where it branches or jumps, and to the next one, unless it's a jal or jalr that doesn't
+/// link. A jalr's own target is never known: whatever it can go to, other than back after a call,
+/// has to have a label in `keep`.
+///
+/// Nothing is touched, and nothing returned, if decodeProgram won't have it - or if more padding
+/// would put a branch out of reach.
+auto removeDeadCode(Image& image, LabelSet& labels, const SymbolNames& globals, const vector<string>& keep,
+                    const optional<string>& entry) -> optional<DeadCodeReport>;
+
+auto printDeadCodeReport(FILE* f, const DeadCodeReport& report) -> void;
+
+}
@@ -0,0 +1,336 @@
+#include "Elf.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <elf.h>
+#include <unistd.h>
+
+#include "Alignment.hpp"
+
+namespace DcsEmbler {
+
+// The headers are copied in as they sit in memory.
+static_assert(endian::native == endian::little, "ELF output assumes a little-endian host");
+
+namespace {
+
+/// What a loader maps at a time - the text's file offset has to agree with its address modulo this.
+constexpr size_t pageSize = 0x1000;
+
+auto alignUp(size_t n, size_t alignment) -> size_t {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+/// A string table - offsets in, then the table all at once.
+struct StringTable {
+    string table{'\0'};
+
+    auto add(string_view s) -> uint32_t {
+        const auto offset = (uint32_t) table.size();
+        table.append(s);
+        table.push_back('\0');
+        return offset;
+    }
+};
+
+template<typename T>
+auto put(vector<uint8_t>& buffer, size_t offset, const T& value) -> void {
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+auto relocationType(Relocation::Type type) -> uint32_t {
+    switch (type) {
+        case Relocation::Type::branch: return R_RISCV_BRANCH;
+        case Relocation::Type::jal: return R_RISCV_JAL;
+    }
+    return R_RISCV_NONE;
+}
+
+/// A section to be written: its header (bar the name and offset) and the bytes that go in it.
+struct Section {
+    const char* name = "";
+    Elf32_Shdr header{};
+    const void* data = nullptr;
+    /// Put right at the cursor rather than aligned up from it - for text that has to be at a given
+    /// offset to be mapped.
+    bool atCursor = false;
+};
+
+/// Where everything goes in the file, worked out before anything is written.
+struct Layout {
+    StringTable sectionNames{};
+    size_t sectionHeadersOffset = 0;
+    size_t totalSize = 0;
+};
+
+/// Adds the section name table, then places every section (in order, from `cursor` on) and the
+/// section headers after them.
+auto layOut(vector<Section>& sections, size_t cursor) -> Layout {
+    Layout layout{};
+
+    sections.push_back(Section{".shstrtab"});
+    for (auto& section : sections) {
+        if (section.name[0]) section.header.sh_name = layout.sectionNames.add(section.name);
+    }
+    auto& shstrtab = sections.back();
+    shstrtab.header.sh_type = SHT_STRTAB;
+    shstrtab.header.sh_size = (Elf32_Word) layout.sectionNames.table.size();
+    shstrtab.header.sh_addralign = 1;
+    shstrtab.data = layout.sectionNames.table.data();
+
+    for (auto& section : sections) {
+        if (section.header.sh_type == SHT_NULL) continue;
+        if (not section.atCursor) cursor = alignUp(cursor, max<size_t>(section.header.sh_addralign, 1));
+        section.header.sh_offset = (Elf32_Off) cursor;
+        cursor += section.header.sh_size;
+    }
+
+    layout.sectionHeadersOffset = alignUp(cursor, 4);
+    layout.totalSize = layout.sectionHeadersOffset + sections.size() * sizeof(Elf32_Shdr);
+    return layout;
+}
+
+auto fill(vector<uint8_t>& buffer, const vector<Section>& sections, const Layout& layout) -> void {
+    for (size_t i = 0; i < sections.size(); i++) {
+        const auto& header = sections[i].header;
+        if (header.sh_size and sections[i].data) {
+            memcpy(buffer.data() + header.sh_offset, sections[i].data, header.sh_size);
+        }
+        put(buffer, layout.sectionHeadersOffset + i * sizeof(Elf32_Shdr), header);
+    }
+}
+
+auto elfHeader(uint16_t type, const Layout& layout, size_t sectionCount, bool compressed) -> Elf32_Ehdr {
+    Elf32_Ehdr header{};
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS32;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_NONE;
+    header.e_type = type;
+    header.e_machine = EM_RISCV;
+    header.e_version = EV_CURRENT;
+    // Soft float - and RVC, if there are compressed instructions.
+    header.e_flags = compressed ? EF_RISCV_RVC : 0;
+    header.e_ehsize = sizeof(Elf32_Ehdr);
+    header.e_shoff = (Elf32_Off) layout.sectionHeadersOffset;
+    header.e_shentsize = sizeof(Elf32_Shdr);
+    header.e_shnum = (Elf32_Half) sectionCount;
+    header.e_shstrndx = (Elf32_Half) (sectionCount - 1);
+    return header;
+}
+
+struct SymbolTable {
+    StringTable strings{};
+    vector<Elf32_Sym> symbols{};
+    /// One past the last local symbol.
+    uint32_t firstGlobal = 0;
+};
+
+/// The null symbol, a section symbol for the text, then the labels - the local ones, then the
+/// `globals`, each by address (then name), so the same source always gives the same file.
+/// Labels sit at `base` plus their offset into the text.
+auto labelSymbols(const LabelSet& labels, const SymbolNames& globals, uint16_t textIndex, uint32_t base) -> SymbolTable {
+    SymbolTable table{};
+    table.symbols.reserve(2 + labels.size());
+    table.symbols.push_back(Elf32_Sym{});
+
+    Elf32_Sym textSection{};
+    textSection.st_value = base;
+    textSection.st_info = ELF32_ST_INFO(STB_LOCAL, STT_SECTION);
+    textSection.st_shndx = textIndex;
+    table.symbols.push_back(textSection);
+
+    struct Entry {
+        const LabelSet::value_type* label;
+        bool global;
+    };
+    vector<Entry> sortedLabels{};
+    sortedLabels.reserve(labels.size());
+    for (const auto& entry : labels) sortedLabels.push_back({&entry, globals.contains(entry.first)});
+    sort(sortedLabels.begin(), sortedLabels.end(), [](const Entry& a, const Entry& b) {
+        if (a.global != b.global) return b.global;
+        if (a.label->second.instructionIndex != b.label->second.instructionIndex) {
+            return a.label->second.instructionIndex < b.label->second.instructionIndex;
+        }
+        return a.label->first < b.label->first;
+    });
+
+    table.firstGlobal = (uint32_t) table.symbols.size();
+    for (const auto& [ entry, global ] : sortedLabels) {
+        Elf32_Sym symbol{};
+        symbol.st_name = table.strings.add(entry->first);
+        symbol.st_value = base + (Elf32_Addr) instructionOffset(entry->second.instructionIndex);
+        symbol.st_info = ELF32_ST_INFO(global ? STB_GLOBAL : STB_LOCAL, STT_NOTYPE);
+        symbol.st_shndx = textIndex;
+        table.symbols.push_back(symbol);
+        if (not global) table.firstGlobal = (uint32_t) table.symbols.size();
+    }
+
+    return table;
+}
+
+auto symbolSections(const SymbolTable& table, uint32_t strtabIndex) -> pair<Section, Section> {
+    Section symtab{".symtab"};
+    symtab.header.sh_type = SHT_SYMTAB;
+    symtab.header.sh_size = (Elf32_Word) (table.symbols.size() * sizeof(Elf32_Sym));
+    symtab.header.sh_link = strtabIndex;
+    symtab.header.sh_info = table.firstGlobal;
+    symtab.header.sh_addralign = 4;
+    symtab.header.sh_entsize = sizeof(Elf32_Sym);
+    symtab.data = table.symbols.data();
+
+    Section strtab{".strtab"};
+    strtab.header.sh_type = SHT_STRTAB;
+    strtab.header.sh_size = (Elf32_Word) table.strings.table.size();
+    strtab.header.sh_addralign = 1;
+    strtab.data = table.strings.table.data();
+
+    return {symtab, strtab};
+}
+
+auto textSection(const Image& image, uint32_t address) -> Section {
+    Section text{".text"};
+    text.header.sh_type = SHT_PROGBITS;
+    text.header.sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    text.header.sh_addr = address;
+    text.header.sh_size = (Elf32_Word) image.size();
+    // For the linker to keep to, so the alignment directives in it still hold - but no more than
+    // the address it's already at keeps to.
+    const uint32_t alignment = largestAlignment();
+    text.header.sh_addralign = address ? min(alignment, address & (0u - address)) : alignment;
+    text.data = image.bytes.data();
+    return text;
+}
+
+/// pwrite(2) until it's all out, or it fails.
+auto writeAll(int fd, const vector<uint8_t>& buffer) -> bool {
+    size_t written = 0;
+    while (written < buffer.size()) {
+        const auto n = pwrite(fd, buffer.data() + written, buffer.size() - written, (off_t) written);
+        if (n < 0 and errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += (size_t) n;
+    }
+    return true;
+}
+
+}
+
+auto buildRelocatableElf(const Image& image, const LabelSet& labels, const SymbolNames& globals) -> vector<uint8_t> {
+    enum : uint16_t { null, text, relaText, symtab, strtab };
+
+    auto symbols = labelSymbols(labels, globals, text, 0);
+
+    unordered_map<string_view, uint32_t> undefinedSymbols{};
+    for (const auto& relocation : image.relocations) {
+        if (undefinedSymbols.contains(relocation.symbol)) continue;
+
+        undefinedSymbols.emplace(relocation.symbol, (uint32_t) symbols.symbols.size());
+        Elf32_Sym symbol{};
+        symbol.st_name = symbols.strings.add(relocation.symbol);
+        symbol.st_info = ELF32_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+        symbol.st_shndx = SHN_UNDEF;
+        symbols.symbols.push_back(symbol);
+    }
+
+    vector<Elf32_Rela> relocations{};
+    relocations.reserve(image.relocations.size());
+    for (const auto& relocation : image.relocations) {
+        Elf32_Rela rela{};
+        rela.r_offset = relocation.offset;
+        rela.r_info = ELF32_R_INFO(undefinedSymbols.at(relocation.symbol), relocationType(relocation.type));
+        relocations.push_back(rela);
+    }
+
+    Section rela{".rela.text"};
+    rela.header.sh_type = SHT_RELA;
+    rela.header.sh_flags = SHF_INFO_LINK;
+    rela.header.sh_size = (Elf32_Word) (relocations.size() * sizeof(Elf32_Rela));
+    rela.header.sh_link = symtab;
+    rela.header.sh_info = text;
+    rela.header.sh_addralign = 4;
+    rela.header.sh_entsize = sizeof(Elf32_Rela);
+    rela.data = relocations.data();
+
+    const auto [ symtabSection, strtabSection ] = symbolSections(symbols, strtab);
+    vector<Section> sections{Section{}, textSection(image, 0), rela, symtabSection, strtabSection};
+
+    const auto layout = layOut(sections, sizeof(Elf32_Ehdr));
+
+    vector<uint8_t> buffer(layout.totalSize, 0);
+    put(buffer, 0, elfHeader(ET_REL, layout, sections.size(), image.compressed));
+    fill(buffer, sections, layout);
+    return buffer;
+}
+
+auto writeRelocatableElf(FILE* f, const Image& image, const LabelSet& labels, const SymbolNames& globals) -> bool {
+    const auto buffer = buildRelocatableElf(image, labels, globals);
+    return fwrite(buffer.data(), 1, buffer.size(), f) == buffer.size();
+}
+
+auto buildExecutableElf(const Image& image, const LabelSet& labels,
+                        uint32_t loadAddress, uint32_t entryAddress, const SymbolNames& globals) -> vector<uint8_t> {
+    enum : uint16_t { null, text, symtab, strtab };
+
+    const auto symbols = labelSymbols(labels, globals, text, loadAddress);
+    const auto [ symtabSection, strtabSection ] = symbolSections(symbols, strtab);
+    vector<Section> sections{Section{}, textSection(image, loadAddress), symtabSection, strtabSection};
+
+    // The text starts right after the headers if it can, but its offset has to match its address
+    // modulo the page size for it to be mapped straight from the file - so it goes there whatever
+    // the address is a multiple of.
+    const size_t headersSize = sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr);
+    const size_t textOffset = headersSize + ((loadAddress - headersSize) % pageSize);
+    sections[text].atCursor = true;
+    const auto layout = layOut(sections, textOffset);
+
+    vector<uint8_t> buffer(layout.totalSize, 0);
+
+    auto header = elfHeader(ET_EXEC, layout, sections.size(), image.compressed);
+    header.e_entry = entryAddress;
+    header.e_phoff = sizeof(Elf32_Ehdr);
+    header.e_phentsize = sizeof(Elf32_Phdr);
+    header.e_phnum = 1;
+    put(buffer, 0, header);
+
+    Elf32_Phdr program{};
+    program.p_type = PT_LOAD;
+    program.p_offset = sections[text].header.sh_offset;
+    program.p_vaddr = loadAddress;
+    program.p_paddr = loadAddress;
+    program.p_filesz = (Elf32_Word) image.size();
+    program.p_memsz = (Elf32_Word) image.size();
+    program.p_flags = PF_R | PF_X;
+    program.p_align = pageSize;
+    put(buffer, sizeof(Elf32_Ehdr), program);
+
+    fill(buffer, sections, layout);
+    return buffer;
+}
+
+auto entryPointFor(const LabelSet& labels, const optional<string>& entry, uint32_t loadAddress) -> optional<uint32_t> {
+    auto addressOf = [&](const Label& label) { return loadAddress + instructionOffset(label.instructionIndex); };
+
+    if (entry) {
+        if (const Label* label = labels.lookup(*entry)) return addressOf(*label);
+        return {};
+    }
+    for (const char* name : {"_start", "__begin"}) {
+        if (const Label* label = labels.lookup(name)) return addressOf(*label);
+    }
+    return loadAddress;
+}
+
+auto writeExecutableElf(int fd, const Image& image, const LabelSet& labels,
+                        uint32_t loadAddress, uint32_t entryAddress, const SymbolNames& globals) -> bool {
+    return writeAll(fd, buildExecutableElf(image, labels, loadAddress, entryAddress, globals));
+}
+
+}
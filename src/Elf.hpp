@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Assembler.hpp"
+#include "Image.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// An ELF32 little-endian relocatable object (ET_REL) for RV32I, with `.text`, `.rela.text`,
+/// `.symtab` and `.strtab`.
+/// Labels become symbols at their offset into `.text` - local ones, unless they're in `globals`.
+/// The symbols the relocations refer to become undefined globals for the linker to find.
+auto buildRelocatableElf(const Image& image, const LabelSet& labels, const SymbolNames& globals = {}) -> vector<uint8_t>;
+/// Returns false if the write fell short.
+auto writeRelocatableElf(FILE* f, const Image& image, const LabelSet& labels, const SymbolNames& globals = {}) -> bool;
+
+/// An ELF32 executable (ET_EXEC) with the text in one PT_LOAD segment at `loadAddress` and the
+/// labels as symbols, for Spike, QEMU or objdump to take as is.
+auto buildExecutableElf(const Image& image, const LabelSet& labels,
+                        uint32_t loadAddress, uint32_t entryAddress, const SymbolNames& globals = {}) -> vector<uint8_t>;
+/// The address of the `entry` label, or of `_start` or `__begin` if none was asked for, or else
+/// just `loadAddress`. Empty if the asked-for label doesn't exist.
+auto entryPointFor(const LabelSet& labels, const optional<string>& entry, uint32_t loadAddress) -> optional<uint32_t>;
+/// Writes the whole file from the start of `fd` with pwrite(2). Returns false if that fails.
+auto writeExecutableElf(int fd, const Image& image, const LabelSet& labels,
+                        uint32_t loadAddress, uint32_t entryAddress, const SymbolNames& globals = {}) -> bool;
+
+}
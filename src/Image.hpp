@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// A reference to a symbol this file doesn't define, for whatever links it to fill in.
+struct Relocation {
+    enum class Type : unsigned short { branch, jal };
+
+    /// Byte offset of the instruction to patch, from the start of the image.
+    uint32_t offset = 0;
+    string symbol{};
+    Type type = Type::branch;
+    /// Where it came from, for error messages.
+    int lineNumber = 0;
+};
+
+/// The assembled program, as it will sit in memory.
+/// RISC-V instruction parcels are always little-endian, whatever the host is, so the bytes here are
+/// laid out exactly as the core will fetch them.
+struct Image {
+    vector<uint8_t> bytes{};
+    /// Branches and jumps to labels that weren't found, in the order they were emitted.
+    vector<Relocation> relocations{};
+    /// Some of the instructions are 2-byte RVC ones - see Compression.hpp.
+    bool compressed = false;
+
+    auto appendWord(uint32_t word) -> void {
+        bytes.push_back(word & 0xff);
+        bytes.push_back((word >> 8) & 0xff);
+        bytes.push_back((word >> 16) & 0xff);
+        bytes.push_back((word >> 24) & 0xff);
+    }
+
+    /// For when the image has been sized up front and is filled in out of order.
+    auto setWordAt(size_t byteOffset, uint32_t word) -> void {
+        bytes[byteOffset] = word & 0xff;
+        bytes[byteOffset + 1] = (word >> 8) & 0xff;
+        bytes[byteOffset + 2] = (word >> 16) & 0xff;
+        bytes[byteOffset + 3] = (word >> 24) & 0xff;
+    }
+
+    /// Reads the 32-bit little-endian word starting at the given byte offset.
+    [[nodiscard]]
+    auto wordAt(size_t byteOffset) const -> uint32_t {
+        return  (uint32_t) bytes[byteOffset]
+             | ((uint32_t) bytes[byteOffset + 1] << 8)
+             | ((uint32_t) bytes[byteOffset + 2] << 16)
+             | ((uint32_t) bytes[byteOffset + 3] << 24);
+    }
+
+    [[nodiscard]]
+    auto size() const -> size_t { return bytes.size(); }
+
+    auto clear() -> void {
+        bytes.clear();
+        relocations.clear();
+        compressed = false;
+    }
+};
+
+}
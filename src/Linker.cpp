@@ -0,0 +1,263 @@
+#include "Linker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+#include "Alignment.hpp"
+#include "Parallel.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+namespace {
+
+template<typename T>
+auto readAt(const string& contents, size_t offset) -> T {
+    T value;
+    memcpy(&value, contents.data() + offset, sizeof(T));
+    return value;
+}
+
+/// So that one object's problems come out in one piece, whatever the other threads are doing.
+mutex reportLock{};
+
+template<typename... Args>
+auto report(const char* format, Args... args) -> void {
+    lock_guard lock{reportLock};
+    fprintf(stderr, format, args...);
+}
+
+auto invalid(const ObjectFile& object, const char* why) -> bool {
+    report(RED "Error:" RESET " '%s' %s.\n", object.path.c_str(), why);
+    return false;
+}
+
+}
+
+auto ObjectFile::symbolName(const Elf32_Sym& symbol) const -> string_view {
+    if (symbol.st_name >= stringsSize) return {};
+    return contents.data() + stringsOffset + symbol.st_name;
+}
+
+auto parseObjectFile(ObjectFile& object) -> bool {
+    const auto& contents = object.contents;
+    if (contents.size() < sizeof(Elf32_Ehdr)) return invalid(object, "is too small to be an object file");
+
+    const auto header = readAt<Elf32_Ehdr>(contents, 0);
+    if (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) return invalid(object, "isn't an ELF file");
+    if (header.e_ident[EI_CLASS] != ELFCLASS32 or header.e_ident[EI_DATA] != ELFDATA2LSB
+        or header.e_machine != EM_RISCV or header.e_type != ET_REL) {
+        return invalid(object, "isn't an RV32 relocatable object");
+    }
+    if (header.e_shentsize != sizeof(Elf32_Shdr)
+        or header.e_shoff + (size_t) header.e_shnum * sizeof(Elf32_Shdr) > contents.size()
+        or header.e_shstrndx >= header.e_shnum) {
+        return invalid(object, "has a broken section header table");
+    }
+
+    vector<Elf32_Shdr> sections(header.e_shnum);
+    for (size_t i = 0; i < sections.size(); i++) {
+        sections[i] = readAt<Elf32_Shdr>(contents, header.e_shoff + i * sizeof(Elf32_Shdr));
+        if (sections[i].sh_type != SHT_NOBITS and sections[i].sh_offset + (size_t) sections[i].sh_size > contents.size()) {
+            return invalid(object, "has a section that runs off the end of it");
+        }
+    }
+    const auto& names = sections[header.e_shstrndx];
+    auto nameOf = [&](const Elf32_Shdr& s) -> string_view {
+        if (s.sh_name >= names.sh_size) return {};
+        return contents.data() + names.sh_offset + s.sh_name;
+    };
+
+    optional<size_t> symtab, rela;
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (nameOf(sections[i]) == ".text") {
+            object.textSection = (uint16_t) i;
+            object.textOffset = sections[i].sh_offset;
+            object.textSize = sections[i].sh_size;
+            object.textAlignment = max<uint32_t>(sections[i].sh_addralign, 4);
+        } else if (sections[i].sh_type == SHT_SYMTAB) {
+            symtab = i;
+        } else if (sections[i].sh_type == SHT_RELA and sections[i].sh_info < sections.size()
+                   and nameOf(sections[sections[i].sh_info]) == ".text") {
+            rela = i;
+        }
+    }
+    if (object.textSection == 0) return invalid(object, "has no .text section");
+    if (object.textSize % 4 != 0) return invalid(object, "has a .text that isn't whole instructions");
+    if ((object.textAlignment & (object.textAlignment - 1)) != 0) return invalid(object, "has a .text aligned to something that isn't a power of two");
+    if (not symtab or sections[*symtab].sh_link >= sections.size()) return invalid(object, "has no symbol table");
+
+    const auto& strtab = sections[sections[*symtab].sh_link];
+    object.stringsOffset = strtab.sh_offset;
+    object.stringsSize = strtab.sh_size;
+
+    object.symbols.resize(sections[*symtab].sh_size / sizeof(Elf32_Sym));
+    if (not object.symbols.empty()) {
+        memcpy(object.symbols.data(), contents.data() + sections[*symtab].sh_offset, object.symbols.size() * sizeof(Elf32_Sym));
+    }
+
+    if (rela) {
+        object.relocations.resize(sections[*rela].sh_size / sizeof(Elf32_Rela));
+        if (not object.relocations.empty()) {
+            memcpy(object.relocations.data(), contents.data() + sections[*rela].sh_offset, object.relocations.size() * sizeof(Elf32_Rela));
+        }
+        for (const auto& relocation : object.relocations) {
+            if (ELF32_R_SYM(relocation.r_info) >= object.symbols.size() or relocation.r_offset + 4 > object.textSize) {
+                return invalid(object, "has a relocation that's out of bounds");
+            }
+        }
+    }
+
+    return true;
+}
+
+auto readObjectFile(const string& path, ObjectFile& object) -> bool {
+    object.path = path;
+    object.contents = readFileToString(path);
+    if (object.contents.empty()) return invalid(object, "couldn't be read");
+    return parseObjectFile(object);
+}
+
+auto ConcurrentSymbolTable::shardFor(string_view name) -> Shard& {
+    // The top bits - the maps inside use the bottom ones.
+    return shards[(hash<string_view>{}(name) >> 32) % shardCount];
+}
+
+auto ConcurrentSymbolTable::shardFor(string_view name) const -> const Shard& {
+    return shards[(hash<string_view>{}(name) >> 32) % shardCount];
+}
+
+auto ConcurrentSymbolTable::define(string_view name, Definition definition) -> optional<Definition> {
+    auto& shard = shardFor(name);
+    lock_guard lock{shard.lock};
+    auto [ it, inserted ] = shard.symbols.emplace(name, definition);
+    if (inserted) return {};
+    return it->second;
+}
+
+auto ConcurrentSymbolTable::find(string_view name) const -> const Definition* {
+    const auto& shard = shardFor(name);
+    auto it = shard.symbols.find(name);
+    return it == shard.symbols.end() ? nullptr : &it->second;
+}
+
+auto patchBranch(uint32_t& instruction, int32_t byteOffset) -> bool {
+    if (byteOffset % 2 != 0 or byteOffset < -(1 << 12) or byteOffset >= (1 << 12)) return false;
+
+    const auto imm = (uint32_t) byteOffset;
+    instruction &= 0x01fff07f;
+    instruction |= ((imm >> 12) & 0x1) << 31;
+    instruction |= ((imm >> 5) & 0x3f) << 25;
+    instruction |= ((imm >> 1) & 0xf) << 8;
+    instruction |= ((imm >> 11) & 0x1) << 7;
+    return true;
+}
+
+auto patchJal(uint32_t& instruction, int32_t byteOffset) -> bool {
+    if (byteOffset % 2 != 0 or byteOffset < -(1 << 20) or byteOffset >= (1 << 20)) return false;
+
+    const auto imm = (uint32_t) byteOffset;
+    instruction &= 0x00000fff;
+    instruction |= ((imm >> 20) & 0x1) << 31;
+    instruction |= ((imm >> 1) & 0x3ff) << 21;
+    instruction |= ((imm >> 11) & 0x1) << 20;
+    instruction |= ((imm >> 12) & 0xff) << 12;
+    return true;
+}
+
+auto link(vector<ObjectFile>& objects, uint32_t base, unsigned jobs,
+          Image& image, ConcurrentSymbolTable& globals) -> bool {
+    // Layout is just one after the other, so it's a running sum - rounded up to each one's alignment.
+    // That's alignment in memory, so from address 0 rather than from the base.
+    size_t size = 0;
+    for (auto& object : objects) {
+        size += paddingFor((uint32_t) (base + size), object.textAlignment);
+        object.offset = (uint32_t) size;
+        size += object.textSize;
+    }
+
+    image.clear();
+    image.bytes.resize(size);
+    // The gaps rounding up left are nops - they might be run through. (A base that isn't a multiple
+    // of 4 leaves a few bytes before the first object that can't be.)
+    size_t end = 0;
+    for (const auto& object : objects) {
+        for (; end + 4 <= object.offset; end += 4) image.setWordAt(end, 0x00000013);
+        end = object.offset + object.textSize;
+    }
+
+    atomic<bool> ok{true};
+
+    parallelFor(objects.size(), jobs, [&](size_t i) {
+        const auto& object = objects[i];
+        if (object.textSize) {
+            memcpy(image.bytes.data() + object.offset, object.contents.data() + object.textOffset, object.textSize);
+        }
+
+        for (const auto& symbol : object.symbols) {
+            if (ELF32_ST_BIND(symbol.st_info) != STB_GLOBAL or symbol.st_shndx != object.textSection) continue;
+
+            const auto name = object.symbolName(symbol);
+            const auto earlier = globals.define(name, {object.offset + symbol.st_value, (uint32_t) i});
+            if (earlier) {
+                report(RED "Error:" RESET " '" YELLOW "%.*s" RESET "' is defined in both '%s' and '%s'.\n",
+                       (int) name.size(), name.data(), objects[earlier->object].path.c_str(), object.path.c_str());
+                ok = false;
+            }
+        }
+    });
+    if (not ok) return false;
+
+    parallelFor(objects.size(), jobs, [&](size_t i) {
+        const auto& object = objects[i];
+
+        for (const auto& relocation : object.relocations) {
+            const auto& symbol = object.symbols[ELF32_R_SYM(relocation.r_info)];
+
+            uint32_t target;
+            if (symbol.st_shndx == SHN_UNDEF) {
+                const auto name = object.symbolName(symbol);
+                const auto* definition = globals.find(name);
+                if (not definition) {
+                    report(RED "Error:" RESET " Undefined reference to '" YELLOW "%.*s" RESET "' in '%s'.\n",
+                           (int) name.size(), name.data(), object.path.c_str());
+                    ok = false;
+                    continue;
+                }
+                target = definition->offset;
+            } else {
+                target = object.offset + symbol.st_value;
+            }
+
+            const uint32_t at = object.offset + relocation.r_offset;
+            const auto offset = (int32_t) (target + relocation.r_addend - at);
+
+            uint32_t instruction = image.wordAt(at);
+            bool fits;
+            switch (ELF32_R_TYPE(relocation.r_info)) {
+                case R_RISCV_BRANCH: fits = patchBranch(instruction, offset); break;
+                case R_RISCV_JAL: fits = patchJal(instruction, offset); break;
+                default:
+                    report(RED "Error:" RESET " '%s' has a relocation of a type (%u) that isn't supported.\n",
+                           object.path.c_str(), ELF32_R_TYPE(relocation.r_info));
+                    ok = false;
+                    continue;
+            }
+            if (not fits) {
+                const auto name = object.symbolName(symbol);
+                report(RED "Error:" RESET " '" YELLOW "%.*s" RESET "' is out of reach from 0x%x in '%s'.\n",
+                       (int) name.size(), name.data(), base + at, object.path.c_str());
+                ok = false;
+                continue;
+            }
+            image.setWordAt(at, instruction);
+        }
+    });
+
+    return ok;
+}
+
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <elf.h>
+
+#include "Assembler.hpp"
+#include "Image.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// One of our ELF32 relocatable objects (see buildRelocatableElf), read in whole.
+/// The symbol names are views into `contents`.
+struct ObjectFile {
+    string path{};
+    string contents{};
+
+    /// Offset and size of `.text` in `contents`.
+    size_t textOffset = 0;
+    size_t textSize = 0;
+    uint16_t textSection = 0;
+    /// What its text has to start on a multiple of, in memory - at least a word.
+    uint32_t textAlignment = 4;
+
+    vector<Elf32_Sym> symbols{};
+    /// Offset and size of the symbols' string table in `contents` - not a view of it, so an
+    /// ObjectFile can be copied.
+    size_t stringsOffset = 0;
+    size_t stringsSize = 0;
+    vector<Elf32_Rela> relocations{};
+
+    /// Where its text starts in the linked image, as an offset from the base address.
+    uint32_t offset = 0;
+
+    [[nodiscard]]
+    auto symbolName(const Elf32_Sym& symbol) const -> string_view;
+};
+
+/// Reads and checks an object file. Prints what's wrong with it (and returns false) if it isn't
+/// an RV32 relocatable object with a `.text`.
+auto readObjectFile(const string& path, ObjectFile& object) -> bool;
+/// The same, for an object already in memory.
+auto parseObjectFile(ObjectFile& object) -> bool;
+
+/// The global symbols of every object being linked, sharded so that objects can add theirs from
+/// many threads at once. Once they're all in, lookups need no locking.
+class ConcurrentSymbolTable {
+public:
+    struct Definition {
+        /// From the base address.
+        uint32_t offset = 0;
+        /// Index of the object it's defined in.
+        uint32_t object = 0;
+    };
+
+    /// Returns the existing definition, if there already was one.
+    auto define(string_view name, Definition definition) -> optional<Definition>;
+    [[nodiscard]]
+    auto find(string_view name) const -> const Definition*;
+
+    template<typename Fn>
+    auto forEach(Fn&& fn) const -> void {
+        for (const auto& shard : shards) {
+            for (const auto& [ name, definition ] : shard.symbols) fn(name, definition);
+        }
+    }
+
+private:
+    static constexpr size_t shardCount = 64;
+
+    struct Shard {
+        mutex lock{};
+        unordered_map<string_view, Definition> symbols{};
+    };
+
+    array<Shard, shardCount> shards{};
+
+    auto shardFor(string_view name) -> Shard&;
+    [[nodiscard]]
+    auto shardFor(string_view name) const -> const Shard&;
+};
+
+/// Puts a B-type or J-type instruction's target `byteOffset` from it into its immediate.
+/// Returns false if the offset is out of range for it, or odd.
+auto patchBranch(uint32_t& instruction, int32_t byteOffset) -> bool;
+auto patchJal(uint32_t& instruction, int32_t byteOffset) -> bool;
+
+/// Lays the objects' text out one after the other from `base`, resolves the global symbols and
+/// applies every relocation, `jobs` threads at a time (0 for one per hardware thread).
+/// Prints every problem it finds (duplicate or undefined symbols, out of range branches) and
+/// returns false if there were any.
+auto link(vector<ObjectFile>& objects, uint32_t base, unsigned jobs,
+          Image& image, ConcurrentSymbolTable& globals) -> bool;
+
+}
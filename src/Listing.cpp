@@ -0,0 +1,59 @@
+#include "Listing.hpp"
+
+#include "Assembler.hpp"
+
+namespace DcsEmbler {
+
+namespace {
+
+/// `00000000  00000000  ` - address, encoding and the gaps after them.
+constexpr size_t columnsWidth = 8 + 2 + 8 + 2;
+
+}
+
+ListingWriter::ListingWriter(FILE* f) : writer(make_unique<BlockWriter>(f)) {}
+
+auto ListingWriter::line(string_view source, int first, int end) -> void {
+    // Windows line endings would otherwise end up in the middle of the listing's.
+    if (not source.empty() and source.back() == '\r') source.remove_suffix(1);
+
+    if (first == end) {
+        writer->repeat(' ', source.empty() ? 0 : columnsWidth);
+        writer->text(source);
+        writer->character('\n');
+        return;
+    }
+
+    for (int index = first; index < end; index++) {
+        writer->hex((uint32_t) instructionIndexToAddress(index), 8);
+        writer->text("  ");
+        writer->hex(image.wordAt((size_t) index * 4), 8);
+        if (index == first and not source.empty()) {
+            writer->text("  ");
+            writer->text(source);
+        }
+        writer->character('\n');
+    }
+}
+
+auto ListingWriter::finish() -> bool {
+    writer->flush();
+    return writer->ok;
+}
+
+auto emitWithListing(char* text, size_t size, FILE* listing) -> bool {
+    ListingWriter writer{listing};
+    // Reused for every line, so it only allocates when a line is longer than any before it.
+    string source;
+
+    forEachLine(text, size, [&](char* line, int lineNumber) {
+        source.assign(line);
+        const int first = instructionIndex;
+        handleLine(firstToken(line), lineNumber);
+        writer.line(source, first, instructionIndex);
+    });
+
+    return writer.finish();
+}
+
+}
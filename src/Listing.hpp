@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "BlockWriter.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Writes a listing - a line for each line of source, with the address and encoding of what it
+/// assembled to in front:
+///
+///     00000000  00500093  loop: addi x1, x0, 5
+///                         # A comment
+///     00000004  000010B7  li x1, 4096
+///     00000008  00008093
+///
+/// A line that comes out as more than one instruction (`li`) gets a line to itself for each of the
+/// rest. Lines that come out as nothing leave the columns blank.
+struct ListingWriter {
+    explicit ListingWriter(FILE* f);
+
+    /// `source`, which made the instructions numbered `first` up to (not including) `end`.
+    /// Their encodings are read back from the image.
+    auto line(string_view source, int first, int end) -> void;
+
+    /// Flushes what's left. Returns false if anything failed to write.
+    auto finish() -> bool;
+
+private:
+    unique_ptr<BlockWriter> writer;
+};
+
+/// The (serial) emit pass over `text`, writing a listing of it as it goes - the source text of each
+/// line is kept aside before it's tokenized, so it doesn't have to be read twice.
+/// Returns false if the listing failed to write.
+auto emitWithListing(char* text, size_t size, FILE* listing) -> bool;
+
+}
@@ -0,0 +1,247 @@
+#include "LiteralPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <strings.h>
+
+#include "Assembler.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+LiteralPool literalPool{};
+
+namespace {
+
+/// What an lw's sign-extended 12-bit offset reaches from x0, each way.
+constexpr uint32_t reach = 2048;
+/// Pointing 2 KiB into the pool, x3 reaches this many constants.
+constexpr size_t gpCapacity = 2 * reach / 4;
+/// A lui and an addi.
+constexpr int gpSetupWords = 2;
+
+/// Whether any of the operands is x3.
+auto mentionsGp(char* const tokens[], size_t tokenCount) -> bool {
+    for (size_t i = 1; i < tokenCount; i++) {
+        const char* token = tokens[i];
+        if ((token[0] == 'x' or token[0] == 'X') and isdigit((unsigned char) token[1])
+            and atoi(token + 1) == (int) gpRegister) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Whether an executable starts at an entry label somewhere other than its first instruction - so
+/// wouldn't run x3's setup. Anything else starts at the start of memory.
+auto entryIsElsewhere() -> bool {
+    if (*opts.format != Format::executable) return false;
+
+    const Label* entry = nullptr;
+    if (opts.entry) {
+        entry = labels.lookup(*opts.entry);
+    } else {
+        for (const char* name : {"_start", "__begin"}) {
+            if (not entry) entry = labels.lookup(name);
+        }
+    }
+    return entry and entry->instructionIndex != 0;
+}
+
+/// The constant, if these tokens are an `li` of one that takes a lui and an addi.
+auto largeConstant(char* const tokens[], size_t tokenCount) -> optional<uint32_t> {
+    if (tokenCount < 3 or strcasecmp(tokens[0], "li") != 0) return {};
+    const uint32_t value = immediateValue(tokens[2]);
+    const auto [ upper, lower ] = loadImmediateParts(value);
+    if (upper == 0 or lower == 0) return {};
+    return value;
+}
+
+/// Picks, most used first, the constants worth pooling that still fit in reach where the pool would
+/// go - no more than `capacity` of them. Off x3, wherever it goes is in reach.
+auto plan(const vector<pair<uint32_t, LiteralUses>>& candidates, size_t capacity) -> void {
+    literalPool.constants.clear();
+    literalPool.slots.clear();
+    literalPool.loads = 0;
+
+    // Each use before the pool is an instruction less in front of it.
+    int pooledBefore = 0;
+    for (const auto& [ value, uses ] : candidates) {
+        if (literalPool.constants.size() == capacity) break;
+        const int index = literalPool.countedIndex - pooledBefore - (int) uses.usesBefore;
+        const auto address = (uint32_t) instructionIndexToAddress(index);
+        if (literalPool.base == 0 and not withinReachOfX0(address, 4 * (uint32_t) (literalPool.constants.size() + 1))) {
+            continue;
+        }
+
+        pooledBefore += (int) uses.usesBefore;
+        literalPool.slots.emplace(value, (int) literalPool.constants.size());
+        literalPool.constants.push_back(value);
+        literalPool.loads += uses.uses;
+    }
+    literalPool.leftOut = candidates.size() - literalPool.constants.size();
+}
+
+/// How many words what's been planned saves.
+auto saving() -> int64_t {
+    if (literalPool.constants.empty()) return 0;
+    const int64_t setup = literalPool.base == gpRegister ? gpSetupWords : 0;
+    return (int64_t) literalPool.loads - (int64_t) literalPool.constants.size() - setup;
+}
+
+}
+
+auto withinReachOfX0(uint32_t address, uint32_t bytes) -> bool {
+    const uint64_t end = (uint64_t) address + bytes;
+    return end <= reach or (address >= 0u - reach and end <= 1ull << 32);
+}
+
+auto noteLiteral(char* const tokens[], size_t tokenCount, int lineNumber) -> void {
+    if (not *opts.literalPool or tokenCount == 0) return;
+
+    if (literalPool.counting) {
+        if (not literalPool.programUsesGp) literalPool.programUsesGp = mentionsGp(tokens, tokenCount);
+    } else if (literalPool.base == gpRegister and literalPool.setupLine == 0
+               and instructionCountFor(tokens, tokenCount) > 0) {
+        // In front of the first instruction - so any label before it is on the setup.
+        literalPool.setupLine = lineNumber;
+        instructionIndex += gpSetupWords;
+    }
+
+    if (strcmp(tokens[0], ".ltorg") == 0) {
+        if (literalPool.counting and literalPool.lineNumber == 0) {
+            literalPool.lineNumber = lineNumber;
+            literalPool.countedIndex = instructionIndex;
+        } else if (lineNumber == literalPool.lineNumber and not literalPool.constants.empty()) {
+            labels.insert_or_assign(literalPoolLabel, Label{instructionIndex, lineNumber});
+            instructionIndex += (int) literalPool.constants.size();
+        }
+    } else if (literalPool.counting) {
+        if (const auto value = largeConstant(tokens, tokenCount)) {
+            auto& uses = literalPool.uses[*value];
+            uses.uses++;
+            if (literalPool.lineNumber == 0) uses.usesBefore++;
+        }
+    }
+}
+
+auto noteLiteralPoolEnd() -> void {
+    if (not *opts.literalPool or literalPool.lineNumber != 0) return;
+
+    if (literalPool.counting) {
+        literalPool.countedIndex = instructionIndex;
+    } else if (not literalPool.constants.empty()) {
+        labels.insert_or_assign(literalPoolLabel, Label{instructionIndex, 0});
+        instructionIndex += (int) literalPool.constants.size();
+    }
+}
+
+auto literalSlot(uint32_t value) -> int {
+    if (literalPool.slots.empty()) return -1;
+    const auto slot = literalPool.slots.find(value);
+    return slot != literalPool.slots.end() ? slot->second : -1;
+}
+
+auto layOutLiteralPool(const function<int()>& labelPass) -> int {
+    literalPool = LiteralPool{};
+    literalPool.counting = true;
+    int instructionCount = labelPass();
+    literalPool.counting = false;
+    literalPool.entryElsewhere = entryIsElsewhere();
+
+    auto layOut = [&] {
+        literalPool.setupLine = 0;
+        return labelPass();
+    };
+
+    vector<pair<uint32_t, LiteralUses>> candidates{};
+    for (const auto& [ value, uses ] : literalPool.uses) {
+        if (uses.uses >= 2) candidates.emplace_back(value, uses);
+    }
+    sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return a.second.uses != b.second.uses ? a.second.uses > b.second.uses : a.first < b.first;
+    });
+
+    // Off x3 if, setup and all, that saves more than what's in reach of x0 does. It follows the pool
+    // wherever it ends up, so once is enough.
+    if (not literalPool.programUsesGp and not literalPool.entryElsewhere) {
+        literalPool.base = gpRegister;
+        plan(candidates, gpCapacity);
+        const int64_t offGp = saving();
+        literalPool.base = 0;
+        plan(candidates, candidates.size());
+        if (offGp > saving()) {
+            literalPool.base = gpRegister;
+            plan(candidates, gpCapacity);
+            instructionCount = layOut();
+            literalPool.address = (uint32_t) instructionIndexToAddress(labels.lookup(literalPoolLabel)->instructionIndex);
+            literalPool.baseAddress = literalPool.address + reach;
+            return instructionCount;
+        }
+    }
+
+    size_t capacity = candidates.size();
+    for (bool laidOut = false;; laidOut = true) {
+        plan(candidates, capacity);
+        // Without anything pooled, the counting pass laid the program out as it is - unless a pass
+        // since has pooled something.
+        if (literalPool.constants.empty()) return laidOut ? layOut() : instructionCount;
+
+        instructionCount = layOut();
+        literalPool.address = (uint32_t) instructionIndexToAddress(labels.lookup(literalPoolLabel)->instructionIndex);
+        const size_t size = literalPool.constants.size();
+        if (withinReachOfX0(literalPool.address, 4 * (uint32_t) size)) return instructionCount;
+
+        // Relaxed branches or alignment padding in front of it moved it - try with what would fit there.
+        const uint32_t address = literalPool.address;
+        const size_t fits = address < reach ? (reach - address) / 4 : address >= 0u - reach ? (0u - address) / 4 : 0;
+        capacity = min(size - 1, fits);
+    }
+}
+
+auto emitLiteralPool() -> void {
+    for (const uint32_t constant : literalPool.constants) emitInstruction(constant);
+}
+
+auto emitLiteralPoolSetup() -> void {
+    const uint32_t LUI = 0b0110111;
+    const uint32_t ADDI = 0b0010011;
+    const auto [ upper, lower ] = loadImmediateParts(literalPool.baseAddress);
+    emitInstruction((upper << 12) | (gpRegister << 7) | LUI);
+    emitInstruction((((uint32_t) lower & 0xfff) << 20) | (gpRegister << 15) | (gpRegister << 7) | ADDI);
+}
+
+auto printLiteralPoolReport(FILE* f) -> void {
+    const size_t size = literalPool.constants.size();
+    if (size == 0) {
+        fputs("Literal pool: nothing worth pooling in reach.\n", f);
+    } else {
+        fprintf(f, "Literal pool: " YELLOW "%zu" RESET " constants at " GREEN "0x%08X" RESET ", loaded off x%u by %" PRIu64
+                   " li's - %" PRId64 " bytes smaller.\n",
+                size, literalPool.address, literalPool.base, literalPool.loads, 4 * saving());
+    }
+    if (literalPool.leftOut == 0) return;
+
+    if (literalPool.base == gpRegister) {
+        fprintf(f, YELLOW "Warning:" RESET " %zu more constants would have been worth pooling, but x3 only reaches"
+                   " %zu.\n", literalPool.leftOut, gpCapacity);
+    } else if (literalPool.programUsesGp or literalPool.entryElsewhere) {
+        fprintf(f, YELLOW "Warning:" RESET " %zu more constants would have been worth pooling, but don't fit in"
+                   " reach of address 0 - and the pool can't be loaded off x3 instead, as %s.\n",
+                literalPool.leftOut, literalPool.programUsesGp ? "the program uses x3 itself"
+                                                               : "the program starts at its entry label, not its"
+                                                                 " first instruction, where x3 would be set up");
+    } else {
+        fprintf(f, YELLOW "Warning:" RESET " %zu more constants would have been worth pooling, but don't fit in"
+                   " reach of address 0 (a .ltorg nearer the start of the program makes room) - and loading them"
+                   " off x3 instead wouldn't save enough to pay for setting it up.\n",
+                literalPool.leftOut);
+    }
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// How often the label pass saw `li` load a constant that takes two instructions.
+struct LiteralUses {
+    uint32_t uses = 0;
+    /// Of those, how many come before where the pool goes.
+    uint32_t usesBefore = 0;
+};
+
+/// With --literalPool: the large constants `li` loads, each stored once in a pool, so an `li` of
+/// one is a single `lw rd, offset(base)` instead of a lui and an addi.
+///
+/// RV32I has no PC-relative load, and an auipc and a lw are as long as what they'd replace - so
+/// the pool is loaded from off a register that's already pointing near it. The pool goes at the
+/// first `.ltorg` - somewhere execution never falls into, like straight after a jump - or else
+/// after the code. Then it's loaded off either:
+///
+///  - x0, whose 12-bit signed offset reaches the bottom 2 KiB of memory (and the top 2 KiB), so
+///    only as much of the pool as is in reach of that is used; or
+///  - x3 (gp), set to 2 KiB into the pool by a lui and an addi in front of the program's first
+///    instruction - so it reaches wherever the pool is, 1024 constants' worth. That's two words
+///    more, and the program can't use x3 itself - nor, in an executable, start anywhere else.
+///
+/// A constant is only pooled if that's smaller overall: n uses cost 2n words inline, and n + 1
+/// pooled - so from two uses on, plus whatever setting up x3 costs. Those used most go in first,
+/// off whichever base saves the most.
+struct LiteralPool {
+    /// Set while the label pass counts uses, rather than laying out what's been planned.
+    bool counting = false;
+    unordered_map<uint32_t, LiteralUses> uses{};
+    /// The first `.ltorg`'s line - 0 for after the code.
+    int lineNumber = 0;
+    /// Where the pool went, in instructions, when the label pass counted uses - without anything
+    /// pooled, and before relaxation and alignment padding.
+    int countedIndex = 0;
+
+    /// What's in the pool, in order, and where each one is in it.
+    vector<uint32_t> constants{};
+    unordered_map<uint32_t, int> slots{};
+    /// Where the pool starts in memory, once it's been laid out.
+    uint32_t address = 0;
+    /// The register it's loaded off - 0, or gpRegister - and what that holds.
+    unsigned int base = 0;
+    uint32_t baseAddress = 0;
+    /// The line x3 is set up on, in front of its first instruction - 0 for not (yet).
+    int setupLine = 0;
+    /// Why x3 can't be used, when it can't - as the label pass counting uses found.
+    bool programUsesGp = false;
+    bool entryElsewhere = false;
+    /// How many `li`s load from it.
+    uint64_t loads = 0;
+    /// How many constants would have been worth pooling, but didn't fit in reach.
+    size_t leftOut = 0;
+};
+
+/// Set up by layOutLiteralPool, read by the label and emit passes.
+extern LiteralPool literalPool;
+
+/// Labels where the pool starts, once there's anything in it.
+inline constexpr const char* literalPoolLabel = "__literal_pool";
+/// x3 - gp in the ABI.
+inline constexpr unsigned int gpRegister = 3;
+
+/// Whether every one of `bytes` from `address` on can be loaded with an offset from x0.
+auto withinReachOfX0(uint32_t address, uint32_t bytes) -> bool;
+
+/// For the label pass: counts the constant, if these tokens are an `li` of one that takes two
+/// instructions, and notes the first `.ltorg` - and once the pool's been planned, puts it there,
+/// and makes room for setting up x3 in front of the first instruction, if that's the base.
+auto noteLiteral(char* const tokens[], size_t tokenCount, int lineNumber) -> void;
+/// For the end of the label pass - the pool goes here if there wasn't a `.ltorg`.
+auto noteLiteralPoolEnd() -> void;
+
+/// Where `value` is in the pool - -1 if it isn't.
+auto literalSlot(uint32_t value) -> int;
+
+/// Runs `labelPass` (which has to start from scratch each time, and returns how many instructions
+/// there are, relaxed and padded out) once to count constants, then again with those worth pooling
+/// that fit - and, off x0, again with fewer, for as long as relaxation and alignment leave the pool
+/// out of reach. Returns the last pass's count.
+auto layOutLiteralPool(const function<int()>& labelPass) -> int;
+
+/// For the emit pass: the pool's words, on the `.ltorg`'s line or after the code.
+auto emitLiteralPool() -> void;
+/// For the emit pass: the lui and addi that point x3 at the pool, on setupLine.
+auto emitLiteralPoolSetup() -> void;
+
+auto printLiteralPoolReport(FILE* f) -> void;
+
+}
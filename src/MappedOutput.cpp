@@ -0,0 +1,59 @@
+#include "MappedOutput.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Assembler.hpp"
+#include "Parallel.hpp"
+
+namespace DcsEmbler {
+
+auto outputBytesPerInstruction(Format format) -> size_t {
+    switch (format) {
+        case Format::binary:
+        case Format::bin:
+            return 4;
+        case Format::hex:
+        case Format::hexadecimal:
+            return hexLineLength;
+        default:
+            return 0;
+    }
+}
+
+MappedOutput::~MappedOutput() {
+    close();
+}
+
+auto MappedOutput::open(FILE* f, size_t bytes) -> bool {
+    const int fd = fileno(f);
+    if (ftruncate(fd, (off_t) bytes) != 0) return false;
+
+    size = bytes;
+    // mmap won't map nothing.
+    if (bytes == 0) return true;
+
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    data = (uint8_t*) p;
+    return true;
+}
+
+auto MappedOutput::close() -> void {
+    if (data) munmap(data, size);
+    data = nullptr;
+}
+
+auto emitInParallel(char* text, size_t size, const vector<Checkpoint>& checkpoints, unsigned jobs) -> void {
+    parallelFor(checkpoints.size(), jobs, [&](size_t chunk) {
+        const auto& from = checkpoints[chunk];
+        const size_t to = chunk + 1 < checkpoints.size() ? checkpoints[chunk + 1].offset : size;
+
+        instructionIndex = from.instructionIndex;
+        forEachLine(text + from.offset, to - from.offset, [](char* line, int lineNumber) {
+            handleLine(firstToken(line), lineNumber);
+        }, from.lineNumber);
+    });
+}
+
+}
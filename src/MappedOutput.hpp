@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Options.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// A line the emit pass can start from without having seen the lines before it, as recorded by
+/// the label pass.
+struct Checkpoint {
+    /// Byte offset of the start of the line into the source.
+    size_t offset = 0;
+    int lineNumber = 1;
+    int instructionIndex = 0;
+};
+
+/// How many lines apart the label pass leaves checkpoints - the unit of work for each thread.
+inline constexpr int linesPerCheckpoint = 4096;
+
+/// How many bytes of output each instruction becomes, in formats whose output is one fixed-size
+/// record per instruction (binary and hex) - 0 for the rest, which can't be written this way.
+auto outputBytesPerInstruction(Format format) -> size_t;
+
+/// The output file truncated to its final size and mapped in writable, so instructions can be
+/// stored straight into it at their own offsets - no buffers, no ordering, no fwrite.
+struct MappedOutput {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+
+    MappedOutput() = default;
+    ~MappedOutput();
+
+    MappedOutput(const MappedOutput&) = delete;
+    auto operator=(const MappedOutput&) -> MappedOutput& = delete;
+
+    /// Returns false (with errno set) if the file couldn't be sized or mapped.
+    auto open(FILE* f, size_t bytes) -> bool;
+    /// Unmaps it. The kernel writes it back in its own time.
+    auto close() -> void;
+};
+
+/// The emit pass over `text`, split up at the checkpoints and shared out between `jobs` threads
+/// (0 for one per hardware thread).
+/// mappedOut and the image must already be sized for every instruction.
+auto emitInParallel(char* text, size_t size, const vector<Checkpoint>& checkpoints, unsigned jobs) -> void;
+
+}
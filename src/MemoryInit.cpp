@@ -0,0 +1,196 @@
+#include "MemoryInit.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+
+#include "BlockWriter.hpp"
+
+namespace DcsEmbler {
+
+namespace {
+
+/// Hands out the memory's words in order - the image's, then the fill.
+struct Words {
+    const Image& image;
+    unsigned bytesPerWord;
+    uint64_t fill;
+
+    /// How many words the image itself takes up (the last one maybe padded with fill bytes).
+    [[nodiscard]]
+    auto imageWords() const -> uint64_t { return (image.size() + bytesPerWord - 1) / bytesPerWord; }
+
+    [[nodiscard]]
+    auto at(uint64_t index) const -> uint64_t {
+        const uint64_t start = index * bytesPerWord;
+        if (start >= image.size()) return fill;
+
+        uint64_t word = 0;
+        for (unsigned b = 0; b < bytesPerWord; b++) {
+            const uint64_t byte = start + b < image.size() ? image.bytes[start + b]
+                                                          : (fill >> (8 * b)) & 0xff;
+            word |= byte << (8 * b);
+        }
+        return word;
+    }
+};
+
+auto depthOf(const MemoryGeometry& geometry, const Words& words) -> uint64_t {
+    return geometry.depth ? geometry.depth : words.imageWords();
+}
+
+auto hexDigitsFor(uint64_t n) -> unsigned {
+    unsigned digits = 1;
+    while (n >>= 4) digits++;
+    return digits;
+}
+
+auto writeReadmem(BlockWriter& w, const Words& words, uint64_t depth, unsigned width, bool hex) -> void {
+    for (uint64_t i = 0; i < depth; i++) {
+        if (hex) {
+            w.hex(words.at(i), (width + 3) / 4);
+        } else {
+            w.binary(words.at(i), width);
+        }
+        w.character('\n');
+    }
+}
+
+auto writeCoe(BlockWriter& w, const Words& words, uint64_t depth, unsigned width) -> void {
+    w.text("memory_initialization_radix=16;\nmemory_initialization_vector=\n");
+    for (uint64_t i = 0; i < depth; i++) {
+        w.hex(words.at(i), (width + 3) / 4);
+        w.text(i + 1 < depth ? ",\n" : ";\n");
+    }
+}
+
+auto writeMif(BlockWriter& w, const Words& words, uint64_t depth, unsigned width) -> void {
+    char header[128];
+    snprintf(header, sizeof(header), "WIDTH=%u;\nDEPTH=%" PRIu64 ";\n\n", width, depth);
+    w.text(header);
+    w.text("ADDRESS_RADIX=HEX;\nDATA_RADIX=HEX;\n\nCONTENT BEGIN\n");
+
+    const unsigned addressDigits = hexDigitsFor(depth ? depth - 1 : 0);
+    const uint64_t imageWords = min(words.imageWords(), depth);
+    for (uint64_t i = 0; i < imageWords; i++) {
+        w.character('\t');
+        w.hex(i, addressDigits);
+        w.text(" : ");
+        w.hex(words.at(i), (width + 3) / 4);
+        w.text(";\n");
+    }
+
+    if (imageWords + 1 < depth) {
+        w.text("\t[");
+        w.hex(imageWords, addressDigits);
+        w.text("..");
+        w.hex(depth - 1, addressDigits);
+        w.text("] : ");
+        w.hex(words.fill, (width + 3) / 4);
+        w.text(";\n");
+    } else if (imageWords < depth) {
+        w.character('\t');
+        w.hex(imageWords, addressDigits);
+        w.text(" : ");
+        w.hex(words.fill, (width + 3) / 4);
+        w.text(";\n");
+    }
+
+    w.text("END;\n");
+}
+
+/// `:LLAAAATT<data>CC` - the checksum makes the bytes of the record sum to 0.
+auto intelHexRecord(BlockWriter& w, uint8_t type, uint16_t address, const uint8_t* data, unsigned length) -> void {
+    unsigned sum = length + (address >> 8) + (address & 0xff) + type;
+    w.character(':');
+    w.hex(length, 2);
+    w.hex(address, 4);
+    w.hex(type, 2);
+    for (unsigned i = 0; i < length; i++) {
+        w.hex(data[i], 2);
+        sum += data[i];
+    }
+    w.hex((0x100 - (sum & 0xff)) & 0xff, 2);
+    w.character('\n');
+}
+
+auto writeIntelHex(BlockWriter& w, const Words& words, uint64_t depth) -> void {
+    constexpr uint8_t data = 0x00, endOfFile = 0x01, extendedLinearAddress = 0x04;
+
+    uint64_t upper = 0;
+    for (uint64_t i = 0; i < depth; i++) {
+        if ((i >> 16) != upper) {
+            upper = i >> 16;
+            const uint8_t bytes[2] = {(uint8_t) (upper >> 8), (uint8_t) upper};
+            intelHexRecord(w, extendedLinearAddress, 0, bytes, 2);
+        }
+
+        // Most significant byte first, which is how Quartus puts a word back together.
+        uint8_t bytes[8];
+        const uint64_t word = words.at(i);
+        for (unsigned b = 0; b < words.bytesPerWord; b++) {
+            bytes[b] = (uint8_t) (word >> (8 * (words.bytesPerWord - 1 - b)));
+        }
+        intelHexRecord(w, data, (uint16_t) i, bytes, words.bytesPerWord);
+    }
+
+    intelHexRecord(w, endOfFile, 0, nullptr, 0);
+}
+
+}
+
+auto isMemoryInitFormat(Format format) -> bool {
+    switch (format) {
+        case Format::readmemh:
+        case Format::readmemb:
+        case Format::coe:
+        case Format::mif:
+        case Format::ihex:
+            return true;
+        default:
+            return false;
+    }
+}
+
+auto checkMemoryGeometry(const MemoryGeometry& geometry, const Image& image) -> bool {
+    if (geometry.wordWidth == 0 or geometry.wordWidth > 64 or geometry.wordWidth % 8 != 0) {
+        fprintf(stderr, " [Error]: Memory word width must be 8, 16, 24 ... or 64 bits, not %u.\n", geometry.wordWidth);
+        return false;
+    }
+
+    const Words words{image, geometry.wordWidth / 8, geometry.fill};
+    if (geometry.depth and words.imageWords() > geometry.depth) {
+        fprintf(stderr, " [Error]: The program needs %" PRIu64 " words of memory, but it's only %" PRIu64 " deep.\n",
+                words.imageWords(), geometry.depth);
+        return false;
+    }
+    // Intel HEX only has 32 bits of address to go round.
+    if (depthOf(geometry, words) > (uint64_t) 1 << 32) {
+        fprintf(stderr, " [Error]: Memories over 2^32 words deep aren't supported.\n");
+        return false;
+    }
+    return true;
+}
+
+auto writeMemoryInit(FILE* f, const Image& image, Format format, const MemoryGeometry& geometry) -> bool {
+    // Big enough not to be on the stack.
+    auto w = make_unique<BlockWriter>(f);
+    const Words words{image, geometry.wordWidth / 8, geometry.fill};
+    const uint64_t depth = depthOf(geometry, words);
+
+    switch (format) {
+        case Format::readmemh: writeReadmem(*w, words, depth, geometry.wordWidth, true); break;
+        case Format::readmemb: writeReadmem(*w, words, depth, geometry.wordWidth, false); break;
+        case Format::coe: writeCoe(*w, words, depth, geometry.wordWidth); break;
+        case Format::mif: writeMif(*w, words, depth, geometry.wordWidth); break;
+        case Format::ihex: writeIntelHex(*w, words, depth); break;
+        default: return false;
+    }
+
+    w->flush();
+    return w->ok;
+}
+
+}
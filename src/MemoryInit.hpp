@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Image.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// The shape of the block RAM being initialised.
+struct MemoryGeometry {
+    /// In words. 0 means just big enough for the image.
+    uint64_t depth = 0;
+    /// In bits - a whole number of bytes, up to 64. Words are made of consecutive image bytes,
+    /// little-endian, so a 64 bit memory holds two instructions a word.
+    unsigned wordWidth = 32;
+    /// What the words past the end of the image are set to.
+    uint64_t fill = 0;
+};
+
+/// Whether a format is one of the FPGA memory initialisation ones below.
+auto isMemoryInitFormat(Format format) -> bool;
+
+/// Checks the geometry makes sense and that the image fits. Prints why not, if it doesn't.
+auto checkMemoryGeometry(const MemoryGeometry& geometry, const Image& image) -> bool;
+
+/// Writes the image (padded out to the memory's depth) as
+///  - readmemh / readmemb: Verilog `$readmemh`/`$readmemb`, a word per line.
+///  - coe: a Xilinx coefficients file.
+///  - mif: an Intel memory initialisation file, with the padding as one range.
+///  - ihex: Intel HEX the way Quartus reads it for memories - a checksummed record per word, at
+///    its word address.
+/// Returns false if the write fell short.
+auto writeMemoryInit(FILE* f, const Image& image, Format format, const MemoryGeometry& geometry) -> bool;
+
+}
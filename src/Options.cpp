@@ -1,15 +1,35 @@
 #include "Options.hpp"
 
+#include <cstring>
+#include <vector>
+
 namespace DcsEmbler {
 
 const char* Options::outputFormatForBinary = ".bin.riscv5i";
 const char* Options::outputFormatForHex = ".hex.riscv5i";
+const char* Options::outputFormatForElf = ".o";
+const char* Options::outputFormatForExecutable = ".elf";
+const char* Options::outputFormatForReadmemh = ".memh";
+const char* Options::outputFormatForReadmemb = ".memb";
+const char* Options::outputFormatForCoe = ".coe";
+const char* Options::outputFormatForMif = ".mif";
+const char* Options::outputFormatForIhex = ".ihex";
+const char* Options::outputFormatForProfile = ".folded";
+const char* Options::outputFormatForListing = ".lst";
+const char* Options::outputFormatForMap = ".map";
+const char* Options::outputFormatForMapIndex = ".idx";
 
 auto Options::parseFrom(int argc, char **argv) -> Options {
   auto app = structopt::app("DCSembler", "0.0.1");
+
+  // structopt only makes short options out of a field's first letter, so `-O` is done by hand.
+  vector<char*> arguments(argv, argv + argc);
+  for (auto& argument : arguments) {
+    if (strcmp(argument, "-O") == 0) argument = const_cast<char*>("--trim");
+  }
+
   try {
-    return app.parse<Options>(argc,
-                              const_cast<char**>(argv));
+    return app.parse<Options>((int) arguments.size(), arguments.data());
   } catch (structopt::exception &e) {
     cout << e.what();
     cout << " Usage: ";
@@ -31,6 +51,27 @@ auto DcsEmbler::Options::getOutputFileName() -> string {
       case Format::hex:
         return *inputFileName + outputFormatForHex;
         break;
+      case Format::elf:
+        return *inputFileName + outputFormatForElf;
+        break;
+      case Format::executable:
+        return *inputFileName + outputFormatForExecutable;
+        break;
+      case Format::readmemh:
+        return *inputFileName + outputFormatForReadmemh;
+        break;
+      case Format::readmemb:
+        return *inputFileName + outputFormatForReadmemb;
+        break;
+      case Format::coe:
+        return *inputFileName + outputFormatForCoe;
+        break;
+      case Format::mif:
+        return *inputFileName + outputFormatForMif;
+        break;
+      case Format::ihex:
+        return *inputFileName + outputFormatForIhex;
+        break;
       default:
         cerr << " Unknown value for Format\n";
         exit(EXIT_FAILURE);
@@ -39,4 +80,36 @@ auto DcsEmbler::Options::getOutputFileName() -> string {
   }
 }
 
+auto Options::getProfileFileName() -> string {
+  if (profileFileName.has_value()) {
+    return *profileFileName;
+  } else {
+    return getOutputFileName() + outputFormatForProfile;
+  }
+}
+
+auto Options::getListingFileName() -> string {
+  if (listingFileName.has_value()) {
+    return *listingFileName;
+  } else {
+    return getOutputFileName() + outputFormatForListing;
+  }
+}
+
+auto Options::getMapFileName() -> string {
+  if (mapFileName.has_value()) {
+    return *mapFileName;
+  } else {
+    return getOutputFileName() + outputFormatForMap;
+  }
+}
+
+auto Options::getMapIndexFileName() -> string {
+  if (mapIndexFileName.has_value()) {
+    return *mapIndexFileName;
+  } else {
+    return getMapFileName() + outputFormatForMapIndex;
+  }
+}
+
 }
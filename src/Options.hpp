@@ -9,28 +9,127 @@ using namespace std;
 
 namespace DcsEmbler {
 
-enum class Format : unsigned short { binary, bin, hex, hexadecimal };
+enum class Format : unsigned short { binary, bin, hex, hexadecimal, elf, executable,
+                                      readmemh, readmemb, coe, mif, ihex };
+
+enum class Endianness : unsigned short { little, big };
+
+/// What the core runs: the base integer instructions, or those and the M extension's multiplies
+/// and divides too.
+enum class Isa : unsigned short { rv32i, rv32im };
 
 /// This struct represents the command line options for the program.
 struct Options {
     static const char* outputFormatForBinary;
     static const char* outputFormatForHex;
+    static const char* outputFormatForElf;
+    static const char* outputFormatForExecutable;
+    static const char* outputFormatForReadmemh;
+    static const char* outputFormatForReadmemb;
+    static const char* outputFormatForCoe;
+    static const char* outputFormatForMif;
+    static const char* outputFormatForIhex;
+    static const char* outputFormatForProfile;
+    static const char* outputFormatForListing;
+    static const char* outputFormatForMap;
+    static const char* outputFormatForMapIndex;
 
     optional<string> inputFileName{"stdin"};
     optional<string> outputFileName{};
 
     optional<Format> format = Format::binary;
+    /// `mul`, `div` and the rest are only accepted with rv32im.
+    optional<Isa> isa = Isa::rv32i;
 
     /// In bytes.
     optional<int> startOfMemory = 0;
 
+    /// For the FPGA memory formats (readmemh, readmemb, coe, mif, ihex): how many words deep the
+    /// memory is (0 for just big enough), how wide a word is in bits, and what the rest is filled with.
+    /// Binary output is packed into words this wide too (32, 64 or 128 bits) - see Packing.hpp.
+    optional<unsigned long long> memoryDepth = 0;
+    optional<int> wordWidth = 32;
+    optional<unsigned long long> fillValue = 0;
+    /// The order binary output's words are written out in, byte by byte.
+    optional<Endianness> byteOrder = Endianness::little;
+
+    /// Threads for the emit pass. Anything but 1 writes binary and hex output by mapping the output
+    /// file in at its final size, and storing instructions straight into it from every thread.
+    /// 0 is one per hardware thread.
+    optional<int> jobs = 1;
+
+    /// The label an executable starts at. Without one, `_start` or `__begin` (whichever is there),
+    /// or else the start of memory.
+    optional<string> entry{};
+
     /// FEATURE: Make this do something.
     optional<bool> verbose = false;
 
+    /// `-O`: run the peephole rules (see Peephole.hpp) over the assembled program before writing it
+    /// out, and say what they did. Assumes code addresses only come from labels.
+    optional<bool> trim = false;
+    /// Take out whatever nothing can get to from the start of the program, the entry label, a
+    /// `.globl` name or a label in `keep` (see DeadCode.hpp), once the program is assembled.
+    optional<bool> removeDeadCode = false;
+    /// The labels a computed jalr can go to, comma-separated, for --removeDeadCode to keep.
+    optional<string> keep{};
+    /// Use 16-bit RVC encodings for whatever has one (see Compression.hpp), once the program is
+    /// assembled. Assumes code addresses only come from labels, as -O does.
+    optional<bool> compress = false;
+    /// Reorder the instructions in each basic block around load-use and branch hazards (see
+    /// Scheduler.hpp), once the program is assembled, and say how many stalls that saved.
+    optional<bool> schedule = false;
+    /// The pipeline's latencies, as `name = cycles` lines - alu, multiply, divide, load, jump and
+    /// branch. Without one, a load has one delay slot, a divide takes 32 cycles, and nothing else
+    /// stalls.
+    optional<string> latencyFileName{};
+    /// Load large constants that `li` uses more than once from a pool, with a single lw each (see
+    /// LiteralPool.hpp) - at the first `.ltorg`, or after the code. It's loaded off x0 while it's in
+    /// reach of address 0, and otherwise off x3, which is set up in front of the program's first instruction.
+    optional<bool> literalPool = false;
+    /// Pad the head of every loop - every label a conditional branch goes back to - out to a multiple
+    /// of this many bytes, so it doesn't straddle a fetch block (see Alignment.hpp). 0 for not.
+    optional<int> alignLoops = 0;
+
+    /// Write a listing (address, encoding and source, a line for each line of source) alongside the
+    /// output. Keeps the emit pass on one thread.
+    optional<bool> listing = false;
+    /// Where the listing goes.
+    optional<string> listingFileName{};
+
+    /// Write out a symbol map, sorted by address - as text, and as a fixed-record index for tools to
+    /// map in and binary search (see SymbolMap.hpp).
+    optional<bool> map = false;
+    optional<string> mapFileName{};
+    optional<string> mapIndexFileName{};
+
+    /// Print where the time went (per phase), throughput, instruction counts and such.
+    optional<bool> stats = false;
+    /// Write those stats out as JSON here, instead of printing them.
+    optional<string> statsFileName{};
+    /// Add hardware counters (cycles, instructions, branch and cache misses) to the stats, per phase.
+    /// Quietly left out where the kernel won't let us have them.
+    optional<bool> perfCounters = false;
+
+    /// Run the assembled program in the simulator afterwards, and print where it spent its time,
+    /// per label.
+    optional<bool> profile = false;
+    /// The simulator gives up after this many instructions.
+    optional<int> profileSteps = 10000000;
+    /// Where the collapsed stacks (for flamegraph.pl and friends) go.
+    optional<string> profileFileName{};
+
     static auto parseFrom(int argc, char **argv) -> Options;
     auto getOutputFileName() -> string;
+    auto getProfileFileName() -> string;
+    auto getListingFileName() -> string;
+    auto getMapFileName() -> string;
+    auto getMapIndexFileName() -> string;
 };
 
 }
 
-STRUCTOPT(DcsEmbler::Options, inputFileName, outputFileName, format, verbose, startOfMemory);
+STRUCTOPT(DcsEmbler::Options, inputFileName, outputFileName, format, verbose, trim, compress, alignLoops, startOfMemory, entry, jobs,
+          memoryDepth, wordWidth, fillValue, byteOrder,
+          listing, listingFileName, map, mapFileName, mapIndexFileName,
+          profile, profileSteps, profileFileName, stats, statsFileName, perfCounters, schedule, latencyFileName, isa, literalPool, removeDeadCode, keep);
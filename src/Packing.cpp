@@ -0,0 +1,181 @@
+#include "Packing.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace DcsEmbler {
+
+namespace {
+
+/// Reverses each `bytesPerWord` bytes of `from` into `to`, one word at a time.
+auto reverseScalar(const uint8_t* from, uint8_t* to, size_t size, unsigned bytesPerWord) -> void {
+    for (size_t i = 0; i < size; i += bytesPerWord) {
+        if (bytesPerWord == 4) {
+            uint32_t word;
+            memcpy(&word, from + i, 4);
+            word = __builtin_bswap32(word);
+            memcpy(to + i, &word, 4);
+        } else if (bytesPerWord == 8) {
+            uint64_t word;
+            memcpy(&word, from + i, 8);
+            word = __builtin_bswap64(word);
+            memcpy(to + i, &word, 8);
+        } else {
+            // 16: each half reversed, and the halves swapped.
+            uint64_t halves[2];
+            memcpy(halves, from + i, 16);
+            const uint64_t first = __builtin_bswap64(halves[1]);
+            halves[1] = __builtin_bswap64(halves[0]);
+            halves[0] = first;
+            memcpy(to + i, halves, 16);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/// pshufb indices that reverse each `bytesPerWord` bytes of a 16 byte lane.
+auto reversingShuffle(unsigned bytesPerWord) -> array<int8_t, 16> {
+    array<int8_t, 16> shuffle{};
+    for (unsigned i = 0; i < 16; i++) {
+        shuffle[i] = (int8_t) (i / bytesPerWord * bytesPerWord + (bytesPerWord - 1 - i % bytesPerWord));
+    }
+    return shuffle;
+}
+
+/// Returns how many bytes it did - the rest is left for reverseScalar.
+__attribute__((target("ssse3")))
+auto reverseSsse3(const uint8_t* from, uint8_t* to, size_t size, unsigned bytesPerWord) -> size_t {
+    const auto shuffle = reversingShuffle(bytesPerWord);
+    const __m128i mask = _mm_loadu_si128((const __m128i*) shuffle.data());
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m128i words = _mm_loadu_si128((const __m128i*) (from + i));
+        _mm_storeu_si128((__m128i*) (to + i), _mm_shuffle_epi8(words, mask));
+    }
+    return i;
+}
+
+/// vpshufb shuffles within each 16 byte lane, which is all a word of up to 16 bytes needs.
+__attribute__((target("avx2")))
+auto reverseAvx2(const uint8_t* from, uint8_t* to, size_t size, unsigned bytesPerWord) -> size_t {
+    const auto shuffle = reversingShuffle(bytesPerWord);
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) shuffle.data()));
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i words = _mm256_loadu_si256((const __m256i*) (from + i));
+        _mm256_storeu_si256((__m256i*) (to + i), _mm256_shuffle_epi8(words, mask));
+    }
+    return i;
+}
+
+auto reverseVectorised(const uint8_t* from, uint8_t* to, size_t size, unsigned bytesPerWord) -> size_t {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+
+    size_t done = 0;
+    if (avx2) done = reverseAvx2(from, to, size, bytesPerWord);
+    if (ssse3) done += reverseSsse3(from + done, to + done, size - done, bytesPerWord);
+    return done;
+}
+
+#elif defined(__aarch64__)
+
+auto reverseVectorised(const uint8_t* from, uint8_t* to, size_t size, unsigned bytesPerWord) -> size_t {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t words = vld1q_u8(from + i);
+        switch (bytesPerWord) {
+            case 4: words = vrev32q_u8(words); break;
+            case 8: words = vrev64q_u8(words); break;
+            default:
+                words = vrev64q_u8(words);
+                words = vextq_u8(words, words, 8);
+                break;
+        }
+        vst1q_u8(to + i, words);
+    }
+    return i;
+}
+
+#else
+
+auto reverseVectorised(const uint8_t*, uint8_t*, size_t, unsigned) -> size_t {
+    return 0;
+}
+
+#endif
+
+}
+
+auto packingFrom(const Options& options) -> Packing {
+    return {(unsigned) *options.wordWidth / 8, *options.byteOrder};
+}
+
+auto checkPacking(const Packing& packing) -> bool {
+    if (packing.bytesPerWord != 4 and packing.bytesPerWord != 8 and packing.bytesPerWord != 16) {
+        fprintf(stderr, " [Error]: Binary output can be packed into 32, 64 or 128 bit words, not %u.\n",
+                packing.bytesPerWord * 8);
+        return false;
+    }
+    return true;
+}
+
+auto packedSize(size_t imageBytes, const Packing& packing) -> size_t {
+    return (imageBytes + packing.bytesPerWord - 1) / packing.bytesPerWord * packing.bytesPerWord;
+}
+
+auto packedOffsetOf(size_t byteOffset, const Packing& packing) -> size_t {
+    if (packing.byteOrder == Endianness::little) return byteOffset;
+
+    const size_t word = byteOffset / packing.bytesPerWord * packing.bytesPerWord;
+    return word + packing.bytesPerWord - 4 - (byteOffset - word);
+}
+
+auto packWords(const uint8_t* from, uint8_t* to, size_t size, const Packing& packing) -> void {
+    if (packing.byteOrder == Endianness::little) {
+        if (from != to) memcpy(to, from, size);
+        return;
+    }
+
+    const size_t done = reverseVectorised(from, to, size, packing.bytesPerWord);
+    reverseScalar(from + done, to + done, size - done, packing.bytesPerWord);
+}
+
+auto writePacked(FILE* f, const Image& image, const Packing& packing) -> bool {
+    const size_t whole = image.size() / packing.bytesPerWord * packing.bytesPerWord;
+
+    if (packing.byteOrder == Endianness::little) {
+        if (fwrite(image.bytes.data(), 1, whole, f) != whole) return false;
+    } else {
+        // A multiple of every word size.
+        vector<uint8_t> block(1 << 16);
+        for (size_t at = 0; at < whole; at += block.size()) {
+            const size_t n = min(block.size(), whole - at);
+            packWords(image.bytes.data() + at, block.data(), n, packing);
+            if (fwrite(block.data(), 1, n, f) != n) return false;
+        }
+    }
+
+    // The last word, if the image only fills part of it.
+    if (whole < image.size()) {
+        uint8_t last[16] = {};
+        memcpy(last, image.bytes.data() + whole, image.size() - whole);
+        packWords(last, last, packing.bytesPerWord, packing);
+        if (fwrite(last, 1, packing.bytesPerWord, f) != packing.bytesPerWord) return false;
+    }
+
+    return true;
+}
+
+}
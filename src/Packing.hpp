@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "Image.hpp"
+#include "Options.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// How binary output is laid out for the memory it's loaded into. Instructions are packed into
+/// memory words lowest address first, into the least significant end - the word's value is the
+/// image's bytes read little-endian. The byte order is then how each word's value is written out,
+/// so a big-endian 64 bit word is its 8 image bytes reversed.
+struct Packing {
+    /// 4, 8 or 16 - one, two or four instructions a word.
+    unsigned bytesPerWord = 4;
+    Endianness byteOrder = Endianness::little;
+};
+
+/// From --wordWidth and --byteOrder.
+auto packingFrom(const Options& options) -> Packing;
+
+/// Checks the word size is one binary output can be packed into. Prints why not, if it isn't.
+auto checkPacking(const Packing& packing) -> bool;
+
+/// How big an image of `imageBytes` is packed - a partly used last word is padded out with zeros.
+auto packedSize(size_t imageBytes, const Packing& packing) -> size_t;
+
+/// Where the 4 bytes of the instruction at `byteOffset` in the image end up, packed.
+/// (In a big-endian word they're reversed as well as moved.)
+auto packedOffsetOf(size_t byteOffset, const Packing& packing) -> size_t;
+
+/// Packs `size` bytes of image - a whole number of words - from `from` into `to`, which may be the
+/// same place. Reversing words is done 16 or 32 bytes at a time with a byte shuffle (SSSE3, AVX2
+/// or NEON, whichever this CPU has), rather than a word at a time.
+auto packWords(const uint8_t* from, uint8_t* to, size_t size, const Packing& packing) -> void;
+
+/// Writes the whole image out packed, a block at a time.
+auto writePacked(FILE* f, const Image& image, const Packing& packing) -> bool;
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Calls `fn(i)` for every i in [0, count), shared out between `jobs` threads (this one among them)
+/// a piece at a time, as each comes free. 0 jobs is one per hardware thread.
+template<typename Fn>
+auto parallelFor(size_t count, unsigned jobs, Fn&& fn) -> void {
+    if (jobs == 0) jobs = thread::hardware_concurrency();
+    jobs = (unsigned) max<size_t>(1, min<size_t>(jobs, count));
+
+    atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i; (i = next.fetch_add(1, memory_order_relaxed)) < count; ) fn(i);
+    };
+
+    vector<jthread> threads{};
+    threads.reserve(jobs - 1);
+    for (unsigned i = 1; i < jobs; i++) threads.emplace_back(work);
+    work();
+}
+
+}
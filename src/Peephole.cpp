@@ -0,0 +1,373 @@
+#include "Peephole.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "Linker.hpp"
+#include "Relaxation.hpp"
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+namespace {
+
+constexpr uint32_t LUI = 0b0110111;
+constexpr uint32_t AUIPC = 0b0010111;
+constexpr uint32_t JAL = 0b1101111;
+constexpr uint32_t JALR = 0b1100111;
+constexpr uint32_t BRANCH = 0b1100011;
+constexpr uint32_t OP_IMM = 0b0010011;
+constexpr uint32_t OP = 0b0110011;
+constexpr uint32_t STORE = 0b0100011;
+
+/// addi x0, x0, 0
+constexpr uint32_t canonicalNop = 0x00000013;
+
+}
+
+auto decode(uint32_t word) -> DecodedInstruction {
+    DecodedInstruction d{};
+    d.word = word;
+    d.opcode = (uint8_t) (word & 0x7f);
+    d.rd = (uint8_t) ((word >> 7) & 0x1f);
+    d.funct3 = (uint8_t) ((word >> 12) & 0x7);
+    d.rs1 = (uint8_t) ((word >> 15) & 0x1f);
+    d.rs2 = (uint8_t) ((word >> 20) & 0x1f);
+    d.funct7 = (uint8_t) (word >> 25);
+
+    switch (d.opcode) {
+        case BRANCH:
+            d.immediate = ((int32_t) word >> 31 << 12) | (int32_t) (((word >> 7) & 0x1) << 11)
+                        | (int32_t) (((word >> 25) & 0x3f) << 5) | (int32_t) (((word >> 8) & 0xf) << 1);
+            break;
+        case JAL:
+            d.immediate = ((int32_t) word >> 31 << 20) | (int32_t) (word & 0xff000)
+                        | (int32_t) (((word >> 20) & 0x1) << 11) | (int32_t) (((word >> 21) & 0x3ff) << 1);
+            break;
+        case LUI:
+        case AUIPC:
+            d.immediate = (int32_t) (word & 0xfffff000);
+            break;
+        case STORE:
+            d.immediate = ((int32_t) word >> 25 << 5) | (int32_t) ((word >> 7) & 0x1f);
+            break;
+        case OP:
+            break;
+        default:
+            // I-type, near enough - and nothing else is looked at.
+            d.immediate = (int32_t) word >> 20;
+            break;
+    }
+    return d;
+}
+
+auto Peephole::remove(size_t i) -> void {
+    program[i].removed = true;
+    const int before = previous[i];
+    const int after = next[i];
+    if (before >= 0) {
+        next[before] = after;
+        touched.push_back(before);
+    }
+    if (after < (int) program.size()) {
+        previous[after] = before;
+        touched.push_back(after);
+    }
+}
+
+auto Peephole::refreshPositions() -> void {
+    realigned = alignment;
+    int kept = 0;
+    size_t site = 0;
+    for (size_t i = 0; i <= program.size(); i++) {
+        // The padding goes back in before whatever's on the site.
+        for (; site < alignment.size() and alignment[site].instructionIndex == (int) i; site++) {
+            realigned[site].instructionIndex = kept;
+            realigned[site].padding = (int) paddingFor((uint32_t) kept * 4, alignment[site].alignment) / 4;
+            kept += realigned[site].padding;
+        }
+        position[i] = kept;
+        if (i < program.size() and not program[i].removed) kept++;
+    }
+}
+
+namespace {
+
+/// `mv x5, x5`, `addi x5, x5, 0`, `or x5, x5, x0` and the like - rd ends up just as it was.
+auto leavesRegisterAlone(Peephole& p, size_t i) -> bool {
+    const auto& d = p.program[i];
+    if (d.rd == 0 or d.rs1 != d.rd) return false;
+
+    bool identity = false;
+    if (d.opcode == OP_IMM) {
+        switch (d.funct3) {
+            case 0b000: // addi
+            case 0b100: // xori
+            case 0b110: // ori
+                identity = d.immediate == 0;
+                break;
+            case 0b111: // andi
+                identity = d.immediate == -1;
+                break;
+            case 0b001: // slli
+            case 0b101: // srli, srai
+                identity = (d.immediate & 0x1f) == 0;
+                break;
+            default:
+                break;
+        }
+    } else if (d.opcode == OP and (d.funct7 == 0 or d.funct7 == 0b0100000)) {
+        switch (d.funct3) {
+            case 0b000: // add, sub
+            case 0b001: // sll
+            case 0b100: // xor
+            case 0b101: // srl, sra
+                identity = d.rs2 == 0;
+                break;
+            case 0b110: // or
+                identity = d.funct7 == 0 and (d.rs2 == 0 or d.rs2 == d.rd);
+                break;
+            case 0b111: // and
+                identity = d.funct7 == 0 and d.rs2 == d.rd;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (identity) p.remove(i);
+    return identity;
+}
+
+/// Arithmetic written to x0 goes nowhere. Loads to x0 still load (which might be from a device), and
+/// the canonical nop is left for collapseNops.
+auto writesZeroRegister(Peephole& p, size_t i) -> bool {
+    const auto& d = p.program[i];
+    const bool arithmetic = d.opcode == OP_IMM or d.opcode == OP or d.opcode == LUI or d.opcode == AUIPC;
+    if (not arithmetic or d.rd != 0 or d.word == canonicalNop) return false;
+
+    p.remove(i);
+    return true;
+}
+
+/// A nop straight after another nop.
+auto collapseNops(Peephole& p, size_t i) -> bool {
+    if (p.program[i].word != canonicalNop) return false;
+    const int before = p.previous[i];
+    if (before < 0 or p.program[before].word != canonicalNop) return false;
+
+    p.remove(i);
+    return true;
+}
+
+/// A branch, or a jal that doesn't link, to the instruction right after it.
+auto jumpsToNext(Peephole& p, size_t i) -> bool {
+    const auto& d = p.program[i];
+    if (d.relocated or d.target < 0) return false;
+    if (d.opcode != BRANCH and not (d.opcode == JAL and d.rd == 0)) return false;
+    // Forwards, with nothing left in between.
+    if (d.target <= (int) i or p.next[i] < d.target) return false;
+
+    p.remove(i);
+    return true;
+}
+
+/// `addi rd, rs, a` then `addi rd, rd, b` is `addi rd, rs, a + b` - as long as nothing jumps to the
+/// second one, and the sum still fits.
+auto fuseAddis(Peephole& p, size_t i) -> bool {
+    auto& d = p.program[i];
+    if (d.opcode != OP_IMM or d.funct3 != 0b000 or d.rd == 0) return false;
+
+    const auto after = (size_t) p.next[i];
+    if (after >= p.program.size() or p.isTarget[after]) return false;
+    const auto& e = p.program[after];
+    if (e.opcode != OP_IMM or e.funct3 != 0b000 or e.rd != d.rd or e.rs1 != d.rd) return false;
+
+    const int32_t sum = d.immediate + e.immediate;
+    if (sum < -2048 or sum > 2047) return false;
+
+    d.immediate = sum;
+    d.word = (d.word & 0x000fffff) | ((uint32_t) sum << 20);
+    p.remove(after);
+    return true;
+}
+
+}
+
+const array<PeepholeRule, peepholeRuleCount> peepholeRules{{
+    {"self-move", leavesRegisterAlone},
+    {"zero-write", writesZeroRegister},
+    {"nop-run", collapseNops},
+    {"jump-to-next", jumpsToNext},
+    {"addi-fusion", fuseAddis},
+}};
+
+auto decodeProgram(const Image& image, const char* notDoing) -> optional<vector<DecodedInstruction>> {
+    const size_t count = image.size() / 4;
+
+    vector<DecodedInstruction> program{};
+    program.reserve(count);
+    for (size_t at = 0; at < image.size(); at += 4) program.push_back(decode(image.wordAt(at)));
+    for (const auto& relocation : image.relocations) program[relocation.offset / 4].relocated = true;
+
+    for (size_t i = 0; i < count; i++) {
+        auto& d = program[i];
+        if (d.relocated) continue;
+
+        int32_t byteOffset;
+        if (d.opcode == BRANCH or d.opcode == JAL) {
+            byteOffset = d.immediate;
+        } else if (d.opcode == AUIPC and d.rd != 0) {
+            // Only as the first half of a far jump (see farJump) can it be pointed somewhere else.
+            const bool jump = i + 1 < count and program[i + 1].opcode == JALR and program[i + 1].rs1 == d.rd;
+            if (not jump) {
+                printf(YELLOW "Warning:" RESET " Not %s - the auipc at 0x%08zX might be taking an address.\n", notDoing, i * 4);
+                return {};
+            }
+            byteOffset = d.immediate + program[i + 1].immediate;
+        } else {
+            continue;
+        }
+
+        const int64_t target = (int64_t) i + byteOffset / 4;
+        if (byteOffset % 4 != 0 or target < 0 or target > (int64_t) count) {
+            printf(YELLOW "Warning:" RESET " Not %s - the jump at 0x%08zX goes outside the program.\n", notDoing, i * 4);
+            return {};
+        }
+        d.target = (int) target;
+    }
+
+    return program;
+}
+
+auto Peephole::of(vector<DecodedInstruction> program, const LabelSet& labels) -> Peephole {
+    const size_t count = program.size();
+
+    Peephole p{};
+    p.program = move(program);
+    p.isTarget.assign(count + 1, false);
+    for (const auto& d : p.program) {
+        if (d.target >= 0) p.isTarget[d.target] = true;
+    }
+    for (const auto& [ name, label ] : labels) {
+        if (label.instructionIndex >= 0 and label.instructionIndex <= (int) count) p.isTarget[label.instructionIndex] = true;
+    }
+
+    p.next.resize(count);
+    p.previous.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        p.next[i] = (int) i + 1;
+        p.previous[i] = (int) i - 1;
+    }
+    p.position.resize(count + 1);
+
+    p.alignment = alignmentSites;
+    for (const auto& site : p.alignment) {
+        for (int i = 0; i < site.padding; i++) p.remove((size_t) (site.instructionIndex + i));
+    }
+    return p;
+}
+
+auto Peephole::closeUp(Image& image, LabelSet& labels, const char* notDoing) -> bool {
+    const size_t count = program.size();
+    refreshPositions();
+
+    // Everything got closer together, bar what more padding there might now be.
+    for (size_t i = 0; i < count; i++) {
+        const auto& d = program[i];
+        if (d.removed or d.target < 0) continue;
+        const int byteOffset = (position[d.target] - position[i]) * 4;
+        if ((d.opcode == BRANCH and not branchReaches(byteOffset)) or (d.opcode == JAL and not jalReaches(byteOffset))) {
+            printf(YELLOW "Warning:" RESET " Not %s - realigning would put the jump at 0x%08zX out of reach.\n", notDoing, i * 4);
+            return false;
+        }
+    }
+
+    image.bytes.clear();
+    size_t site = 0;
+    auto pad = [&](size_t i) {
+        for (; site < alignment.size() and alignment[site].instructionIndex == (int) i; site++) {
+            for (int n = 0; n < realigned[site].padding; n++) image.appendWord(canonicalNop);
+        }
+    };
+    for (size_t i = 0; i < count; i++) {
+        pad(i);
+        auto& d = program[i];
+        if (d.removed) continue;
+
+        if (d.target >= 0) {
+            const int byteOffset = (position[d.target] - position[i]) * 4;
+            if (d.opcode == BRANCH) {
+                patchBranch(d.word, byteOffset);
+            } else if (d.opcode == JAL) {
+                patchJal(d.word, byteOffset);
+            } else {
+                auto& jalr = program[i + 1];
+                const auto [ auipc, jump ] = farJump(jalr.rd, d.rd, byteOffset);
+                d.word = auipc;
+                jalr.word = jump;
+            }
+        }
+        image.appendWord(d.word);
+    }
+    pad(count);
+    alignmentSites = move(realigned);
+
+    for (auto& [ name, label ] : labels) {
+        if (label.instructionIndex >= 0 and label.instructionIndex <= (int) count) {
+            label.instructionIndex = position[label.instructionIndex];
+        }
+    }
+    for (auto& relocation : image.relocations) relocation.offset = (uint32_t) position[relocation.offset / 4] * 4;
+
+    return true;
+}
+
+auto optimizeImage(Image& image, LabelSet& labels) -> optional<PeepholeReport> {
+    const size_t count = image.size() / 4;
+
+    auto program = decodeProgram(image, "optimizing");
+    if (not program) return {};
+
+    Peephole p = Peephole::of(move(*program), labels);
+
+    PeepholeReport report{};
+    report.instructionsBefore = (int) count;
+
+    // A removal can line up another (a jump to a nop that went is now a jump to next), so keep
+    // sweeping until nothing changes. After the first, a sweep only has to look at the neighbours of
+    // what went - a jump only comes to be a jump to next when what was after it goes.
+    vector<int> sweep(count);
+    for (size_t i = 0; i < count; i++) sweep[i] = (int) i;
+    while (not sweep.empty()) {
+        p.touched.clear();
+        for (int i : sweep) {
+            if (p.program[i].removed) continue;
+            for (size_t r = 0; r < peepholeRules.size(); r++) {
+                if (peepholeRules[r].apply(p, (size_t) i)) {
+                    report.hits[r]++;
+                    break;
+                }
+            }
+        }
+
+        sweep.swap(p.touched);
+        sort(sweep.begin(), sweep.end());
+        sweep.erase(unique(sweep.begin(), sweep.end()), sweep.end());
+    }
+
+    if (not p.closeUp(image, labels, "optimizing")) return {};
+    report.instructionsAfter = p.position[count];
+    return report;
+}
+
+auto printPeepholeReport(FILE* f, const PeepholeReport& report) -> void {
+    fprintf(f, "Peephole: " YELLOWC("%d") " of %d instructions removed, %d left.\n",
+            report.instructionsBefore - report.instructionsAfter, report.instructionsBefore, report.instructionsAfter);
+    for (size_t r = 0; r < peepholeRules.size(); r++) {
+        fprintf(f, "  " GREENC("%-14s") " %12" PRIu64 "\n", peepholeRules[r].name, report.hits[r]);
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "Image.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// One instruction of the assembled program, pulled apart far enough for the peephole rules.
+struct DecodedInstruction {
+    uint32_t word = 0;
+    /// The bottom 7 bits. Fields are bytes so that a whole program of these stays small.
+    uint8_t opcode = 0;
+    uint8_t rd = 0;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    uint8_t funct3 = 0;
+    uint8_t funct7 = 0;
+    /// Sign-extended, and in bytes for branches and jumps - whichever format the opcode is in.
+    int32_t immediate = 0;
+
+    /// For a branch, a jal, or an auipc a jalr goes through: the (original) index of the
+    /// instruction it goes to. -1 for anything else.
+    int target = -1;
+    /// Has a relocation for the linker to fill in, so is left just as it is.
+    bool relocated = false;
+    bool removed = false;
+};
+
+auto decode(uint32_t word) -> DecodedInstruction;
+
+/// The whole image decoded, with relocations marked and each jump's target found.
+///
+/// Code addresses are assumed to only come from labels and pc-relative jumps - an auipc that isn't
+/// half of a jump could be taking an address that's about to move. So then (or if a jump goes outside
+/// the program) this warns that it's `notDoing` whatever it was going to, and returns nothing.
+auto decodeProgram(const Image& image, const char* notDoing) -> optional<vector<DecodedInstruction>>;
+
+/// The program as the rules see it: what's left of it is a doubly linked list, so removing an
+/// instruction, and finding the ones either side of it, is constant time.
+struct Peephole {
+    vector<DecodedInstruction> program{};
+    /// Something jumps to it, or a label is on it - so it can't be fused into the one before it.
+    vector<bool> isTarget{};
+    /// The kept instructions either side of each one - program.size() for none after, -1 for none
+    /// before.
+    vector<int> next{};
+    vector<int> previous{};
+    /// Where each instruction, and the end, ends up once the removed ones are gone - once the rules
+    /// are done.
+    vector<int> position{};
+    /// The neighbours of whatever's been removed since the last sweep - all a local rule could now
+    /// match that it didn't before.
+    vector<int> touched{};
+    /// The alignment sites as the program was, whose padding is taken out before the rules run - and
+    /// as it ends up, once refreshPositions has put back as much as each now takes.
+    vector<AlignmentSite> alignment{};
+    vector<AlignmentSite> realigned{};
+
+    /// Everything in `program` (from decodeProgram) kept, bar alignment padding, with what's jumped to
+    /// or labelled marked.
+    static auto of(vector<DecodedInstruction> program, const LabelSet& labels) -> Peephole;
+
+    auto remove(size_t i) -> void;
+    auto refreshPositions() -> void;
+    /// Closes up the gaps in the image: every branch, jump and auipc/jalr pair is pointed back at
+    /// what it went to, labels and relocations are moved to match, and alignment padding is put back
+    /// as needed. Leaves everything alone, warns it's `notDoing` whatever it was, and returns false
+    /// if more padding would put a branch out of reach.
+    auto closeUp(Image& image, LabelSet& labels, const char* notDoing) -> bool;
+};
+
+struct PeepholeRule {
+    const char* name;
+    /// Looks at kept instruction `i`, and maybe the ones next to it. Returns whether it changed anything.
+    auto (*apply)(Peephole& p, size_t i) -> bool;
+};
+
+inline constexpr size_t peepholeRuleCount = 5;
+extern const array<PeepholeRule, peepholeRuleCount> peepholeRules;
+
+struct PeepholeReport {
+    int instructionsBefore = 0;
+    int instructionsAfter = 0;
+    /// By rule, in the same order as peepholeRules.
+    array<uint64_t, peepholeRuleCount> hits{};
+};
+
+/// Runs the rules over the image until none of them match, then closes up the gaps: every branch,
+/// jump and auipc/jalr pair is pointed back at what it went to, and labels and relocations are
+/// moved to match. Alignment padding is left out of the rules' way, and put back as needed after.
+/// Nothing is touched, and nothing returned, if decodeProgram won't have it - or if more padding
+/// would put a branch out of reach.
+auto optimizeImage(Image& image, LabelSet& labels) -> optional<PeepholeReport>;
+
+auto printPeepholeReport(FILE* f, const PeepholeReport& report) -> void;
+
+}
@@ -0,0 +1,111 @@
+#include "PerfCounters.hpp"
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace DcsEmbler {
+
+PerfCounters perfCounters{};
+
+auto counterName(Counter counter) -> const char* {
+    switch (counter) {
+        case Counter::cycles: return "cycles";
+        case Counter::instructions: return "instructions";
+        case Counter::branchMisses: return "branch_misses";
+        case Counter::l1dMisses: return "l1d_misses";
+        case Counter::llcMisses: return "llc_misses";
+    }
+    return "unknown";
+}
+
+namespace {
+
+auto attributesFor(Counter counter) -> perf_event_attr {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+        case Counter::cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case Counter::instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case Counter::branchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case Counter::l1dMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case Counter::llcMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+    }
+
+    return attr;
+}
+
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+auto PerfCounters::open() -> bool {
+    for (size_t i = 0; i < counterCount; i++) {
+        if (fds[i] != -1) continue;
+
+        auto attr = attributesFor((Counter) i);
+        // This process, on whatever CPU it runs on.
+        fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[i] < 0) fds[i] = -1;
+    }
+    return anyAvailable();
+}
+
+auto PerfCounters::close() -> void {
+    for (auto& fd : fds) {
+        if (fd != -1) ::close(fd);
+        fd = -1;
+    }
+}
+
+auto PerfCounters::anyAvailable() const -> bool {
+    for (int fd : fds) {
+        if (fd != -1) return true;
+    }
+    return false;
+}
+
+auto PerfCounters::read() const -> CounterValues {
+    CounterValues values{};
+
+    for (size_t i = 0; i < counterCount; i++) {
+        if (fds[i] == -1) continue;
+
+        // value, time enabled, time running - as asked for by read_format.
+        uint64_t data[3] = {};
+        if (::read(fds[i], data, sizeof(data)) != sizeof(data)) continue;
+
+        const auto [ value, enabled, running ] = data;
+        values[i] = (running > 0 and running < enabled) ? (uint64_t) ((double) value * enabled / running)
+                                                        : value;
+    }
+
+    return values;
+}
+
+}
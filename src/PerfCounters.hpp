@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+namespace DcsEmbler {
+
+enum class Counter : unsigned short { cycles, instructions, branchMisses, l1dMisses, llcMisses };
+inline constexpr size_t counterCount = 5;
+
+auto counterName(Counter counter) -> const char*;
+
+using CounterValues = array<uint64_t, counterCount>;
+
+/// Hardware performance counters for this process, via perf_event_open(2).
+/// Any counter the kernel (or container, or perf_event_paranoid) won't give us is just left out.
+struct PerfCounters {
+    array<int, counterCount> fds{-1, -1, -1, -1, -1};
+
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    auto operator=(const PerfCounters&) -> PerfCounters& = delete;
+
+    /// Returns whether at least one counter could be opened.
+    auto open() -> bool;
+    auto close() -> void;
+
+    [[nodiscard]]
+    auto available(Counter counter) const -> bool { return fds[(size_t) counter] != -1; }
+    [[nodiscard]]
+    auto anyAvailable() const -> bool;
+
+    /// Current counts, scaled up if the kernel had to multiplex the counters.
+    auto read() const -> CounterValues;
+};
+
+extern PerfCounters perfCounters;
+
+}
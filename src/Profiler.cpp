@@ -0,0 +1,160 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <limits>
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+Profiler::Profiler(const LabelSet& labels) {
+    symbols.reserve(labels.size());
+    for (const auto& [ labelName, label ] : labels) {
+        symbols.push_back(Symbol{(uint32_t) instructionIndexToAddress(label.instructionIndex), labelName});
+    }
+    sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.address < b.address or (a.address == b.address and a.name < b.name);
+    });
+
+    flat.resize(symbols.size() + 1);
+
+    // The root of the call tree, which never gets printed.
+    stackNodes.push_back(StackNode{});
+    stackCounts.push_back(Counts{});
+}
+
+auto Profiler::symbolFor(uint32_t address) const -> int {
+    auto after = upper_bound(symbols.begin(), symbols.end(), address,
+                             [](uint32_t a, const Symbol& s) { return a < s.address; });
+    if (after == symbols.begin()) {
+        return unlabelled();
+    }
+    return (int) (after - symbols.begin()) - 1;
+}
+
+auto Profiler::symbolName(int symbol) const -> const char* {
+    return symbol == unlabelled() ? "[unlabelled]" : symbols[symbol].name.c_str();
+}
+
+auto Profiler::childOf(int parent, int symbol) -> int {
+    const uint64_t key = ((uint64_t) parent << 32) | (uint32_t) symbol;
+    auto [ it, inserted ] = stackChildren.try_emplace(key, (int) stackNodes.size());
+    if (inserted) {
+        stackNodes.push_back(StackNode{parent, symbol});
+        stackCounts.push_back(Counts{});
+    }
+    return it->second;
+}
+
+auto Profiler::run(Simulator& simulator, uint64_t maxSteps) -> StopReason {
+    const int JAL = 0b1101111;
+    const int JALR = 0b1100111;
+    auto isLinkRegister = [](uint32_t r) { return r == 1 or r == 5; };
+    // Runaway recursion would otherwise give us one (ever longer) stack per call.
+    const size_t maxStackDepth = 64;
+
+    vector<int> callStack{ childOf(0, symbolFor(simulator.pc)) };
+
+    // The address range covered by the current symbol, so we only binary search when we leave it.
+    int leafSymbol = unlabelled();
+    uint64_t rangeStart = 1;
+    uint64_t rangeEnd = 0;
+    int leafNode = -1;
+
+    for (uint64_t i = 0; i < maxSteps; i++) {
+        const uint32_t pc = simulator.pc;
+
+        if (pc < rangeStart or pc >= rangeEnd) {
+            leafSymbol = symbolFor(pc);
+            if (leafSymbol == unlabelled()) {
+                rangeStart = 0;
+                rangeEnd = symbols.empty() ? numeric_limits<uint64_t>::max() : symbols.front().address;
+            } else {
+                rangeStart = symbols[leafSymbol].address;
+                rangeEnd = leafSymbol + 1 < (int) symbols.size() ? symbols[leafSymbol + 1].address
+                                                                 : numeric_limits<uint64_t>::max();
+            }
+            leafNode = -1;
+        }
+        if (leafNode == -1) {
+            const int frame = callStack.back();
+            leafNode = stackNodes[frame].symbol == leafSymbol ? frame : childOf(frame, leafSymbol);
+        }
+
+        const uint64_t retiredBefore = simulator.instructionsRetired;
+        const auto step = simulator.step();
+
+        if (simulator.instructionsRetired != retiredBefore) {
+            flat[leafSymbol].instructions++;
+            flat[leafSymbol].cycles += step.cycles;
+            stackCounts[leafNode].instructions++;
+            stackCounts[leafNode].cycles += step.cycles;
+        }
+
+        if (step.stop) {
+            return stoppedBecause = *step.stop;
+        }
+
+        const uint32_t opcode = step.instruction & 0x7f;
+        const uint32_t rd = (step.instruction >> 7) & 0x1f;
+        const uint32_t rs1 = (step.instruction >> 15) & 0x1f;
+
+        if ((opcode == JAL or opcode == JALR) and isLinkRegister(rd) and callStack.size() < maxStackDepth) {
+            callStack.push_back(childOf(callStack.back(), symbolFor(simulator.pc)));
+            leafNode = -1;
+        } else if (opcode == JALR and rd == 0 and isLinkRegister(rs1) and callStack.size() > 1) {
+            callStack.pop_back();
+            leafNode = -1;
+        }
+    }
+
+    return stoppedBecause = StopReason::stepLimit;
+}
+
+auto Profiler::printFlatProfile(FILE* f) const -> void {
+    Counts total{};
+    for (const auto& c : flat) {
+        total.instructions += c.instructions;
+        total.cycles += c.cycles;
+    }
+
+    vector<int> order(flat.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int) i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return flat[a].cycles > flat[b].cycles; });
+
+    fprintf(f, "Flat profile: %" PRIu64 " instructions, %" PRIu64 " modelled cycles (stopped: %s)\n",
+            total.instructions, total.cycles, stopReasonName(stoppedBecause));
+    fprintf(f, "  %% cycles       cycles  instructions  label\n");
+    for (int symbol : order) {
+        const auto& c = flat[symbol];
+        if (c.instructions == 0) continue;
+
+        const double percent = total.cycles ? 100.0 * c.cycles / total.cycles : 0.0;
+        fprintf(f, "  %7.2f%% %12" PRIu64 "  %12" PRIu64 "  " GREENC("%s") "\n",
+                percent, c.cycles, c.instructions, symbolName(symbol));
+    }
+}
+
+auto Profiler::stackPath(int node) const -> string {
+    vector<int> frames{};
+    for (; node > 0; node = stackNodes[node].parent) {
+        frames.push_back(stackNodes[node].symbol);
+    }
+
+    string path{};
+    for (auto it = frames.rbegin(); it != frames.rend(); it++) {
+        if (not path.empty()) path += ';';
+        path += symbolName(*it);
+    }
+    return path;
+}
+
+auto Profiler::writeCollapsedStacks(FILE* f) const -> void {
+    for (size_t node = 1; node < stackNodes.size(); node++) {
+        if (stackCounts[node].cycles == 0) continue;
+        fprintf(f, "%s %" PRIu64 "\n", stackPath((int) node).c_str(), stackCounts[node].cycles);
+    }
+}
+
+}
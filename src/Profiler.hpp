@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Assembler.hpp"
+#include "Simulator.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Runs a program in the simulator, attributing every executed instruction (and its modelled
+/// cycles) to the nearest label at or before it.
+struct Profiler {
+    struct Symbol {
+        uint32_t address = 0;
+        string name{};
+    };
+
+    struct Counts {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+    };
+
+    /// A frame in the shadow call tree - used for the collapsed stack output.
+    struct StackNode {
+        int parent = -1;
+        int symbol = -1;
+    };
+
+    /// Sorted by address, so the symbol for a pc can be binary searched.
+    vector<Symbol> symbols{};
+    /// Parallel to symbols. The extra entry at the end is for code before the first label.
+    vector<Counts> flat{};
+
+    vector<StackNode> stackNodes{};
+    vector<Counts> stackCounts{};
+
+    StopReason stoppedBecause = StopReason::stepLimit;
+
+    explicit Profiler(const LabelSet& labels);
+
+    /// The index into symbols of the label covering address, or unlabelled() if there isn't one.
+    [[nodiscard]]
+    auto symbolFor(uint32_t address) const -> int;
+    [[nodiscard]]
+    auto unlabelled() const -> int { return (int) symbols.size(); }
+    [[nodiscard]]
+    auto symbolName(int symbol) const -> const char*;
+
+    auto run(Simulator& simulator, uint64_t maxSteps) -> StopReason;
+
+    auto printFlatProfile(FILE* f) const -> void;
+    /// One line per call stack, in the `frame;frame;frame weight` format flamegraph.pl understands.
+    /// Weighted by modelled cycles.
+    auto writeCollapsedStacks(FILE* f) const -> void;
+
+private:
+    unordered_map<uint64_t, int> stackChildren{};
+
+    auto childOf(int parent, int symbol) -> int;
+    auto stackPath(int node) const -> string;
+};
+
+}
@@ -0,0 +1,166 @@
+#include "Relaxation.hpp"
+
+#include <algorithm>
+
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "Linker.hpp"
+
+namespace DcsEmbler {
+
+vector<RelaxableSite> relaxableSites{};
+vector<int> relaxedSites{};
+
+namespace {
+
+/// Counts how many of the first n sites have been relaxed, in O(log n) - and records another in the same.
+struct FenwickTree {
+    vector<int> counts;
+
+    explicit FenwickTree(size_t size) : counts(size + 1, 0) {}
+
+    auto add(size_t position) -> void {
+        for (size_t i = position + 1; i < counts.size(); i += i & -i) counts[i]++;
+    }
+
+    /// How many of positions [0, end) have been added.
+    [[nodiscard]]
+    auto before(size_t end) const -> int {
+        int sum = 0;
+        for (size_t i = end; i > 0; i -= i & -i) sum += counts[i];
+        return sum;
+    }
+};
+
+}
+
+auto branchReaches(int byteOffset) -> bool {
+    return byteOffset >= -(1 << 12) and byteOffset < (1 << 12);
+}
+
+auto jalReaches(int byteOffset) -> bool {
+    return byteOffset >= -(1 << 20) and byteOffset < (1 << 20);
+}
+
+auto isRelaxed(int instructionIndex) -> bool {
+    return binary_search(relaxedSites.begin(), relaxedSites.end(), instructionIndex);
+}
+
+auto relaxSites(vector<Checkpoint>& checkpoints) -> int {
+    relaxedSites.clear();
+
+    struct Candidate {
+        int index;
+        int target;
+        RelaxableSite::Kind kind;
+    };
+    // Sites are found in order, so these are sorted by index. Those to labels defined somewhere
+    // else are for the linker.
+    vector<Candidate> candidates{};
+    candidates.reserve(relaxableSites.size());
+    for (const auto& site : relaxableSites) {
+        if (const Label* label = labels.lookup(site.target)) {
+            candidates.push_back({site.instructionIndex, label->instructionIndex, site.kind});
+        }
+    }
+    relaxableSites.clear();
+
+    auto reaches = [](const Candidate& c, int byteOffset) {
+        return c.kind == RelaxableSite::Kind::branch ? branchReaches(byteOffset) : jalReaches(byteOffset);
+    };
+
+    FenwickTree grown{candidates.size()};
+    auto relaxedBefore = [&](int index) {
+        const auto position = lower_bound(candidates.begin(), candidates.end(), index,
+                                          [](const Candidate& c, int i) { return c.index < i; });
+        return grown.before((size_t) (position - candidates.begin()));
+    };
+
+    // How much padding the first k alignment sites come to, as the program is laid out at the moment.
+    auto& sites = alignmentSites;
+    vector<int> paddingBefore(sites.size() + 1, 0);
+    auto layOutAlignment = [&] {
+        for (size_t k = 0; k < sites.size(); k++) {
+            const int start = sites[k].instructionIndex + relaxedBefore(sites[k].instructionIndex) + paddingBefore[k];
+            paddingBefore[k + 1] = paddingBefore[k] + (int) paddingFor((uint32_t) start * 4, sites[k].alignment) / 4;
+        }
+    };
+
+    // Every relaxed site before an instruction pushes it back one, and so does the padding of every
+    // alignment site up to it - including one on it, which it comes after.
+    auto moved = [&](int index) {
+        const auto aligned = upper_bound(sites.begin(), sites.end(), index,
+                                         [](int i, const AlignmentSite& s) { return i < s.instructionIndex; });
+        return index + relaxedBefore(index) + paddingBefore[(size_t) (aligned - sites.begin())];
+    };
+
+    vector<size_t> pending(candidates.size());
+    for (size_t i = 0; i < pending.size(); i++) pending[i] = i;
+
+    // Padding can shrink as well as grow when something before it does, so it's worked out afresh
+    // each time round from what's been relaxed so far - it's only the sites that have to settle.
+    vector<bool> relaxed(candidates.size(), false);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        layOutAlignment();
+        size_t stillShort = 0;
+        for (size_t p : pending) {
+            const auto& c = candidates[p];
+            if (reaches(c, (moved(c.target) - moved(c.index)) * 4)) {
+                pending[stillShort++] = p;
+            } else {
+                grown.add(p);
+                relaxed[p] = true;
+                changed = true;
+            }
+        }
+        pending.resize(stillShort);
+    }
+
+    for (size_t p = 0; p < candidates.size(); p++) {
+        if (relaxed[p]) relaxedSites.push_back(moved(candidates[p].index));
+    }
+
+    const int added = (int) relaxedSites.size() + paddingBefore.back();
+    if (added != 0) {
+        for (auto& [ name, label ] : labels) label.instructionIndex = moved(label.instructionIndex);
+        // A checkpoint starts its line, so it's before the padding for that line.
+        for (auto& checkpoint : checkpoints) {
+            const auto aligned = lower_bound(sites.begin(), sites.end(), checkpoint.lineNumber,
+                                             [](const AlignmentSite& s, int line) { return s.lineNumber < line; });
+            checkpoint.instructionIndex += relaxedBefore(checkpoint.instructionIndex)
+                                         + paddingBefore[(size_t) (aligned - sites.begin())];
+        }
+    }
+    for (size_t k = 0; k < sites.size(); k++) {
+        sites[k].padding = paddingBefore[k + 1] - paddingBefore[k];
+        sites[k].instructionIndex += relaxedBefore(sites[k].instructionIndex) + paddingBefore[k];
+    }
+
+    return added;
+}
+
+auto relaxedBranch(uint32_t branch, int byteOffset) -> optional<pair<uint32_t, uint32_t>> {
+    // beq/bne, blt/bge and bltu/bgeu only differ in the bottom bit of funct3.
+    uint32_t skip = branch ^ (1u << 12);
+    patchBranch(skip, 8);
+
+    // The jal is an instruction further on.
+    uint32_t jal = 0b1101111;
+    if (not patchJal(jal, byteOffset - 4)) return {};
+
+    return pair{skip, jal};
+}
+
+auto farJump(unsigned int rd, unsigned int scratch, int byteOffset) -> pair<uint32_t, uint32_t> {
+    const auto [ upper, lower ] = loadImmediateParts((uint32_t) byteOffset);
+
+    const uint32_t AUIPC = 0b0010111;
+    const uint32_t JALR = 0b1100111;
+    const uint32_t auipc = (upper << 12) | (scratch << 7) | AUIPC;
+    const uint32_t jalr = (((uint32_t) lower & 0xfff) << 20) | (scratch << 15) | (rd << 7) | JALR;
+    return {auipc, jalr};
+}
+
+}
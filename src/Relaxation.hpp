@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedOutput.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// Something to a label that starts out as one instruction but might need two to reach it, as the
+/// label pass found it.
+struct RelaxableSite {
+    enum class Kind : unsigned short {
+        /// A conditional branch, which reaches +-4 KiB.
+        branch,
+        /// A `call` or `tail`, which as a `jal` reaches +-1 MiB.
+        call,
+    };
+
+    /// As the label pass counted it - before anything was relaxed.
+    int instructionIndex = 0;
+    int lineNumber = 0;
+    /// Points into the label pass's text, so is only good for as long as that is.
+    string_view target{};
+    Kind kind = Kind::branch;
+};
+
+/// Every branch and call to a label, in order - filled in by the label pass (huntForLabels) and
+/// used up by relaxSites.
+extern vector<RelaxableSite> relaxableSites;
+/// Where the sites relaxSites decided to relax are, by (final) instruction index, sorted.
+/// Read by the emit pass, on any thread.
+extern vector<int> relaxedSites;
+
+/// Whether a B-type branch can reach `byteOffset` away - a 13 bit signed offset, so +-4 KiB.
+auto branchReaches(int byteOffset) -> bool;
+/// Whether a `jal` can reach `byteOffset` away - a 21 bit signed offset, so +-1 MiB.
+auto jalReaches(int byteOffset) -> bool;
+
+/// Whether the branch or call at `instructionIndex` was relaxed.
+auto isRelaxed(int instructionIndex) -> bool;
+
+/// Makes each site in relaxableSites that can't reach its label two instructions long:
+///
+///     beq x1, x2, far       bne x1, x2, 8
+///                    ->     jal x0, far
+///
+///     call far              auipc x1, %hi(far)
+///                    ->     jalr x1, %lo(far)(x1)
+///
+/// Sites only ever grow, and each one that does pushes back everything after it - which can push
+/// another out of reach. So this goes round until none do. Where things have moved to is kept as
+/// a count of relaxed sites over the (sorted) sites, in a Fenwick tree, so each check is a binary
+/// search and a logarithmic sum - whatever the size of the program.
+///
+/// Alignment padding (see Alignment.hpp) goes in the same layout: it's worked out again each time
+/// round, from where everything before it has got to.
+///
+/// Then moves the labels, and the emit pass's checkpoints, to match, fills in relaxedSites, and
+/// says where each alignment site's padding goes and how long it is. Returns how many instructions
+/// (relaxed sites and padding) were added.
+auto relaxSites(vector<Checkpoint>& checkpoints) -> int;
+
+/// The pair of instructions a relaxed `branch` becomes, given how far its target is from it.
+/// Nothing if even the `jal` can't reach.
+auto relaxedBranch(uint32_t branch, int byteOffset) -> optional<pair<uint32_t, uint32_t>>;
+
+/// The `auipc` / `jalr` pair that jumps `byteOffset` from the `auipc`, going through `scratch` and
+/// linking to `rd`.
+auto farJump(unsigned int rd, unsigned int scratch, int byteOffset) -> pair<uint32_t, uint32_t>;
+
+}
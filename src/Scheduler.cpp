@@ -0,0 +1,358 @@
+#include "Scheduler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+#include "Alignment.hpp"
+#include "colors.h"
+
+namespace DcsEmbler {
+
+namespace {
+
+constexpr uint8_t LUI = 0b0110111;
+constexpr uint8_t JAL = 0b1101111;
+constexpr uint8_t JALR = 0b1100111;
+constexpr uint8_t BRANCH = 0b1100011;
+constexpr uint8_t LOAD = 0b0000011;
+constexpr uint8_t STORE = 0b0100011;
+constexpr uint8_t OP_IMM = 0b0010011;
+constexpr uint8_t OP = 0b0110011;
+
+/// Longer blocks are scheduled a window at a time, so the dependencies fit in a word per instruction.
+constexpr size_t maxWindow = 64;
+
+enum class Kind : uint8_t { alu, multiply, divide, load, store, branch, jump, barrier };
+
+/// What an instruction reads and writes, going by its format. x0 is neither.
+struct Registers {
+    Kind kind = Kind::barrier;
+    uint8_t defined = 0;
+    uint8_t used[2]{};
+    uint8_t usedCount = 0;
+
+    auto use(uint8_t r) -> void {
+        if (r != 0) used[usedCount++] = r;
+    }
+};
+
+auto registersOf(const DecodedInstruction& d) -> Registers {
+    Registers r{};
+    if (d.relocated) return r;
+
+    switch (d.opcode) {
+        case LUI:
+            r.kind = Kind::alu;
+            r.defined = d.rd;
+            break;
+        case OP_IMM:
+            r.kind = Kind::alu;
+            r.defined = d.rd;
+            r.use(d.rs1);
+            break;
+        case OP:
+            // funct7 = 0x01 is the M extension - multiplies, then divides and remainders.
+            r.kind = d.funct7 != 0b0000001 ? Kind::alu : d.funct3 < 0b100 ? Kind::multiply : Kind::divide;
+            r.defined = d.rd;
+            r.use(d.rs1);
+            r.use(d.rs2);
+            break;
+        case LOAD:
+            r.kind = Kind::load;
+            r.defined = d.rd;
+            r.use(d.rs1);
+            break;
+        case STORE:
+            r.kind = Kind::store;
+            r.use(d.rs1);
+            r.use(d.rs2);
+            break;
+        case BRANCH:
+            r.kind = Kind::branch;
+            r.use(d.rs1);
+            r.use(d.rs2);
+            break;
+        case JAL:
+            r.kind = Kind::jump;
+            r.defined = d.rd;
+            break;
+        case JALR:
+            r.kind = Kind::jump;
+            r.defined = d.rd;
+            r.use(d.rs1);
+            break;
+        default:
+            // auipc, system, fence - or something that isn't RV32I at all.
+            break;
+    }
+    return r;
+}
+
+auto latencyOf(Kind kind, const Latencies& latencies) -> int {
+    switch (kind) {
+        case Kind::alu: return latencies.alu;
+        case Kind::multiply: return latencies.multiply;
+        case Kind::divide: return latencies.divide;
+        case Kind::load: return latencies.load;
+        case Kind::jump: return latencies.jump;
+        default: return 1;
+    }
+}
+
+/// How much earlier than anything else a branch or jalr wants its operands.
+auto operandLead(const DecodedInstruction& d, const Latencies& latencies) -> int {
+    return d.opcode == BRANCH or d.opcode == JALR ? latencies.branch : 0;
+}
+
+auto endsBlock(const DecodedInstruction& d) -> bool {
+    return d.opcode == BRANCH or d.opcode == JAL or d.opcode == JALR;
+}
+
+auto isMemory(Kind kind) -> bool {
+    return kind == Kind::load or kind == Kind::store;
+}
+
+/// The order to list `n` (up to maxWindow) instructions in. The last stays last if `fixedLast`.
+auto scheduleWindow(const DecodedInstruction* block, size_t n, bool fixedLast, const Latencies& latencies)
+        -> array<uint8_t, maxWindow> {
+    struct ReadAfterWrite {
+        uint8_t writer;
+        uint8_t latency;
+    };
+    array<uint64_t, maxWindow> predecessors{};
+    array<array<ReadAfterWrite, 2>, maxWindow> reads{};
+    array<uint8_t, maxWindow> readCount{};
+
+    array<int, 32> lastWriter;
+    lastWriter.fill(-1);
+    array<uint64_t, 32> readers{};
+    int lastMemory = -1;
+
+    for (size_t j = 0; j < n; j++) {
+        const auto r = registersOf(block[j]);
+        for (uint8_t u = 0; u < r.usedCount; u++) {
+            const int writer = lastWriter[r.used[u]];
+            if (writer < 0) continue;
+            predecessors[j] |= 1ull << writer;
+            const int latency = latencyOf(registersOf(block[writer]).kind, latencies) + operandLead(block[j], latencies);
+            reads[j][readCount[j]++] = {(uint8_t) writer, (uint8_t) latency};
+        }
+        if (r.defined != 0) {
+            predecessors[j] |= readers[r.defined];
+            if (lastWriter[r.defined] >= 0) predecessors[j] |= 1ull << lastWriter[r.defined];
+        }
+        if (isMemory(r.kind)) {
+            if (lastMemory >= 0) predecessors[j] |= 1ull << lastMemory;
+            lastMemory = (int) j;
+        }
+
+        for (uint8_t u = 0; u < r.usedCount; u++) readers[r.used[u]] |= 1ull << j;
+        if (r.defined != 0) {
+            lastWriter[r.defined] = (int) j;
+            readers[r.defined] = 0;
+        }
+    }
+    // After everything else.
+    if (fixedLast) predecessors[n - 1] = (1ull << (n - 1)) - 1;
+
+    // The longest path (in cycles) from each to the end - what's on it should go first.
+    array<int, maxWindow> height{};
+    for (size_t j = n; j-- > 0;) {
+        for (size_t s = j + 1; s < n; s++) {
+            if (not (predecessors[s] >> j & 1)) continue;
+            int edge = 1;
+            for (uint8_t k = 0; k < readCount[s]; k++) {
+                if (reads[s][k].writer == j) edge = max(edge, (int) reads[s][k].latency);
+            }
+            height[j] = max(height[j], height[s] + edge);
+        }
+    }
+
+    array<uint8_t, maxWindow> order{};
+    array<int, maxWindow> issuedAt{};
+    uint64_t listed = 0;
+    int cycle = 0;
+    for (size_t step = 0; step < n; step++) {
+        int best = -1;
+        int bestAt = 0;
+        for (size_t j = 0; j < n; j++) {
+            if (listed >> j & 1 or (predecessors[j] & ~listed) != 0) continue;
+            int at = cycle;
+            for (uint8_t k = 0; k < readCount[j]; k++) {
+                at = max(at, issuedAt[reads[j][k].writer] + reads[j][k].latency);
+            }
+            if (best < 0 or at < bestAt or (at == bestAt and height[j] > height[best])) {
+                best = (int) j;
+                bestAt = at;
+            }
+        }
+        order[step] = (uint8_t) best;
+        issuedAt[best] = bestAt;
+        listed |= 1ull << best;
+        cycle = bestAt + 1;
+    }
+    return order;
+}
+
+auto trimmed(const string& s) -> string {
+    const size_t first = s.find_first_not_of(" \t\r");
+    if (first == string::npos) return {};
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+}
+
+auto parseLatencies(const string& text, const string& source) -> optional<Latencies> {
+    Latencies latencies{};
+    istringstream lines{text};
+    string line;
+    for (int lineNumber = 1; getline(lines, line); lineNumber++) {
+        line = trimmed(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        const size_t equals = line.find('=');
+        if (equals == string::npos) {
+            printf(RED "Error:" RESET " %s, line %i: expected 'name = cycles'.\n", source.c_str(), lineNumber);
+            return {};
+        }
+        const string name = trimmed(line.substr(0, equals));
+        const string value = trimmed(line.substr(equals + 1));
+
+        int* field = name == "alu" ? &latencies.alu
+                   : name == "multiply" ? &latencies.multiply
+                   : name == "divide" ? &latencies.divide
+                   : name == "load" ? &latencies.load
+                   : name == "jump" ? &latencies.jump
+                   : name == "branch" ? &latencies.branch
+                   : nullptr;
+        if (not field) {
+            printf(RED "Error:" RESET " %s, line %i: no latency called '" YELLOW "%s" RESET "' - there's alu, multiply,"
+                   " divide, load, jump and branch.\n", source.c_str(), lineNumber, name.c_str());
+            return {};
+        }
+
+        char* end = nullptr;
+        const long cycles = strtol(value.c_str(), &end, 10);
+        if (value.empty() or *end != '\0' or cycles < 0 or cycles > 64) {
+            printf(RED "Error:" RESET " %s, line %i: '" YELLOW "%s" RESET "' isn't a number of cycles (0 to 64).\n",
+                   source.c_str(), lineNumber, value.c_str());
+            return {};
+        }
+        *field = (int) cycles;
+    }
+    return latencies;
+}
+
+auto readLatencies(const string& path) -> optional<Latencies> {
+    if (not filesystem::is_regular_file(path)) {
+        printf(RED "Error:" RESET " No latency file at '" YELLOW "%s" RESET "'.\n", path.c_str());
+        return {};
+    }
+    return parseLatencies(readFileToString(path), path);
+}
+
+auto countStalls(const DecodedInstruction* first, size_t count, const Latencies& latencies) -> int {
+    // Long enough ago that anything from before the block is ready.
+    array<int, 32> ready;
+    ready.fill(-1000);
+
+    int cycle = 0;
+    int stalls = 0;
+    for (size_t i = 0; i < count; i++) {
+        const auto r = registersOf(first[i]);
+        const int lead = operandLead(first[i], latencies);
+        int issue = cycle;
+        for (uint8_t u = 0; u < r.usedCount; u++) issue = max(issue, ready[r.used[u]] + lead);
+
+        stalls += issue - cycle;
+        if (r.defined != 0) ready[r.defined] = issue + latencyOf(r.kind, latencies);
+        cycle = issue + 1;
+    }
+    return stalls;
+}
+
+auto scheduleImage(Image& image, const LabelSet& labels, const Latencies& latencies) -> ScheduleReport {
+    const size_t count = image.size() / 4;
+
+    vector<DecodedInstruction> program{};
+    program.reserve(count);
+    for (size_t at = 0; at < image.size(); at += 4) program.push_back(decode(image.wordAt(at)));
+    for (const auto& relocation : image.relocations) program[relocation.offset / 4].relocated = true;
+
+    vector<bool> startsBlock(count + 1, false);
+    for (const auto& [ name, label ] : labels) {
+        if (label.instructionIndex >= 0 and label.instructionIndex <= (int) count) startsBlock[label.instructionIndex] = true;
+    }
+    // Padding stays put, and so does the instruction it lines up - each is a block of its own.
+    for (const auto& site : alignmentSites) {
+        for (int at = site.instructionIndex; at <= site.instructionIndex + site.padding + 1; at++) {
+            if (at >= 0 and at <= (int) count) startsBlock[at] = true;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        const auto& d = program[i];
+        if (d.relocated or (d.opcode != BRANCH and d.opcode != JAL)) continue;
+        const int64_t target = (int64_t) i + d.immediate / 4;
+        if (target >= 0 and target <= (int64_t) count) startsBlock[target] = true;
+    }
+
+    ScheduleReport report{};
+    vector<DecodedInstruction> reordered(maxWindow);
+    for (size_t begin = 0; begin < count;) {
+        // Something that stands alone is a block of one.
+        size_t end = begin + 1;
+        if (registersOf(program[begin]).kind != Kind::barrier) {
+            while (end < count and end - begin < maxWindow and not endsBlock(program[end - 1]) and not startsBlock[end]
+                   and registersOf(program[end]).kind != Kind::barrier) {
+                end++;
+            }
+        }
+        const size_t n = end - begin;
+
+        const int before = countStalls(&program[begin], n, latencies);
+        int after = before;
+        if (before > 0) {
+            const auto order = scheduleWindow(&program[begin], n, endsBlock(program[end - 1]), latencies);
+            for (size_t k = 0; k < n; k++) reordered[k] = program[begin + order[k]];
+            after = countStalls(reordered.data(), n, latencies);
+
+            if (after < before) {
+                for (size_t k = 0; k < n; k++) image.setWordAt((begin + k) * 4, reordered[k].word);
+                report.reordered++;
+                report.mostImproved.push_back({(uint32_t) begin * 4, (int) n, before, after});
+            } else {
+                after = before;
+            }
+        }
+
+        report.blocks++;
+        report.stallsBefore += (uint64_t) before;
+        report.stallsAfter += (uint64_t) after;
+        begin = end;
+    }
+
+    auto improvement = [](const ScheduledBlock& b) { return b.stallsBefore - b.stallsAfter; };
+    const size_t kept = min(report.mostImproved.size(), mostImprovedBlocks);
+    partial_sort(report.mostImproved.begin(), report.mostImproved.begin() + (ptrdiff_t) kept, report.mostImproved.end(),
+                 [&](const auto& a, const auto& b) {
+                     return improvement(a) != improvement(b) ? improvement(a) > improvement(b) : a.offset < b.offset;
+                 });
+    report.mostImproved.resize(kept);
+
+    return report;
+}
+
+auto printScheduleReport(FILE* f, const ScheduleReport& report) -> void {
+    fprintf(f, "Scheduling: " YELLOWC("%" PRIu64) " of %" PRIu64 " blocks reordered, %" PRIu64 " stalls down to %" PRIu64 ".\n",
+            report.reordered, report.blocks, report.stallsBefore, report.stallsAfter);
+    for (const auto& block : report.mostImproved) {
+        fprintf(f, "  " GREENC("0x%08X") " %4d instructions  %3d -> %d stalls\n",
+                block.offset, block.instructions, block.stallsBefore, block.stallsAfter);
+    }
+}
+
+}
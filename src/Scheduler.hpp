@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Assembler.hpp"
+#include "Image.hpp"
+#include "Peephole.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// How the DCS core's pipeline is modelled for scheduling: how many cycles after an instruction
+/// issues its result can be used by the next, by what kind of instruction it is. An instruction
+/// that needs a result before then stalls until it's there.
+struct Latencies {
+    /// Arithmetic, logic, shifts, lui.
+    int alu = 1;
+    /// mul, mulh, mulhsu, mulhu.
+    int multiply = 1;
+    /// div, divu, rem, remu.
+    int divide = 32;
+    /// The classic load-use hazard - 2 is one delay slot to fill.
+    int load = 2;
+    /// The link register of a jal or jalr.
+    int jump = 1;
+    /// On top of the above, for a branch (or jalr) - which compares (or adds) earlier in the pipeline
+    /// than anything else reads its operands.
+    int branch = 0;
+};
+
+/// Reads `name = value` lines (`#` to the end of a line is a comment) into a Latencies - any left
+/// out keep their defaults. Says what's wrong, with `source` and the line number, and returns
+/// nothing for an unknown name or a value that isn't a number from 0 to 64.
+auto parseLatencies(const string& text, const string& source) -> optional<Latencies>;
+/// parseLatencies, on the file at `path`.
+auto readLatencies(const string& path) -> optional<Latencies>;
+
+/// How many cycles `count` instructions stall for, run in order from `first` on a core that only
+/// ever issues one a cycle - with every register ready to start with.
+auto countStalls(const DecodedInstruction* first, size_t count, const Latencies& latencies) -> int;
+
+/// One basic block the scheduler reordered.
+struct ScheduledBlock {
+    /// In bytes, from the start of the image.
+    uint32_t offset = 0;
+    int instructions = 0;
+    int stallsBefore = 0;
+    int stallsAfter = 0;
+};
+
+struct ScheduleReport {
+    uint64_t blocks = 0;
+    uint64_t reordered = 0;
+    uint64_t stallsBefore = 0;
+    uint64_t stallsAfter = 0;
+    /// The blocks that lost the most stalls, most first.
+    vector<ScheduledBlock> mostImproved{};
+};
+
+/// How many blocks printScheduleReport lists.
+inline constexpr size_t mostImprovedBlocks = 8;
+
+/// Reorders the instructions of each basic block so fewer of them wait on a result.
+///
+/// A block starts at a label, anything jumped to or anything aligned, and ends after a branch, jal
+/// or jalr - which stays at the end. auipc (whose result depends on where it is), system
+/// instructions, fences, anything with a relocation, anything that doesn't decode, and each nop of
+/// alignment padding and what it lines up are blocks of their own. So labels, relocations and
+/// aligned code never move, and neither does anything else that knows its own address.
+///
+/// Within a block, the dependency DAG comes from the register fields of each format: an
+/// instruction comes after whatever wrote what it reads (at least the writer's latency after, to
+/// not stall), and after whatever read or wrote what it writes. Loads and stores keep their
+/// order - anything in memory might be a device. Instructions are then listed greedily, each time
+/// taking whichever is ready soonest, and of those the one with the longest latency path to the end
+/// of the block. A block is only rewritten if that stalls less than it did.
+auto scheduleImage(Image& image, const LabelSet& labels, const Latencies& latencies) -> ScheduleReport;
+
+auto printScheduleReport(FILE* f, const ScheduleReport& report) -> void;
+
+}
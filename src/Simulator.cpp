@@ -0,0 +1,244 @@
+#include "Simulator.hpp"
+
+#include "Compression.hpp"
+
+#include <algorithm>
+
+namespace DcsEmbler {
+
+auto stopReasonName(StopReason reason) -> const char* {
+    switch (reason) {
+        case StopReason::ecall: return "ecall";
+        case StopReason::ebreak: return "ebreak";
+        case StopReason::selfLoop: return "jump to self";
+        case StopReason::fetchFault: return "instruction fetch outside of memory";
+        case StopReason::memoryFault: return "load/store outside of memory";
+        case StopReason::illegalInstruction: return "illegal instruction";
+        case StopReason::stepLimit: return "step limit reached";
+    }
+    return "unknown";
+}
+
+Simulator::Simulator(const Image& image, uint32_t loadAddress, size_t scratchBytes)
+    : pc(loadAddress) {
+    memory.resize(loadAddress + image.size() + scratchBytes);
+    copy(image.bytes.begin(), image.bytes.end(), memory.begin() + loadAddress);
+}
+
+auto Simulator::load(uint32_t address, int bytes, bool signExtend, bool& fault) -> uint32_t {
+    if ((uint64_t) address + bytes > memory.size()) {
+        fault = true;
+        return 0;
+    }
+
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | memory[address + i];
+    }
+
+    if (signExtend and bytes < 4) {
+        const int shift = 32 - 8 * bytes;
+        value = (uint32_t) (((int32_t) (value << shift)) >> shift);
+    }
+    return value;
+}
+
+auto Simulator::store(uint32_t address, int bytes, uint32_t value, bool& fault) -> void {
+    if ((uint64_t) address + bytes > memory.size()) {
+        fault = true;
+        return;
+    }
+
+    for (int i = 0; i < bytes; i++) {
+        memory[address + i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+auto Simulator::step() -> Step {
+    Step s{.pc = pc};
+
+    // Instructions are 2-byte aligned, as there might be compressed ones.
+    if ((uint64_t) pc + 2 > memory.size() or pc % 2 != 0) {
+        s.stop = StopReason::fetchFault;
+        return s;
+    }
+
+    // A compressed instruction runs as the 32-bit one it stands for, but is only 2 bytes long.
+    const auto parcel = (uint16_t) (memory[pc] | (memory[pc + 1] << 8));
+    uint32_t length = 4;
+    uint32_t ins;
+    if (isCompressed(parcel)) {
+        const auto expanded = expandCompressed(parcel);
+        if (not expanded) {
+            s.stop = StopReason::illegalInstruction;
+            return s;
+        }
+        ins = *expanded;
+        length = 2;
+    } else {
+        if ((uint64_t) pc + 4 > memory.size()) {
+            s.stop = StopReason::fetchFault;
+            return s;
+        }
+        ins = parcel | (memory[pc + 2] << 16) | ((uint32_t) memory[pc + 3] << 24);
+    }
+    s.instruction = ins;
+
+    const uint32_t opcode = ins & 0x7f;
+    const uint32_t rd     = (ins >> 7) & 0x1f;
+    const uint32_t funct3 = (ins >> 12) & 0x7;
+    const uint32_t rs1    = (ins >> 15) & 0x1f;
+    const uint32_t rs2    = (ins >> 20) & 0x1f;
+    const uint32_t funct7 = ins >> 25;
+
+    const int32_t immI = (int32_t) ins >> 20;
+    const int32_t immS = ((int32_t) ins >> 25 << 5) | (int32_t) ((ins >> 7) & 0x1f);
+    const int32_t immB = ((int32_t) ins >> 31 << 12) | (int32_t) (((ins >> 7) & 0x1) << 11)
+                       | (int32_t) (((ins >> 25) & 0x3f) << 5) | (int32_t) (((ins >> 8) & 0xf) << 1);
+    const int32_t immJ = ((int32_t) ins >> 31 << 20) | (int32_t) (ins & 0xff000)
+                       | (int32_t) (((ins >> 20) & 0x1) << 11) | (int32_t) (((ins >> 21) & 0x3ff) << 1);
+
+    const uint32_t a = x[rs1];
+    const uint32_t b = x[rs2];
+
+    uint32_t nextPc = pc + length;
+    bool fault = false;
+
+    switch (opcode) {
+        case 0b0110111: // LUI
+            x[rd] = ins & 0xfffff000;
+            s.cycles = cycleModel.alu;
+            break;
+        case 0b0010111: // AUIPC
+            x[rd] = pc + (ins & 0xfffff000);
+            s.cycles = cycleModel.alu;
+            break;
+        case 0b1101111: // JAL
+            x[rd] = pc + length;
+            nextPc = pc + immJ;
+            s.cycles = cycleModel.jump;
+            break;
+        case 0b1100111: // JALR
+            nextPc = (a + immI) & ~1u;
+            x[rd] = pc + length;
+            s.cycles = cycleModel.jump;
+            break;
+        case 0b1100011: { // Branches
+            bool taken = false;
+            switch (funct3) {
+                case 0b000: taken = a == b; break;
+                case 0b001: taken = a != b; break;
+                case 0b100: taken = (int32_t) a < (int32_t) b; break;
+                case 0b101: taken = (int32_t) a >= (int32_t) b; break;
+                case 0b110: taken = a < b; break;
+                case 0b111: taken = a >= b; break;
+                default: s.stop = StopReason::illegalInstruction; return s;
+            }
+            if (taken) nextPc = pc + immB;
+            s.cycles = taken ? cycleModel.branchTaken : cycleModel.branchNotTaken;
+            break;
+        }
+        case 0b0000011: { // Loads
+            const uint32_t address = a + immI;
+            switch (funct3) {
+                case 0b000: x[rd] = load(address, 1, true, fault); break;
+                case 0b001: x[rd] = load(address, 2, true, fault); break;
+                case 0b010: x[rd] = load(address, 4, false, fault); break;
+                case 0b100: x[rd] = load(address, 1, false, fault); break;
+                case 0b101: x[rd] = load(address, 2, false, fault); break;
+                default: s.stop = StopReason::illegalInstruction; return s;
+            }
+            s.cycles = cycleModel.load;
+            break;
+        }
+        case 0b0100011: { // Stores
+            const uint32_t address = a + immS;
+            switch (funct3) {
+                case 0b000: store(address, 1, b, fault); break;
+                case 0b001: store(address, 2, b, fault); break;
+                case 0b010: store(address, 4, b, fault); break;
+                default: s.stop = StopReason::illegalInstruction; return s;
+            }
+            s.cycles = cycleModel.store;
+            break;
+        }
+        case 0b0010011: { // OP-IMM
+            const uint32_t shamt = rs2;
+            switch (funct3) {
+                case 0b000: x[rd] = a + immI; break;
+                case 0b010: x[rd] = (int32_t) a < immI; break;
+                case 0b011: x[rd] = a < (uint32_t) immI; break;
+                case 0b100: x[rd] = a ^ immI; break;
+                case 0b110: x[rd] = a | immI; break;
+                case 0b111: x[rd] = a & immI; break;
+                case 0b001: x[rd] = a << shamt; break;
+                case 0b101:
+                    x[rd] = (funct7 & 0x20) ? (uint32_t) ((int32_t) a >> shamt) : a >> shamt;
+                    break;
+            }
+            s.cycles = cycleModel.alu;
+            break;
+        }
+        case 0b0110011: { // OP
+            if (funct7 == 0b0000001) {
+                // The M extension. Dividing by zero and overflowing don't trap - they give what the
+                // spec says they do.
+                const auto sa = (int64_t) (int32_t) a;
+                const auto sb = (int64_t) (int32_t) b;
+                const bool overflow = (int32_t) a == INT32_MIN and (int32_t) b == -1;
+                switch (funct3) {
+                    case 0b000: x[rd] = a * b; break;
+                    case 0b001: x[rd] = (uint32_t) ((sa * sb) >> 32); break;
+                    case 0b010: x[rd] = (uint32_t) ((uint64_t) (sa * (int64_t) b) >> 32); break;
+                    case 0b011: x[rd] = (uint32_t) (((uint64_t) a * b) >> 32); break;
+                    case 0b100: x[rd] = b == 0 ? UINT32_MAX : overflow ? a : (uint32_t) ((int32_t) a / (int32_t) b); break;
+                    case 0b101: x[rd] = b == 0 ? UINT32_MAX : a / b; break;
+                    case 0b110: x[rd] = b == 0 ? a : overflow ? 0 : (uint32_t) ((int32_t) a % (int32_t) b); break;
+                    case 0b111: x[rd] = b == 0 ? a : a % b; break;
+                }
+                s.cycles = funct3 < 0b100 ? cycleModel.multiply : cycleModel.divide;
+                break;
+            }
+            switch (funct3) {
+                case 0b000: x[rd] = (funct7 & 0x20) ? a - b : a + b; break;
+                case 0b001: x[rd] = a << (b & 0x1f); break;
+                case 0b010: x[rd] = (int32_t) a < (int32_t) b; break;
+                case 0b011: x[rd] = a < b; break;
+                case 0b100: x[rd] = a ^ b; break;
+                case 0b101:
+                    x[rd] = (funct7 & 0x20) ? (uint32_t) ((int32_t) a >> (b & 0x1f)) : a >> (b & 0x1f);
+                    break;
+                case 0b110: x[rd] = a | b; break;
+                case 0b111: x[rd] = a & b; break;
+            }
+            s.cycles = cycleModel.alu;
+            break;
+        }
+        case 0b0001111: // FENCE - nothing to do, we only have one hart.
+            s.cycles = cycleModel.alu;
+            break;
+        case 0b1110011: // SYSTEM
+            s.cycles = cycleModel.system;
+            s.stop = (immI == 1) ? StopReason::ebreak : StopReason::ecall;
+            break;
+        default:
+            s.stop = StopReason::illegalInstruction;
+            return s;
+    }
+
+    x[0] = 0;
+
+    instructionsRetired++;
+    cycles += s.cycles;
+
+    if (fault) {
+        s.stop = StopReason::memoryFault;
+    } else if (nextPc == pc and not s.stop) {
+        s.stop = StopReason::selfLoop;
+    }
+
+    pc = nextPc;
+    return s;
+}
+
+}
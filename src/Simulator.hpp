@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "Image.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// How many cycles each class of instruction is modelled as taking on the DCS core.
+/// These are deliberately coarse - they're for finding hot spots, not for cycle-accurate timing.
+struct CycleModel {
+    int alu = 1;
+    /// The M extension - a single-cycle multiplier, and a divider that works a bit at a time.
+    int multiply = 1;
+    int divide = 32;
+    int load = 2;
+    int store = 1;
+    int branchTaken = 3;
+    int branchNotTaken = 1;
+    int jump = 2;
+    int system = 1;
+};
+
+enum class StopReason : unsigned short {
+    ecall, ebreak, selfLoop, fetchFault, memoryFault, illegalInstruction, stepLimit
+};
+
+auto stopReasonName(StopReason reason) -> const char*;
+
+/// A small RV32IM interpreter - just enough to run an assembled image and see where it spends its time.
+struct Simulator {
+    /// The result of executing a single instruction.
+    struct Step {
+        uint32_t pc = 0;
+        uint32_t instruction = 0;
+        int cycles = 0;
+        /// Set when the program can't (or shouldn't) continue after this step.
+        optional<StopReason> stop{};
+    };
+
+    array<uint32_t, 32> x{};
+    uint32_t pc = 0;
+    /// Memory starts at address 0 and covers the image plus some scratch space above it.
+    vector<uint8_t> memory{};
+    CycleModel cycleModel{};
+
+    uint64_t instructionsRetired = 0;
+    uint64_t cycles = 0;
+
+    /// Loads the image at the given address and points the pc at its first instruction.
+    Simulator(const Image& image, uint32_t loadAddress, size_t scratchBytes = 1 << 20);
+
+    auto step() -> Step;
+
+private:
+    auto load(uint32_t address, int bytes, bool signExtend, bool& fault) -> uint32_t;
+    auto store(uint32_t address, int bytes, uint32_t value, bool& fault) -> void;
+};
+
+}
@@ -0,0 +1,232 @@
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
+#include <mutex>
+
+#include <sys/resource.h>
+
+#include "colors.h"
+
+namespace DcsEmbler {
+
+Stats stats{};
+
+auto phaseName(Phase phase) -> const char* {
+    switch (phase) {
+        case Phase::read: return "read";
+        case Phase::labelPass: return "label pass";
+        case Phase::emitPass: return "emit pass";
+        case Phase::write: return "write";
+    }
+    return "unknown";
+}
+
+namespace {
+
+auto secondsOn(clockid_t clock) -> double {
+    timespec t{};
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+auto instructionsPerCycle(const CounterValues& c) -> double {
+    const auto cycles = c[(size_t) Counter::cycles];
+    return cycles ? (double) c[(size_t) Counter::instructions] / cycles : 0.0;
+}
+
+/// JSON keys can't have spaces in them nicely, so `label pass` becomes `label_pass`.
+auto jsonKey(Phase phase) -> string {
+    string key{phaseName(phase)};
+    replace(key.begin(), key.end(), ' ', '_');
+    return key;
+}
+
+}
+
+PhaseTimer::PhaseTimer(Phase phase) : phase(phase), running(stats.enabled) {
+    if (running) {
+        if (stats.countersEnabled) countersStart = perfCounters.read();
+        wallStart = secondsOn(CLOCK_MONOTONIC);
+        cpuStart = secondsOn(CLOCK_PROCESS_CPUTIME_ID);
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (running) {
+        auto& p = stats.phases[(size_t) phase];
+        p.wallSeconds += secondsOn(CLOCK_MONOTONIC) - wallStart;
+        p.cpuSeconds += secondsOn(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+
+        if (stats.countersEnabled) {
+            const auto now = perfCounters.read();
+            auto& c = stats.counters[(size_t) phase];
+            for (size_t i = 0; i < counterCount; i++) c[i] += now[i] - countersStart[i];
+        }
+    }
+}
+
+namespace {
+
+/// The emit pass can run on several threads.
+mutex mnemonicsLock{};
+
+}
+
+auto Stats::countMnemonic(string_view mnemonic) -> void {
+    lock_guard lock{mnemonicsLock};
+    auto it = mnemonics.find(mnemonic);
+    if (it == mnemonics.end()) {
+        mnemonics.emplace(string{mnemonic}, 1);
+    } else {
+        it->second++;
+    }
+}
+
+auto labelTableShape(const LabelSet& labels) -> LabelTableShape {
+    LabelTableShape shape{};
+    shape.labels = labels.size();
+    shape.buckets = labels.bucket_count();
+    shape.loadFactor = labels.load_factor();
+
+    // Finding the k-th node of a bucket's chain takes k probes.
+    uint64_t totalProbes = 0;
+    for (size_t b = 0; b < labels.bucket_count(); b++) {
+        const size_t length = labels.bucket_size(b);
+        totalProbes += length * (length + 1) / 2;
+        shape.maxProbeLength = max(shape.maxProbeLength, length);
+    }
+    shape.meanProbeLength = labels.empty() ? 0 : (double) totalProbes / labels.size();
+
+    return shape;
+}
+
+auto peakRssKib() -> long {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+auto Stats::print(FILE* f, const LabelSet& labels) const -> void {
+    double wall = 0;
+    double cpu = 0;
+    for (const auto& p : phases) {
+        wall += p.wallSeconds;
+        cpu += p.cpuSeconds;
+    }
+
+    fprintf(f, "Stats for %" PRIu64 " lines (%" PRIu64 " bytes), %" PRIu64 " instructions:\n",
+            lines, bytes, instructions);
+    fprintf(f, "  %-12s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+    for (size_t i = 0; i < phaseCount; i++) {
+        fprintf(f, "  %-12s %12.3f %12.3f\n", phaseName((Phase) i),
+                phases[i].wallSeconds * 1e3, phases[i].cpuSeconds * 1e3);
+    }
+    fprintf(f, "  %-12s %12.3f %12.3f\n", "total", wall * 1e3, cpu * 1e3);
+
+    if (wall > 0) {
+        fprintf(f, "  Throughput: " YELLOWC("%.0f lines/s") ", " YELLOWC("%.2f MB/s") "\n",
+                lines / wall, bytes / wall / 1e6);
+    }
+
+    if (countersEnabled) {
+        fprintf(f, "  %-12s", "counters");
+        for (size_t c = 0; c < counterCount; c++) {
+            if (perfCounters.available((Counter) c)) fprintf(f, " %14s", counterName((Counter) c));
+        }
+        fprintf(f, " %6s\n", "IPC");
+
+        for (size_t i = 0; i < phaseCount; i++) {
+            fprintf(f, "  %-12s", phaseName((Phase) i));
+            for (size_t c = 0; c < counterCount; c++) {
+                if (perfCounters.available((Counter) c)) fprintf(f, " %14" PRIu64, counters[i][c]);
+            }
+            fprintf(f, " %6.2f\n", instructionsPerCycle(counters[i]));
+        }
+
+        if (lines > 0) {
+            fprintf(f, "  %-12s", "per line");
+            for (size_t c = 0; c < counterCount; c++) {
+                if (not perfCounters.available((Counter) c)) continue;
+                uint64_t total = 0;
+                for (const auto& phase : counters) total += phase[c];
+                fprintf(f, " %14.3f", (double) total / lines);
+            }
+            fprintf(f, "\n");
+        }
+    }
+
+    if (countersRequested and not countersEnabled) {
+        fprintf(f, "  (Hardware counters unavailable here - timing only.)\n");
+    }
+
+    const auto shape = labelTableShape(labels);
+    fprintf(f, "  Label table: %zu labels in %zu buckets (load factor %.2f), probe length mean %.2f / max %zu\n",
+            shape.labels, shape.buckets, shape.loadFactor, shape.meanProbeLength, shape.maxProbeLength);
+    fprintf(f, "  Peak RSS: %ld KiB\n", peakRssKib());
+
+    fprintf(f, "  Instructions by mnemonic:\n");
+    for (const auto& [ mnemonic, count ] : mnemonics) {
+        fprintf(f, "    " GREENC("%-8s") " %12" PRIu64 "\n", mnemonic.c_str(), count);
+    }
+}
+
+auto Stats::writeJson(FILE* f, const LabelSet& labels) const -> void {
+    double wall = 0;
+    double cpu = 0;
+    for (const auto& p : phases) {
+        wall += p.wallSeconds;
+        cpu += p.cpuSeconds;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"input\": { \"lines\": %" PRIu64 ", \"bytes\": %" PRIu64 " },\n", lines, bytes);
+
+    fprintf(f, "  \"phases\": {\n");
+    for (size_t i = 0; i < phaseCount; i++) {
+        fprintf(f, "    \"%s\": { \"wall_s\": %.9f, \"cpu_s\": %.9f },\n",
+                jsonKey((Phase) i).c_str(), phases[i].wallSeconds, phases[i].cpuSeconds);
+    }
+    fprintf(f, "    \"total\": { \"wall_s\": %.9f, \"cpu_s\": %.9f }\n", wall, cpu);
+    fprintf(f, "  },\n");
+
+    if (countersEnabled) {
+        fprintf(f, "  \"counters\": {\n");
+        for (size_t i = 0; i < phaseCount; i++) {
+            fprintf(f, "    \"%s\": {", jsonKey((Phase) i).c_str());
+            for (size_t c = 0; c < counterCount; c++) {
+                if (not perfCounters.available((Counter) c)) continue;
+                fprintf(f, " \"%s\": %" PRIu64 ",", counterName((Counter) c), counters[i][c]);
+                fprintf(f, " \"%s_per_line\": %.4f,", counterName((Counter) c),
+                        lines ? (double) counters[i][c] / lines : 0.0);
+            }
+            fprintf(f, " \"ipc\": %.4f }%s\n", instructionsPerCycle(counters[i]), i + 1 < phaseCount ? "," : "");
+        }
+        fprintf(f, "  },\n");
+    }
+
+    fprintf(f, "  \"throughput\": { \"lines_per_s\": %.1f, \"bytes_per_s\": %.1f },\n",
+            wall > 0 ? lines / wall : 0.0, wall > 0 ? bytes / wall : 0.0);
+
+    fprintf(f, "  \"instructions\": {\n");
+    fprintf(f, "    \"total\": %" PRIu64 ",\n", instructions);
+    fprintf(f, "    \"by_mnemonic\": {");
+    bool first = true;
+    for (const auto& [ mnemonic, count ] : mnemonics) {
+        fprintf(f, "%s\n      \"%s\": %" PRIu64, first ? "" : ",", mnemonic.c_str(), count);
+        first = false;
+    }
+    fprintf(f, "%s}\n", first ? "" : "\n    ");
+    fprintf(f, "  },\n");
+
+    const auto shape = labelTableShape(labels);
+    fprintf(f, "  \"label_table\": { \"size\": %zu, \"buckets\": %zu, \"load_factor\": %.4f, "
+               "\"mean_probe_length\": %.4f, \"max_probe_length\": %zu },\n",
+            shape.labels, shape.buckets, shape.loadFactor, shape.meanProbeLength, shape.maxProbeLength);
+
+    fprintf(f, "  \"peak_rss_kib\": %ld\n", peakRssKib());
+    fprintf(f, "}\n");
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "Assembler.hpp"
+#include "PerfCounters.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+enum class Phase : unsigned short { read, labelPass, emitPass, write };
+inline constexpr size_t phaseCount = 4;
+
+auto phaseName(Phase phase) -> const char*;
+
+struct PhaseTime {
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+};
+
+/// What --stats reports. Nothing in here is touched unless stats are enabled.
+struct Stats {
+    bool enabled = false;
+
+    array<PhaseTime, phaseCount> phases{};
+
+    /// Set when --perfCounters was asked for and perfCounters could open at least one counter.
+    bool countersEnabled = false;
+    bool countersRequested = false;
+    /// Hardware counter deltas, per phase.
+    array<CounterValues, phaseCount> counters{};
+
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+    /// As emitted, so `li` counts twice.
+    uint64_t instructions = 0;
+    /// Keyed by source mnemonic (so `mv` is counted as `mv`, not `addi`).
+    map<string, uint64_t, less<>> mnemonics{};
+
+    auto countMnemonic(string_view mnemonic) -> void;
+
+    /// Human readable, for the terminal.
+    auto print(FILE* f, const LabelSet& labels) const -> void;
+    auto writeJson(FILE* f, const LabelSet& labels) const -> void;
+};
+
+extern Stats stats;
+
+/// Adds the wall and CPU time spent in its scope to a phase - but only if stats are on.
+struct PhaseTimer {
+    explicit PhaseTimer(Phase phase);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    auto operator=(const PhaseTimer&) -> PhaseTimer& = delete;
+
+private:
+    Phase phase;
+    bool running;
+    double wallStart = 0;
+    double cpuStart = 0;
+    CounterValues countersStart{};
+};
+
+/// Shape of the label hash table, which is what the label pass and every branch/jump lean on.
+struct LabelTableShape {
+    size_t labels = 0;
+    size_t buckets = 0;
+    double loadFactor = 0;
+    /// Average number of nodes visited to find a label that is there.
+    double meanProbeLength = 0;
+    size_t maxProbeLength = 0;
+};
+
+auto labelTableShape(const LabelSet& labels) -> LabelTableShape;
+
+/// Peak resident set size of this process so far, in KiB.
+auto peakRssKib() -> long;
+
+}
@@ -0,0 +1,195 @@
+#include "SymbolMap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BlockWriter.hpp"
+#include "colors.h"
+
+namespace DcsEmbler {
+
+// The records are read and written as they sit in memory.
+static_assert(endian::native == endian::little, "Map indexes assume a little-endian host");
+
+namespace {
+
+/// Least significant byte first, so each pass is stable and the last one leaves everything in order.
+/// A pass where every key has the same byte there is skipped - for anything much under 16 MiB and
+/// 16M lines, that's most of them.
+template<typename T, typename KeyOf>
+auto radixSort(vector<T>& items, KeyOf keyOf) -> void {
+    constexpr int passes = 8;
+
+    // Every pass's histogram, from a single read of the keys.
+    array<array<size_t, 256>, passes> counts{};
+    for (const auto& item : items) {
+        const uint64_t key = keyOf(item);
+        for (int pass = 0; pass < passes; pass++) counts[pass][(key >> (8 * pass)) & 0xff]++;
+    }
+
+    vector<T> sorted(items.size());
+    for (int pass = 0; pass < passes; pass++) {
+        auto& count = counts[pass];
+        if (any_of(count.begin(), count.end(), [&](size_t n) { return n == items.size(); })) continue;
+
+        size_t offset = 0;
+        for (auto& n : count) {
+            const size_t inBucket = n;
+            n = offset;
+            offset += inBucket;
+        }
+        for (const auto& item : items) sorted[count[(keyOf(item) >> (8 * pass)) & 0xff]++] = item;
+        items.swap(sorted);
+    }
+}
+
+}
+
+auto sortedSymbols(const LabelSet& labels, uint32_t endAddress) -> vector<MapSymbol> {
+    vector<MapSymbol> symbols{};
+    symbols.reserve(labels.size());
+    for (const auto& [ name, label ] : labels) {
+        symbols.push_back({(uint32_t) instructionIndexToAddress(label.instructionIndex), 0, label.declaredOnLine, name});
+    }
+
+    // The line breaks ties, so the order doesn't depend on the hash table's.
+    radixSort(symbols, [](const MapSymbol& s) { return (uint64_t) s.address << 32 | (uint32_t) s.line; });
+
+    uint32_t next = endAddress;
+    for (size_t i = symbols.size(); i-- > 0;) {
+        if (i + 1 < symbols.size() and symbols[i + 1].address != symbols[i].address) next = symbols[i + 1].address;
+        symbols[i].size = next > symbols[i].address ? next - symbols[i].address : 0;
+    }
+
+    return symbols;
+}
+
+auto writeMapText(FILE* f, const vector<MapSymbol>& symbols) -> bool {
+    auto w = make_unique<BlockWriter>(f);
+
+    w->text("# address  size      line    name\n");
+    for (const auto& s : symbols) {
+        w->hex(s.address, 8);
+        w->text("  ");
+        w->hex(s.size, 8);
+        w->text("  ");
+        w->decimal((uint64_t) s.line, 6);
+        w->text("  ");
+        w->text(s.name);
+        w->character('\n');
+    }
+
+    w->flush();
+    return w->ok;
+}
+
+auto buildMapIndex(const vector<MapSymbol>& symbols, vector<uint8_t>& index) -> void {
+    string strings{};
+    vector<MapRecord> records(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) {
+        const auto& s = symbols[i];
+        records[i] = {s.address, s.size, (uint32_t) strings.size(), (uint32_t) s.line};
+        strings.append(s.name);
+        strings.push_back('\0');
+    }
+
+    MapHeader header{};
+    memcpy(header.magic, mapIndexMagic, sizeof(mapIndexMagic));
+    header.version = mapIndexVersion;
+    header.symbolCount = (uint32_t) records.size();
+    header.stringTableSize = (uint32_t) strings.size();
+
+    index.resize(sizeof(header) + records.size() * sizeof(MapRecord) + strings.size());
+    uint8_t* p = index.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    if (not records.empty()) memcpy(p, records.data(), records.size() * sizeof(MapRecord));
+    p += records.size() * sizeof(MapRecord);
+    memcpy(p, strings.data(), strings.size());
+}
+
+auto writeMapIndex(FILE* f, const vector<MapSymbol>& symbols) -> bool {
+    vector<uint8_t> index{};
+    buildMapIndex(symbols, index);
+    return fwrite(index.data(), 1, index.size(), f) == index.size();
+}
+
+SymbolMap::~SymbolMap() {
+    if (mapped) munmap((void*) data, size);
+}
+
+auto SymbolMap::open(const string& filePath) -> bool {
+    path = filePath;
+
+    const int fd = ::open(filePath.c_str(), O_RDONLY);
+    struct stat status{};
+    if (fd < 0 or fstat(fd, &status) != 0 or status.st_size == 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, RED "Error:" RESET " '%s' couldn't be read.\n", filePath.c_str());
+        return false;
+    }
+
+    void* p = mmap(nullptr, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, RED "Error:" RESET " '%s' couldn't be mapped in.\n", filePath.c_str());
+        return false;
+    }
+    mapped = true;
+
+    return openFrom(string_view{(const char*) p, (size_t) status.st_size}, filePath);
+}
+
+auto SymbolMap::openFrom(string_view contents, const string& filePath) -> bool {
+    path = filePath;
+    data = (const uint8_t*) contents.data();
+    size = contents.size();
+
+    auto broken = [&](const char* why) {
+        fprintf(stderr, RED "Error:" RESET " '%s' %s.\n", path.c_str(), why);
+        return false;
+    };
+
+    if (size < sizeof(MapHeader) or memcmp(data, mapIndexMagic, sizeof(mapIndexMagic)) != 0) {
+        return broken("isn't a map index");
+    }
+    if (header().version != mapIndexVersion) return broken("is from a different version of dcsembler");
+
+    const size_t expectedSize = sizeof(MapHeader) + (size_t) header().symbolCount * sizeof(MapRecord)
+                              + header().stringTableSize;
+    if (expectedSize > size or (header().stringTableSize and strings()[header().stringTableSize - 1] != '\0')) {
+        return broken("is cut short");
+    }
+    for (size_t i = 0; i < header().symbolCount; i++) {
+        if (records()[i].name >= header().stringTableSize) return broken("has a broken record");
+    }
+
+    return true;
+}
+
+auto SymbolMap::symbol(size_t index) const -> MapSymbol {
+    const auto& r = records()[index];
+    return {r.address, r.size, (int) r.line, strings() + r.name};
+}
+
+auto SymbolMap::find(uint32_t address) const -> optional<MapSymbol> {
+    const auto* begin = records();
+    const auto* end = begin + header().symbolCount;
+    const auto* it = upper_bound(begin, end, address, [](uint32_t a, const MapRecord& r) { return a < r.address; });
+    if (it == begin) return {};
+
+    --it;
+    // A symbol with nothing after it still has its own address.
+    if (address - it->address >= max(it->size, 1u)) return {};
+    return symbol((size_t) (it - begin));
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Assembler.hpp"
+
+using namespace std;
+
+namespace DcsEmbler {
+
+/// A label, as the map shows it.
+struct MapSymbol {
+    uint32_t address = 0;
+    /// Bytes up to the next symbol at a higher address (or the end of the image).
+    uint32_t size = 0;
+    int line = 0;
+    string_view name{};
+};
+
+/// Every label, sorted by address and then by the line it was declared on - a radix sort, as the
+/// addresses are dense integers. The names point into `labels`.
+auto sortedSymbols(const LabelSet& labels, uint32_t endAddress) -> vector<MapSymbol>;
+
+/// The map for people - one symbol a line, `address size line name`, with a header line.
+auto writeMapText(FILE* f, const vector<MapSymbol>& symbols) -> bool;
+
+/// The map for tools, which is little-endian and laid out as
+///
+///     MapHeader
+///     MapRecord[symbolCount]   sorted by address
+///     string table             symbol names, each NUL terminated
+///
+/// so it can be mapped in and binary searched for the symbol an address is in, without parsing.
+inline constexpr char mapIndexMagic[8] = {'!', '<', 'd', 'c', 's', 'm', 'a', 'p'};
+
+struct MapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint32_t stringTableSize;
+    uint32_t reserved;
+};
+
+struct MapRecord {
+    uint32_t address;
+    uint32_t size;
+    uint32_t name;
+    uint32_t line;
+};
+
+inline constexpr uint32_t mapIndexVersion = 1;
+
+auto buildMapIndex(const vector<MapSymbol>& symbols, vector<uint8_t>& index) -> void;
+auto writeMapIndex(FILE* f, const vector<MapSymbol>& symbols) -> bool;
+
+/// A map index, mapped in read only.
+class SymbolMap {
+public:
+    SymbolMap() = default;
+    ~SymbolMap();
+
+    SymbolMap(const SymbolMap&) = delete;
+    auto operator=(const SymbolMap&) -> SymbolMap& = delete;
+
+    /// Maps the index in and checks its header. Prints the problem and returns false if it can't.
+    auto open(const string& path) -> bool;
+    /// The same, for an index already in memory - which must outlive this.
+    auto openFrom(string_view contents, const string& path) -> bool;
+
+    [[nodiscard]]
+    auto symbolCount() const -> size_t { return header().symbolCount; }
+    [[nodiscard]]
+    auto symbol(size_t index) const -> MapSymbol;
+
+    /// The symbol `address` is in - one binary search. Where several symbols share an address,
+    /// the last one declared.
+    [[nodiscard]]
+    auto find(uint32_t address) const -> optional<MapSymbol>;
+
+    string path{};
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+
+    [[nodiscard]]
+    auto header() const -> const MapHeader& { return *(const MapHeader*) data; }
+    [[nodiscard]]
+    auto records() const -> const MapRecord* { return (const MapRecord*) (data + sizeof(MapHeader)); }
+    [[nodiscard]]
+    auto strings() const -> const char* { return (const char*) (records() + header().symbolCount); }
+};
+
+}
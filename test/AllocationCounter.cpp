@@ -0,0 +1,69 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+extern "C" {
+auto __libc_malloc(size_t size) -> void*;
+auto __libc_calloc(size_t count, size_t size) -> void*;
+auto __libc_realloc(void* p, size_t size) -> void*;
+}
+
+namespace {
+
+atomic<size_t> allocations{0};
+
+auto counted(size_t size) -> void* {
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+auto countedOrThrow(size_t size) -> void* {
+  void* p = counted(size ? size : 1);
+  if (not p) throw bad_alloc{};
+  return p;
+}
+
+}
+
+namespace AllocationCounter {
+
+auto count() -> size_t {
+  return allocations.load(memory_order_relaxed);
+}
+
+}
+
+// glibc lets the program interpose these; they still hand out memory free() understands.
+extern "C" {
+
+auto malloc(size_t size) -> void* {
+  return counted(size);
+}
+
+auto calloc(size_t count, size_t size) -> void* {
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+auto realloc(void* p, size_t size) -> void* {
+  allocations.fetch_add(1, memory_order_relaxed);
+  return __libc_realloc(p, size);
+}
+
+}
+
+auto operator new(size_t size) -> void* { return countedOrThrow(size); }
+auto operator new[](size_t size) -> void* { return countedOrThrow(size); }
+auto operator new(size_t size, const nothrow_t&) noexcept -> void* { return counted(size ? size : 1); }
+auto operator new[](size_t size, const nothrow_t&) noexcept -> void* { return counted(size ? size : 1); }
+
+auto operator delete(void* p) noexcept -> void { free(p); }
+auto operator delete[](void* p) noexcept -> void { free(p); }
+auto operator delete(void* p, size_t) noexcept -> void { free(p); }
+auto operator delete[](void* p, size_t) noexcept -> void { free(p); }
+auto operator delete(void* p, const nothrow_t&) noexcept -> void { free(p); }
+auto operator delete[](void* p, const nothrow_t&) noexcept -> void { free(p); }
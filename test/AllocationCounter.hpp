@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+/// Every call to malloc, calloc, realloc and operator new in the allocation test binary bumps this.
+/// Only linked into `allocation_tests` - it replaces the global allocators.
+namespace AllocationCounter {
+
+auto count() -> size_t;
+
+/// Counts the allocations made while `fn` runs.
+template<typename Fn>
+auto allocationsDuring(Fn&& fn) -> size_t {
+  const size_t before = count();
+  fn();
+  return count() - before;
+}
+
+}
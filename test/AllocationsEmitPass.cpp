@@ -0,0 +1,145 @@
+#include "AllocationCounter.hpp"
+#include "Assemble.hpp"
+#include "catch2.hpp"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+// One of every mnemonic parseInstructionFrom knows, with label names long enough that they'd
+// spill out of a std::string's small buffer if the emit pass copied them. The M extension's are
+// in here too, so it's assembled with --isa rv32im.
+static const char* everyMnemonic =
+  "a_label_well_past_small_string_size:\n"
+  "    addi x1, x2, 3\n"
+  "    xori x1, x2, 3\n"
+  "    ori x1, x2, 3\n"
+  "    andi x1, x2, 3\n"
+  "    slli x1, x2, 3\n"
+  "    srli x1, x2, 3\n"
+  "    srai x1, x2, 3\n"
+  "    slti x1, x2, 3\n"
+  "    sltiu x1, x2, 3\n"
+  "    jalr x1, 4(x2)\n"
+  "    ecall\n"
+  "    ebreak\n"
+  "    lw x1, 4(x2)\n"
+  "    lh x1, 4(x2)\n"
+  "    lb x1, 4(x2)\n"
+  "    lbu x1, 4(x2)\n"
+  "    lhu x1, 4(x2)\n"
+  "    jal x1, another_label_well_past_small_string_size\n"
+  "    lui x1, 4096\n"
+  "    auipc x1, 4096\n"
+  "    add x1, x2, x3\n"
+  "    sub x1, x2, x3\n"
+  "    xor x1, x2, x3\n"
+  "    or x1, x2, x3\n"
+  "    and x1, x2, x3\n"
+  "    sll x1, x2, x3\n"
+  "    srl x1, x2, x3\n"
+  "    sra x1, x2, x3\n"
+  "    slt x1, x2, x3\n"
+  "    sltu x1, x2, x3\n"
+  "    sw x1, 4(x2)\n"
+  "    sh x1, 4(x2)\n"
+  "    sb x1, 4(x2)\n"
+  "another_label_well_past_small_string_size: beq x1, x2, a_label_well_past_small_string_size\n"
+  "    bne x1, x2, a_label_well_past_small_string_size\n"
+  "    blt x1, x2, a_label_well_past_small_string_size\n"
+  "    bge x1, x2, another_label_well_past_small_string_size\n"
+  "    bltu x1, x2, another_label_well_past_small_string_size\n"
+  "    bgeu x1, x2, another_label_well_past_small_string_size\n"
+  "    # A comment\n"
+  "\n"
+  "    mv x1, x2\n"
+  "    jr x1\n"
+  "    nop\n"
+  "    noop\n"
+  "    li x1, 123456\n"
+  "    call a_label_well_past_small_string_size\n"
+  "    tail another_label_well_past_small_string_size\n"
+  "    ret\n"
+  "    mul x1, x2, x3\n"
+  "    mulh x1, x2, x3\n"
+  "    mulhsu x1, x2, x3\n"
+  "    mulhu x1, x2, x3\n"
+  "    div x1, x2, x3\n"
+  "    divu x1, x2, x3\n"
+  "    rem x1, x2, x3\n"
+  "    remu x1, x2, x3\n";
+
+static auto labelPass(const string& text) -> void {
+  string copy = text;
+  instructionIndex = 0;
+  forEachLine(copy.data(), copy.size(), [](char* line, int lineNumber) {
+    huntForLabels(firstToken(line), lineNumber);
+  });
+  image.bytes.reserve(instructionIndex * 4);
+}
+
+static auto emitPass(string& text) -> void {
+  instructionIndex = 0;
+  image.clear();
+  forEachLine(text.data(), text.size(), [](char* line, int lineNumber) {
+    handleLine(firstToken(line), lineNumber);
+  });
+}
+
+TEST_CASE("The emit pass doesn't allocate once warmed up", "[Allocations]")
+{
+  for (auto format : { Format::binary, Format::hex }) {
+    resetAssembler();
+    opts.format = format;
+    opts.isa = Isa::rv32im;
+    out = tmpfile();
+
+    labelPass(everyMnemonic);
+
+    // The first time round is allowed to allocate - stdio's buffer for `out`, for one.
+    string warmUp = everyMnemonic;
+    emitPass(warmUp);
+    const size_t instructions = image.size() / 4;
+
+    string text = everyMnemonic;
+    const size_t allocations = AllocationCounter::allocationsDuring([&] { emitPass(text); });
+
+    fclose(out);
+
+    INFO("format " << (int) format);
+    REQUIRE(image.size() / 4 == instructions);
+    REQUIRE(allocations == 0);
+  }
+}
+
+TEST_CASE("No one mnemonic allocates in the emit pass", "[Allocations]")
+{
+  resetAssembler();
+  opts.isa = Isa::rv32im;
+  out = tmpfile();
+
+  labelPass(everyMnemonic);
+  string warmUp = everyMnemonic;
+  emitPass(warmUp);
+
+  // Each line on its own, against the same labels.
+  vector<string> lines;
+  string all = everyMnemonic;
+  forEachLine(all.data(), all.size(), [&](char* line, int) { lines.emplace_back(line); });
+
+  for (auto& line : lines) {
+    const string original = line;
+    instructionIndex = 0;
+    image.clear();
+    const size_t allocations = AllocationCounter::allocationsDuring([&] {
+      handleLine(firstToken(line.data()), 1);
+    });
+
+    INFO("line '" << original << "'");
+    REQUIRE(allocations == 0);
+  }
+
+  fclose(out);
+}
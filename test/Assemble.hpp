@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "Elf.hpp"
+#include "Linker.hpp"
+#include "LiteralPool.hpp"
+#include "Relaxation.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+/// Puts every global the passes read or leave results in back as a fresh run of main finds them -
+/// so nothing one test assembled leaks into the next.
+inline auto resetAssembler() -> void {
+  using namespace DcsEmbler;
+
+  opts = Options{};
+  labels.clear();
+  globalSymbols.clear();
+  relaxableSites.clear();
+  relaxedSites.clear();
+  alignmentSites.clear();
+  literalPool = LiteralPool{};
+  image.clear();
+  instructionOffsets.clear();
+  instructionIndex = 0;
+}
+
+/// The label pass over `text` the way main runs it, relaxing whatever doesn't reach - aligning
+/// loop heads to `loopAlignment` bytes first, as --alignLoops does, unless that's 0.
+inline auto labelPassOver(std::string text, uint32_t loopAlignment = 0) -> void {
+  using namespace DcsEmbler;
+
+  instructionIndex = 0;
+  forEachLine(text.data(), text.size(), [](char* line, int lineNumber) {
+    huntForLabels(firstToken(line), lineNumber);
+  });
+  if (loopAlignment != 0) alignLoopHeads(loopAlignment);
+  vector<Checkpoint> unused;
+  relaxSites(unused);
+}
+
+/// Runs both passes over `text` the way main does, leaving the results in the globals - aligning
+/// loop heads to `loopAlignment` bytes, as --alignLoops does, unless that's 0, and taking whatever
+/// `isa` has, as --isa does.
+inline auto assembleSource(std::string text, DcsEmbler::Format format = DcsEmbler::Format::binary,
+                           uint32_t loopAlignment = 0, DcsEmbler::Isa isa = DcsEmbler::Isa::rv32i) -> void {
+  using namespace DcsEmbler;
+
+  resetAssembler();
+  opts.format = format;
+  opts.isa = isa;
+  out = tmpfile();
+
+  labelPassOver(text, loopAlignment);
+
+  instructionIndex = 0;
+  forEachLine(text.data(), text.size(), [](char* line, int lineNumber) {
+    handleLine(firstToken(line), lineNumber);
+  });
+  fclose(out);
+}
+
+/// `text` assembled into an object file, as if it had been read in from `name`.
+inline auto objectFrom(const std::string& name, const std::string& text) -> DcsEmbler::ObjectFile {
+  using namespace DcsEmbler;
+
+  assembleSource(text, Format::elf);
+  const auto elf = buildRelocatableElf(image, labels, globalSymbols);
+
+  ObjectFile o{};
+  o.path = name;
+  o.contents.assign(elf.begin(), elf.end());
+  REQUIRE(parseObjectFile(o));
+  return o;
+}
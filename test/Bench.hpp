@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "Corpus.hpp"
+
+using namespace std;
+
+/// Set from the bench command line (see bench_main.cpp).
+extern DcsEmbler::CorpusSpec benchCorpus;
+
+/// Runs fn until at least a quarter of a second has gone by, and prints how fast it chewed through
+/// the given amount of input. Catch's BENCHMARK only reports time per run, which doesn't compare
+/// across corpus sizes.
+template<typename Fn>
+auto reportThroughput(const char* name, size_t lines, size_t bytes, Fn&& fn) -> void {
+    using clock = chrono::steady_clock;
+
+    size_t runs = 0;
+    const auto start = clock::now();
+    auto elapsed = clock::duration{};
+    do {
+        fn();
+        runs++;
+        elapsed = clock::now() - start;
+    } while (elapsed < chrono::milliseconds(250));
+
+    const double seconds = chrono::duration<double>(elapsed).count() / runs;
+    // Through cout rather than stdout, so it stays in order with Catch's own output.
+    char report[128];
+    snprintf(report, sizeof(report), "%-40s %14.0f lines/s %10.2f MB/s\n",
+             name, lines / seconds, bytes / seconds / 1e6);
+    cout << report << flush;
+}
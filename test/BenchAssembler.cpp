@@ -0,0 +1,240 @@
+#include "Alignment.hpp"
+#include "Assembler.hpp"
+#include "Bench.hpp"
+#include "Corpus.hpp"
+#include "LiteralPool.hpp"
+#include "Relaxation.hpp"
+#include "catch2.hpp"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using namespace DcsEmbler;
+
+namespace {
+
+struct Fixture {
+  string text;
+  vector<string> lines;
+  filesystem::path path;
+
+  Fixture()
+  {
+    text = generateCorpus(benchCorpus);
+
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      if (end == string::npos) end = text.size();
+      lines.push_back(text.substr(start, end - start));
+      start = end + 1;
+    }
+
+    path = filesystem::temp_directory_path() / "dcsembler-bench.S";
+    ofstream{ path, ios_base::binary } << text;
+
+    printf("Corpus: %zu lines, %zu bytes (seed %llu)\n", lines.size(), text.size(),
+           (unsigned long long)benchCorpus.seed);
+  }
+
+  ~Fixture() { filesystem::remove(path); }
+};
+
+auto corpus() -> const Fixture&
+{
+  static Fixture f{};
+  return f;
+}
+
+/// The tokenizer scribbles over the line it is given, as the passes do over their copy of the text.
+char scratch[4096];
+
+auto scratchCopyOf(const string& line) -> char*
+{
+  const size_t n = min(line.size(), sizeof(scratch) - 1);
+  memcpy(scratch, line.data(), n);
+  scratch[n] = '\0';
+  return scratch;
+}
+
+auto labelPass() -> int
+{
+  labels.clear();
+  relaxableSites.clear();
+  alignmentSites.clear();
+  instructionIndex = 0;
+  int lineNumber = 1;
+  for (const auto& line : corpus().lines) {
+    huntForLabels(firstToken(scratchCopyOf(line)), lineNumber++);
+  }
+  return instructionIndex;
+}
+
+auto emitPass() -> int
+{
+  image.clear();
+  instructionIndex = 0;
+  int lineNumber = 1;
+  for (const auto& line : corpus().lines) {
+    handleLine(firstToken(scratchCopyOf(line)), lineNumber++);
+  }
+  return instructionIndex;
+}
+
+auto setUp() -> void
+{
+  opts = Options{};
+  globalSymbols.clear();
+  relaxedSites.clear();
+  literalPool = LiteralPool{};
+  instructionOffsets.clear();
+  if (out == nullptr) {
+    out = fopen("/dev/null", "w");
+  }
+  corpus();
+}
+
+}
+
+TEST_CASE("Whole-file phases", "[bench]")
+{
+  setUp();
+  const size_t lineCount = corpus().lines.size();
+  const size_t bytes = corpus().text.size();
+
+  BENCHMARK("read file") { return readFileToString(corpus().path.string()).size(); };
+  reportThroughput("read file", lineCount, bytes,
+                   [] { return readFileToString(corpus().path.string()).size(); });
+
+  auto tokenizeAll = [] {
+    size_t tokens = 0;
+    char* t[5];
+    for (const auto& line : corpus().lines) {
+      tokens += collectTokens(firstToken(scratchCopyOf(line)), t);
+    }
+    return tokens;
+  };
+  BENCHMARK("tokenize") { return tokenizeAll(); };
+  reportThroughput("tokenize", lineCount, bytes, tokenizeAll);
+
+  BENCHMARK("label pass (huntForLabels)") { return labelPass(); };
+  reportThroughput("label pass (huntForLabels)", lineCount, bytes, labelPass);
+
+  labelPass();
+  image.bytes.reserve(instructionIndex * 4);
+  BENCHMARK("emit pass (handleLine)") { return emitPass(); };
+  reportThroughput("emit pass (handleLine)", lineCount, bytes, emitPass);
+}
+
+TEST_CASE("Mnemonic dispatch", "[bench]")
+{
+  setUp();
+  labelPass();
+
+  // Tokenize once up front, so only parseInstructionFrom (and the emit behind it) is timed.
+  vector<string> storage{};
+  vector<pair<array<char*, 5>, size_t>> instructions{};
+  storage.reserve(corpus().lines.size());
+  size_t bytes = 0;
+  for (const auto& line : corpus().lines) {
+    storage.push_back(line);
+    array<char*, 5> t;
+    const size_t count = collectTokens(firstToken(storage.back().data()), t.data());
+    if (count == 0 or isComment(t[0]) or isLabel(t[0])) continue;
+    instructions.emplace_back(t, count);
+    bytes += line.size() + 1;
+  }
+
+  auto dispatchAll = [&] {
+    image.clear();
+    instructionIndex = 0;
+    for (const auto& [ tokens, count ] : instructions) {
+      auto t = tokens;
+      parseInstructionFrom(t.data(), (int)count, 0);
+    }
+    return instructionIndex;
+  };
+
+  BENCHMARK("mnemonic dispatch (parseInstructionFrom)") { return dispatchAll(); };
+  reportThroughput("mnemonic dispatch", instructions.size(), bytes, dispatchAll);
+}
+
+TEST_CASE("Encoders", "[bench]")
+{
+  setUp();
+  labels.clear();
+  labels["target"] = Label{ 0, 1 };
+  instructionIndex = 8;
+
+  const size_t n = 100000;
+  char* iTokens[5] = { (char*)"addi", (char*)"x1", (char*)"x2", (char*)"-12", (char*)"" };
+  char* rTokens[5] = { (char*)"add", (char*)"x1", (char*)"x2", (char*)"x3", (char*)"" };
+  char* uTokens[5] = { (char*)"lui", (char*)"x1", (char*)"74565", (char*)"", (char*)"" };
+  char* sTokens[5] = { (char*)"sw", (char*)"x1", (char*)"8", (char*)"x2", (char*)"" };
+  char* bTokens[5] = { (char*)"beq", (char*)"x1", (char*)"x2", (char*)"target", (char*)"" };
+
+  // Roughly how long a source line for one of these is, to turn calls into bytes.
+  const size_t lineBytes = 20;
+
+  auto run = [&](auto encode) {
+    unsigned int acc = 0;
+    for (size_t i = 0; i < n; i++) acc ^= encode();
+    return acc;
+  };
+  auto encodeI = [&] { return doIFormatInstruction(iTokens, 4, 0, 0b0010011, 0x0); };
+  auto encodeR = [&] { return doRFormatInstruction(rTokens, 4, 0, 0b0110011, 0x0, 0x0); };
+  auto encodeU = [&] { return doUFormatInstruction(uTokens, 3, 0, 0b0110111); };
+  auto encodeS = [&] { return doSFormatInstruction(sTokens, 4, 0, 0b0100011, 0b010); };
+  auto encodeB = [&] { return doBFormatInstruction(bTokens, 4, 0, 0b1100011, 0b000); };
+
+  BENCHMARK("I-format encoder") { return run(encodeI); };
+  reportThroughput("I-format encoder", n, n * lineBytes, [&] { return run(encodeI); });
+  BENCHMARK("R-format encoder") { return run(encodeR); };
+  reportThroughput("R-format encoder", n, n * lineBytes, [&] { return run(encodeR); });
+  BENCHMARK("U-format encoder") { return run(encodeU); };
+  reportThroughput("U-format encoder", n, n * lineBytes, [&] { return run(encodeU); });
+  BENCHMARK("S-format encoder") { return run(encodeS); };
+  reportThroughput("S-format encoder", n, n * lineBytes, [&] { return run(encodeS); });
+  BENCHMARK("B-format encoder") { return run(encodeB); };
+  reportThroughput("B-format encoder", n, n * lineBytes, [&] { return run(encodeB); });
+
+  // J-format encoding lives inline in parseInstructionFrom, so go through there.
+  auto encodeJ = [&] {
+    image.clear();
+    for (size_t i = 0; i < n; i++) {
+      char* jTokens[5] = { (char*)"jal", (char*)"x1", (char*)"target", (char*)"", (char*)"" };
+      instructionIndex = 8;
+      parseInstructionFrom(jTokens, 3, 0);
+    }
+    return image.size();
+  };
+  BENCHMARK("J-format encoder (via dispatch)") { return encodeJ(); };
+  reportThroughput("J-format encoder", n, n * lineBytes, encodeJ);
+}
+
+TEST_CASE("Output formatting", "[bench]")
+{
+  setUp();
+  const size_t n = 100000;
+  // Each output word stands for an instruction line of about this many bytes.
+  const size_t lineBytes = 20;
+
+  auto emitAll = [&] {
+    image.clear();
+    instructionIndex = 0;
+    for (size_t i = 0; i < n; i++) emitInstruction(0x00310093 + i);
+    return instructionIndex;
+  };
+
+  opts.format = Format::binary;
+  BENCHMARK("binary output") { return emitAll(); };
+  reportThroughput("binary output", n, n * lineBytes, emitAll);
+
+  opts.format = Format::hex;
+  BENCHMARK("hex output") { return emitAll(); };
+  reportThroughput("hex output", n, n * lineBytes, emitAll);
+
+  opts.format = Format::binary;
+}
@@ -0,0 +1,266 @@
+#include "Alignment.hpp"
+#include "Assemble.hpp"
+#include "Compression.hpp"
+#include "Linker.hpp"
+#include "Peephole.hpp"
+#include "Relaxation.hpp"
+#include "Scheduler.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static constexpr uint32_t nop = 0x00000013;
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+static auto addressOf(const char* label) -> int {
+  REQUIRE(labels.lookup(label));
+  return instructionIndexToAddress(labels.lookup(label)->instructionIndex);
+}
+
+TEST_CASE("Alignment directives ask for what they say", "[Alignment]")
+{
+  auto alignment = [](vector<const char*> tokens) {
+    return alignmentDirective(const_cast<char* const*>(tokens.data()), tokens.size(), 1);
+  };
+  REQUIRE(alignment({ ".align", "2" }) == 4u);
+  REQUIRE(alignment({ ".p2align", "4" }) == 16u);
+  REQUIRE(alignment({ ".p2align", "4", "15" }) == 16u);
+  REQUIRE(alignment({ ".balign", "8" }) == 8u);
+  REQUIRE(alignment({ ".balign", "0x40" }) == 64u);
+  REQUIRE_FALSE(alignment({ ".text" }));
+  REQUIRE_FALSE(alignment({ "addi", "x1", "x0", "1" }));
+
+  REQUIRE(paddingFor(0, 16) == 0);
+  REQUIRE(paddingFor(4, 16) == 12);
+  REQUIRE(paddingFor(18, 4) == 2);
+}
+
+TEST_CASE("Alignment pads with nops up to the boundary", "[Alignment]")
+{
+  assembleSource("addi x5, x0, 1\n"
+                 ".p2align 4\n"
+                 "here: addi x6, x0, 2\n"
+                 ".balign 8\n"
+                 "there: ecall\n");
+
+  REQUIRE(image.size() == 7 * 4);
+  for (size_t at : { 4, 8, 12, 20 }) REQUIRE(image.wordAt(at) == nop);
+  REQUIRE(image.wordAt(24) == 0x00000073);
+  REQUIRE(addressOf("here") == 16);
+  REQUIRE(addressOf("there") == 24);
+  REQUIRE(alignmentSites[0].instructionIndex == 1);
+  REQUIRE(alignmentSites[0].padding == 3);
+  REQUIRE(alignmentSites[1].instructionIndex == 5);
+  REQUIRE(alignmentSites[1].padding == 1);
+}
+
+TEST_CASE("A label just before the directive ends up after the padding", "[Alignment]")
+{
+  assembleSource("nop\n"
+                 "before:\n"
+                 ".p2align 3\n"
+                 "jal x0, before\n");
+
+  REQUIRE(image.size() == 3 * 4);
+  REQUIRE(addressOf("before") == 8);
+  REQUIRE(image.wordAt(8) == 0x0000006f);
+}
+
+TEST_CASE("Aligning loops aligns what backward branches go to, and nothing else", "[Alignment]")
+{
+  const string source = "addi x8, x0, 3\n"
+                        "loop:\n"
+                        "addi x8, x8, -1\n"
+                        "bne x8, x0, loop\n"
+                        "beq x0, x0, skip\n"
+                        "addi x9, x0, 1\n"
+                        "skip: ecall\n";
+
+  assembleSource(source, Format::binary, 16);
+  REQUIRE(addressOf("loop") == 16);
+  REQUIRE(addressOf("skip") == 32);
+  REQUIRE(alignmentSites.size() == 1);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[8] == 0);
+  REQUIRE(s.x[9] == 0);
+
+  assembleSource(source);
+  REQUIRE(addressOf("loop") == 4);
+  REQUIRE(alignmentSites.empty());
+}
+
+TEST_CASE("Padding is worked out from where relaxed branches leave things", "[Alignment]")
+{
+  string nops;
+  for (int i = 0; i < 1100; i++) nops += "nop\n";
+  assembleSource("beq x0, x0, far\n"
+                 ".p2align 4\n"
+                 "aligned: addi x5, x0, 1\n" +
+                 nops + "far: ecall\n");
+
+  // The relaxed branch is two instructions, so it only takes two nops to get to 16.
+  REQUIRE(isRelaxed(0));
+  REQUIRE(alignmentSites[0].instructionIndex == 2);
+  REQUIRE(alignmentSites[0].padding == 2);
+  REQUIRE(addressOf("aligned") == 16);
+  REQUIRE(addressOf("far") == 16 + 1101 * 4);
+  REQUIRE(runToEcall().x[5] == 0);
+}
+
+TEST_CASE("A relaxed branch keeps both its slots when less padding brings it back in reach", "[Alignment]")
+{
+  // Relaxing the bne pushes `there` out of the beq's reach. Relaxing that takes the padding down
+  // to nothing, leaving the bne in reach after all - but it's still two instructions.
+  string nops;
+  for (int i = 0; i < 1020; i++) nops += "nop\n";
+  assembleSource("beq x0, x0, there\n"
+                 "nop\n"
+                 "nop\n"
+                 "nop\n"
+                 "bne x1, x0, aligned\n" +
+                 nops + "there: addi x5, x0, 1\n"
+                        ".balign 16\n"
+                        "aligned: addi x6, x0, 2\n"
+                        "ecall\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 0, 5 });
+  REQUIRE(alignmentSites[0].padding == 0);
+  REQUIRE(addressOf("there") == 1027 * 4);
+  REQUIRE(addressOf("aligned") == 1028 * 4);
+  REQUIRE(image.size() == 1030 * 4);
+
+  const auto skip = image.wordAt(5 * 4);
+  REQUIRE((skip & 0x7f) == 0b1100011);
+  REQUIRE(((skip >> 12) & 0x7) == 0b000); // beq
+  const auto jal = image.wordAt(6 * 4);
+  REQUIRE((jal & 0xfff) == 0b1101111); // jal x0
+  REQUIRE(image.wordAt(1028 * 4) == 0x00200313); // addi x6, x0, 2
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 1);
+  REQUIRE(s.x[6] == 2);
+}
+
+TEST_CASE("The peephole pass puts back as much padding as it now takes", "[Alignment]")
+{
+  assembleSource("addi x5, x0, 1\n"
+                 "addi x5, x5, 0\n"
+                 ".p2align 4\n"
+                 "here: addi x6, x0, 2\n"
+                 "nop\n"
+                 "ecall\n");
+  REQUIRE(alignmentSites[0].padding == 2);
+
+  const auto report = optimizeImage(image, labels);
+  REQUIRE(report);
+  REQUIRE(report->instructionsAfter == 7);
+  REQUIRE(alignmentSites[0].instructionIndex == 1);
+  REQUIRE(alignmentSites[0].padding == 3);
+  REQUIRE(addressOf("here") == 16);
+  // The padding isn't a run of nops for the rules to collapse.
+  for (size_t at : { 4, 8, 12 }) REQUIRE(image.wordAt(at) == nop);
+  REQUIRE(runToEcall().x[6] == 2);
+}
+
+TEST_CASE("Scheduling doesn't move anything across alignment padding", "[Alignment]")
+{
+  assembleSource("addi x2, x0, 64\n"
+                 "addi x7, x0, 3\n"
+                 "addi x8, x0, 4\n"
+                 "lw x1, 0(x2)\n"
+                 ".balign 16\n"
+                 "addi x3, x1, 1\n"
+                 "addi x4, x0, 7\n"
+                 ".balign 8\n"
+                 "addi x6, x1, 8\n"
+                 "lw x9, 4(x2)\n"
+                 "addi x9, x9, 1\n"
+                 "ecall\n");
+  REQUIRE(image.wordAt(0x10) == 0x00108193); // addi x3, x1, 1
+  REQUIRE(image.wordAt(0x18) == 0x00808313); // addi x6, x1, 8
+  const auto unscheduled = image.bytes;
+
+  scheduleImage(image, labels, {});
+  REQUIRE(image.wordAt(0x10) == 0x00108193);
+  REQUIRE(image.wordAt(0x18) == 0x00808313);
+  // Everything that could fill the load's delay slots is on the other side of some padding.
+  REQUIRE(image.bytes == unscheduled);
+  REQUIRE(runToEcall().x[6] == 8);
+}
+
+TEST_CASE("Compressing pads out in bytes, with a c.nop to finish", "[Alignment]")
+{
+  assembleSource("addi x5, x0, 1\n"
+                 ".p2align 4\n"
+                 "here: addi x6, x0, 2\n"
+                 "ecall\n");
+
+  REQUIRE(compressImage(image));
+  REQUIRE(addressOf("here") == 16);
+  for (size_t at : { 2, 6, 10 }) REQUIRE(image.wordAt(at) == nop);
+  REQUIRE((image.wordAt(14) & 0xffff) == 0x0001);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 1);
+  REQUIRE(s.x[6] == 2);
+}
+
+TEST_CASE("Aligned objects are linked at their alignment", "[Alignment]")
+{
+  vector<ObjectFile> objects{ objectFrom("first.o", ".globl _start\n"
+                                                    "_start: jal x1, aligned\n"
+                                                    "ecall\n"),
+                              objectFrom("second.o", ".globl aligned\n"
+                                                     ".p2align 5\n"
+                                                     "aligned: addi x5, x0, 7\n"
+                                                     "jalr x0, 0(x1)\n") };
+  REQUIRE(objects[0].textAlignment == 4);
+  REQUIRE(objects[1].textAlignment == 32);
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE(link(objects, 0, 1, linked, globals));
+  REQUIRE(globals.find("aligned")->offset == 32);
+  for (size_t at = 8; at < 32; at += 4) REQUIRE(linked.wordAt(at) == nop);
+
+  Simulator s{ linked, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[5] == 7);
+}
+
+TEST_CASE("Aligned objects are linked at their alignment in memory, not just from the base", "[Alignment]")
+{
+  vector<ObjectFile> objects{ objectFrom("first.o", "_start: addi x5, x0, 1\n"
+                                                    "addi x6, x0, 2\n"),
+                              objectFrom("second.o", ".globl twice\n"
+                                                     ".balign 16\n"
+                                                     "twice: add x5, x5, x5\n"
+                                                     "ecall\n") };
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE(link(objects, 0x10054, 1, linked, globals));
+  REQUIRE((0x10054 + globals.find("twice")->offset) % 16 == 0);
+  REQUIRE(globals.find("twice")->offset == 12);
+  REQUIRE(linked.wordAt(8) == nop);
+
+  Simulator s{ linked, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[5] == 2);
+}
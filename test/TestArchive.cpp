@@ -0,0 +1,73 @@
+#include "Archive.hpp"
+#include "Assemble.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto member(const string& name, const string& text) -> ArchiveMember {
+  return { name, objectFrom(name, text).contents };
+}
+
+static auto library() -> vector<uint8_t> {
+  vector<ArchiveMember> members{
+    member("double.o", ".globl double\ndouble:\n    add x10, x10, x10\n    jalr x0, 0(x1)\n"),
+    member("halve.o", ".globl halve\nhalve:\n    srai x10, x10, 1\n    jalr x0, 0(x1)\n"),
+    member("quarter.o", ".globl quarter\nquarter:\n    jal x5, halve\n    jal x0, halve\n"),
+  };
+  vector<uint8_t> archive;
+  REQUIRE(buildArchive(members, archive));
+  return archive;
+}
+
+TEST_CASE("The archive index is sorted and finds each symbol's member", "[Archive]")
+{
+  const auto bytes = library();
+  Archive archive{};
+  REQUIRE(archive.openFrom({ (const char*) bytes.data(), bytes.size() }, "libmaths.a"));
+
+  REQUIRE(archive.memberCount() == 3);
+  REQUIRE(archive.symbolCount() == 3);
+  for (size_t i = 1; i < archive.symbolCount(); i++) {
+    REQUIRE(archive.symbolName(i - 1) < archive.symbolName(i));
+  }
+
+  REQUIRE(archive.find("halve") == 1u);
+  REQUIRE(archive.find("quarter") == 2u);
+  REQUIRE_FALSE(archive.find("triple"));
+  REQUIRE_FALSE(archive.find(""));
+
+  ObjectFile object{};
+  REQUIRE(archive.extract(0, object));
+  REQUIRE(object.path == "libmaths.a(double.o)");
+  REQUIRE(object.textSize == 8);
+}
+
+TEST_CASE("Only the members that are needed are pulled in", "[Archive]")
+{
+  const auto bytes = library();
+  vector<unique_ptr<Archive>> archives;
+  archives.push_back(make_unique<Archive>());
+  REQUIRE(archives.back()->openFrom({ (const char*) bytes.data(), bytes.size() }, "libmaths.a"));
+
+  vector<ObjectFile> objects{ objectFrom("main.o", "main:\n    jal x1, quarter\n    ecall\n") };
+  REQUIRE(pullArchiveMembers(objects, archives));
+
+  // quarter, then halve for it - but not double.
+  REQUIRE(objects.size() == 3);
+  REQUIRE(objects[1].path == "libmaths.a(quarter.o)");
+  REQUIRE(objects[2].path == "libmaths.a(halve.o)");
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE(link(objects, 0, 1, linked, globals));
+}
+
+TEST_CASE("Archives refuse two definitions of a symbol", "[Archive]")
+{
+  const auto twice = member("a.o", ".globl f\nf:\n    ecall\n");
+  vector<uint8_t> archive;
+  REQUIRE_FALSE(buildArchive({ twice, twice }, archive));
+}
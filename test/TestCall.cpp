@@ -0,0 +1,134 @@
+#include "Assemble.hpp"
+#include "Relaxation.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+/// Further than a jal reaches.
+static constexpr int farAway = 300000;
+
+static auto nops(int count) -> string {
+  string lines;
+  lines.reserve((size_t) count * 4);
+  for (int i = 0; i < count; i++) lines += "nop\n";
+  return lines;
+}
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+TEST_CASE("ret is jalr x0, 0(x1)", "[Call]")
+{
+  assembleSource("ret\n");
+  REQUIRE(image.wordAt(0) == 0x00008067);
+}
+
+TEST_CASE("A near call is a single jal, and ret comes back from it", "[Call]")
+{
+  assembleSource("call function\n"
+                 "addi x6, x0, 3\n"
+                 "ecall\n"
+                 "function: addi x5, x0, 7\n"
+                 "ret\n");
+
+  REQUIRE(relaxedSites.empty());
+  REQUIRE(image.size() == 5 * 4);
+  REQUIRE(image.wordAt(0) == 0x00c000ef); // jal x1, 12
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 7);
+  REQUIRE(s.x[6] == 3);
+  REQUIRE(s.x[1] == 4);
+}
+
+TEST_CASE("A near tail is a jal that doesn't link", "[Call]")
+{
+  assembleSource("tail function\n"
+                 "ecall\n"
+                 "function: addi x5, x0, 7\n"
+                 "ecall\n");
+
+  REQUIRE(image.wordAt(0) == 0x0080006f); // jal x0, 8
+  REQUIRE(runToEcall().x[5] == 7);
+}
+
+TEST_CASE("A call out of a jal's reach becomes auipc and jalr", "[Call]")
+{
+  assembleSource("call far\n"
+                 "addi x6, x0, 3\n"
+                 "ecall\n" +
+                 nops(farAway) +
+                 "far: addi x5, x0, 9\n"
+                 "ret\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 0 });
+  REQUIRE(labels.lookup("far")->instructionIndex == farAway + 4);
+  REQUIRE((image.wordAt(0) & 0xfff) == 0x097); // auipc x1
+  REQUIRE((image.wordAt(4) & 0xfffff) == 0x080e7); // jalr x1, (x1)
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 9);
+  REQUIRE(s.x[6] == 3);
+  REQUIRE(s.x[1] == 8);
+}
+
+TEST_CASE("A far tail goes through t1 and doesn't link", "[Call]")
+{
+  assembleSource("far: addi x5, x0, 9\n"
+                 "ecall\n" +
+                 nops(farAway) +
+                 "addi x1, x0, 0\n"
+                 "tail far\n");
+
+  const int tail = farAway + 3;
+  REQUIRE(relaxedSites == vector<int>{ tail });
+  REQUIRE((image.wordAt(tail * 4) & 0xfff) == 0x317); // auipc x6
+  REQUIRE((image.wordAt(tail * 4 + 4) & 0xfffff) == 0x30067); // jalr x0, (x6)
+
+  Simulator s{ image, 0 };
+  s.pc = tail * 4;
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[5] == 9);
+  REQUIRE(s.x[1] == 0);
+}
+
+TEST_CASE("Calls and branches are relaxed together", "[Call]")
+{
+  // `end` starts off exactly as far as a branch can go, until the call to `far` grows.
+  assembleSource("beq x1, x2, end\n"
+                 "call far\n" +
+                 nops(1021) +
+                 "end: ecall\n" +
+                 nops(farAway) +
+                 "far: ecall\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 0, 2 });
+  REQUIRE(labels.lookup("end")->instructionIndex == 1025);
+}
+
+TEST_CASE("A call to a symbol from somewhere else is a jal for the linker", "[Call]")
+{
+  assembleSource("call printf\n"
+                 "tail exit\n",
+                 Format::elf);
+
+  REQUIRE(relaxedSites.empty());
+  REQUIRE(image.size() == 2 * 4);
+  REQUIRE(image.wordAt(0) == 0x000000ef);
+  REQUIRE(image.wordAt(4) == 0x0000006f);
+  REQUIRE(image.relocations.size() == 2);
+  REQUIRE(image.relocations[0].symbol == "printf");
+  REQUIRE(image.relocations[0].type == Relocation::Type::jal);
+  REQUIRE(image.relocations[1].offset == 4);
+}
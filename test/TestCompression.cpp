@@ -0,0 +1,169 @@
+#include "Assemble.hpp"
+#include "Compression.hpp"
+#include "Corpus.hpp"
+#include "Elf.hpp"
+#include "Linker.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+struct Encoding {
+  const char* source;
+  uint32_t word;
+  uint16_t parcel;
+};
+
+// As llvm-mc -triple=riscv32 -mattr=+c has them.
+static const vector<Encoding> encodings{
+  { "c.li a0, 5", 0x00500513, 0x4515 },
+  { "c.addi a0, 1", 0x00150513, 0x0505 },
+  { "c.mv a0, a1", 0x00058513, 0x852e },
+  { "c.lw s0, 4(s1)", 0x0044a403, 0x40c0 },
+  { "c.sw s1, 124(s0)", 0x06942e23, 0xdc64 },
+  { "c.lwsp t0, 252(sp)", 0x0fc12283, 0x52fe },
+  { "c.swsp t0, 8(sp)", 0x00512423, 0xc416 },
+  { "c.beqz s0, -256", 0xf00400e3, 0xd001 },
+  { "c.bnez a5, 254", 0x0e079f63, 0xeffd },
+  { "c.j -2048", 0x801ff06f, 0xb001 },
+  { "c.jal 2046", 0x7fe000ef, 0x2ffd },
+  { "c.addi t0, -32", 0xfe028293, 0x1281 },
+  { "c.nop", 0x00000013, 0x0001 },
+};
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+TEST_CASE("Compressed forms are encoded as the spec has them", "[Compression]")
+{
+  for (const auto& e : encodings) {
+    INFO(e.source);
+    const auto d = decode(e.word);
+    const auto parcel = compressedForm(d, d.immediate);
+    REQUIRE(parcel);
+    REQUIRE(*parcel == e.parcel);
+    REQUIRE(isCompressed(*parcel));
+  }
+}
+
+TEST_CASE("Compressed instructions expand back to what they stand for", "[Compression]")
+{
+  for (const auto& e : encodings) {
+    INFO(e.source);
+    const auto expanded = expandCompressed(e.parcel);
+    REQUIRE(expanded);
+    // c.mv is add rd, x0, rs2 - which does the same as the addi it came from.
+    REQUIRE(*expanded == (e.parcel == 0x852e ? 0x00b00533 : e.word));
+  }
+  REQUIRE(compressedMnemonic(0x4515) == string{ "c.li" });
+  REQUIRE(compressedMnemonic(0x0001) == string{ "c.nop" });
+}
+
+TEST_CASE("Only what fits gets a compressed form", "[Compression]")
+{
+  REQUIRE_FALSE(compressedForm(decode(0x02028293), 0)); // addi t0, t0, 32
+  REQUIRE_FALSE(compressedForm(decode(0x08042403), 0)); // lw s0, 128(s0)
+  REQUIRE_FALSE(compressedForm(decode(0x00082803), 0)); // lw a6, 0(a6)
+  REQUIRE_FALSE(compressedForm(decode(0x00240463), 8)); // beq s0, sp, 8
+  REQUIRE_FALSE(compressedForm(decode(0x00000463), 256)); // beq s0, x0 - too far
+  REQUIRE_FALSE(compressedForm(decode(0x0000016f), 4)); // jal sp, 4
+  REQUIRE_FALSE(compressedForm(decode(0x0000006f), 2048)); // jal x0 - too far
+}
+
+TEST_CASE("A compressed program runs the same, in less space", "[Compression]")
+{
+  const string source = "addi x8, x0, 10\n"
+                        "addi x9, x0, 0\n"
+                        "addi x2, x0, 28\n"
+                        "loop: add x9, x9, x8\n"
+                        "addi x8, x8, -1\n"
+                        "bne x8, x0, loop\n"
+                        "sw x9, 4(x2)\n"
+                        "lw x10, 4(x2)\n"
+                        "jal x1, done\n"
+                        "addi x11, x0, 1\n"
+                        "done: ecall\n";
+
+  assembleSource(source);
+  const auto uncompressed = runToEcall();
+
+  assembleSource(source);
+  const auto report = compressImage(image);
+  REQUIRE(report);
+  REQUIRE(report->bytesBefore == 11 * 4);
+  // Only the add and the ecall aren't compressed - then a c.nop to make it whole words.
+  REQUIRE(report->bytesAfter == 9 * 2 + 2 * 4 + 2);
+  REQUIRE(image.compressed);
+  REQUIRE(instructionIndexToAddress(labels.lookup("loop")->instructionIndex) == 6);
+  REQUIRE(instructionIndexToAddress(labels.lookup("done")->instructionIndex) == 22);
+
+  const auto compressed = runToEcall();
+  REQUIRE(compressed.x[9] == 55);
+  REQUIRE(compressed.x[10] == uncompressed.x[10]);
+  REQUIRE(compressed.x[11] == 0);
+  REQUIRE(compressed.x[1] == 20);
+}
+
+TEST_CASE("A branch too far to compress stays 4 bytes, and still gets there", "[Compression]")
+{
+  string nops;
+  for (int i = 0; i < 200; i++) nops += "nop\n";
+  assembleSource("addi x8, x0, 0\n"
+                 "beq x8, x0, far\n" +
+                 nops +
+                 "addi x5, x0, 1\n"
+                 "far: ecall\n");
+  REQUIRE(compressImage(image));
+
+  const auto branch = image.wordAt(2);
+  REQUIRE(not isCompressed((uint16_t) branch));
+  REQUIRE(decode(branch).immediate == 4 + 200 * 2 + 2);
+  REQUIRE(runToEcall().x[5] == 0);
+}
+
+TEST_CASE("Compressing generated code makes it smaller", "[Compression]")
+{
+  CorpusSpec spec{};
+  spec.lines = 10000;
+  assembleSource(generateCorpus(spec));
+
+  const auto report = compressImage(image);
+  REQUIRE(report);
+  REQUIRE(report->bytesAfter < report->bytesBefore);
+  REQUIRE(image.size() % 4 == 0);
+  REQUIRE(instructionOffsets.size() == report->bytesBefore / 4 + 1);
+}
+
+TEST_CASE("Compressed objects are marked RVC, with symbols at byte addresses", "[Compression]")
+{
+  assembleSource("nop\n"
+                 ".globl f\n"
+                 "f: nop\n"
+                 "jal x1, g\n",
+                 Format::elf);
+  REQUIRE(compressImage(image));
+  REQUIRE(image.relocations[0].offset == 4);
+
+  const auto elf = buildRelocatableElf(image, labels, globalSymbols);
+  uint32_t flags = 0;
+  memcpy(&flags, elf.data() + offsetof(Elf32_Ehdr, e_flags), sizeof(flags));
+  REQUIRE(flags == EF_RISCV_RVC);
+
+  ObjectFile o{};
+  o.path = "compressed.o";
+  o.contents.assign(elf.begin(), elf.end());
+  REQUIRE(parseObjectFile(o));
+  const auto f = find_if(o.symbols.begin(), o.symbols.end(), [&](const auto& s) { return o.symbolName(s) == "f"; });
+  REQUIRE(f != o.symbols.end());
+  REQUIRE(f->st_value == 2);
+}
@@ -0,0 +1,62 @@
+#include "Corpus.hpp"
+#include "catch2.hpp"
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace DcsEmbler;
+
+TEST_CASE("Corpus generation is deterministic for a seed", "[Corpus]")
+{
+  CorpusSpec spec{ .lines = 500, .commentRatio = 0.2, .directiveRatio = 0.1 };
+  REQUIRE(generateCorpus(spec) == generateCorpus(spec));
+
+  CorpusSpec other = spec;
+  other.seed = 2;
+  REQUIRE(generateCorpus(spec) != generateCorpus(other));
+}
+
+TEST_CASE("Corpus has the requested number of instructions", "[Corpus]")
+{
+  CorpusSpec spec{ .lines = 1234, .commentRatio = 0.3, .directiveRatio = 0.3 };
+  istringstream text{ generateCorpus(spec) };
+
+  size_t instructions = 0;
+  for (string line; getline(text, line);) {
+    const bool skipped = line.empty() or line.back() == ':' or line[0] == '#' or
+                         line.find('.') == 4;
+    if (not skipped) instructions++;
+  }
+  REQUIRE(instructions == 1234);
+}
+
+TEST_CASE("Every branch target in a corpus is a defined label", "[Corpus]")
+{
+  CorpusSpec spec{ .lines = 5000,
+                   .mix = parseMnemonicMix("addi=1,beq=2,jal=1"),
+                   .labelDensity = 0.02,
+                   .forwardBranchRatio = 0.8 };
+  istringstream text{ generateCorpus(spec) };
+
+  set<string> defined{};
+  set<string> used{};
+  for (string line; getline(text, line);) {
+    if (line.back() == ':') {
+      defined.insert(line.substr(0, line.size() - 1));
+    } else if (auto l = line.rfind(" L"); l != string::npos) {
+      used.insert(line.substr(l + 1));
+    }
+  }
+
+  REQUIRE(not used.empty());
+  for (const auto& label : used) {
+    REQUIRE(defined.contains(label));
+  }
+}
+
+TEST_CASE("Byte sizes understand suffixes", "[Corpus]")
+{
+  REQUIRE(parseByteSize("512") == 512);
+  REQUIRE(parseByteSize("1K") == 1024);
+  REQUIRE(parseByteSize("10G") == 10ull << 30);
+}
@@ -0,0 +1,131 @@
+#include "Assemble.hpp"
+#include "DeadCode.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+static auto removeDead(const vector<string>& keep = {}, const optional<string>& entry = {}) -> DeadCodeReport {
+  const auto report = removeDeadCode(image, labels, globalSymbols, keep, entry);
+  REQUIRE(report);
+  return *report;
+}
+
+TEST_CASE("Keep lists are comma-separated", "[DeadCode]")
+{
+  REQUIRE(parseKeepList("isr,handler") == vector<string>{ "isr", "handler" });
+  REQUIRE(parseKeepList("one") == vector<string>{ "one" });
+  REQUIRE(parseKeepList("a,,b,") == vector<string>{ "a", "b" });
+  REQUIRE(parseKeepList("").empty());
+}
+
+TEST_CASE("What's jumped over and never jumped to goes, labels and all", "[DeadCode]")
+{
+  assembleSource("addi x5, x0, 1\n"
+                 "jal x0, done\n"
+                 "dead: addi x5, x5, 100\n"
+                 "addi x5, x5, 100\n"
+                 "done: ecall\n");
+
+  const auto report = removeDead();
+  REQUIRE(report.instructionsBefore == 5);
+  REQUIRE(report.instructionsAfter == 3);
+  REQUIRE(report.blocks == 1);
+  REQUIRE(report.labels == 1);
+  REQUIRE_FALSE(labels.lookup("dead"));
+  REQUIRE(labels.lookup("done")->instructionIndex == 2);
+  REQUIRE(image.wordAt(4) == 0x0040006f); // jal x0, +4
+  REQUIRE(runToEcall().x[5] == 1);
+}
+
+TEST_CASE("Calls come back, and what's never called goes", "[DeadCode]")
+{
+  assembleSource("jal x1, used\n"
+                 "ecall\n"
+                 "used: addi x6, x0, 2\n"
+                 "jalr x0, 0(x1)\n"
+                 "unused: addi x7, x0, 3\n"
+                 "jalr x0, 0(x1)\n");
+
+  const auto report = removeDead();
+  REQUIRE(report.instructionsAfter == 4);
+  REQUIRE(labels.lookup("used"));
+  REQUIRE_FALSE(labels.lookup("unused"));
+  REQUIRE(runToEcall().x[6] == 2);
+}
+
+TEST_CASE("Where a computed jalr goes is only kept if it's on the keep list", "[DeadCode]")
+{
+  const string source = "addi x5, x0, 8\n"
+                        "jalr x0, 0(x5)\n"
+                        "handler: addi x6, x0, 9\n"
+                        "ecall\n";
+
+  assembleSource(source);
+  REQUIRE(removeDead().instructionsAfter == 2);
+
+  assembleSource(source);
+  const auto report = removeDead({ "handler" });
+  REQUIRE(report.blocks == 0);
+  REQUIRE(image.size() == 4 * 4);
+  REQUIRE(runToEcall().x[6] == 9);
+}
+
+TEST_CASE("Exported names and the entry label are reached from outside", "[DeadCode]")
+{
+  const string source = "jal x0, end\n"
+                        "_start: addi x5, x0, 1\n"
+                        ".globl isr\n"
+                        "isr: addi x6, x0, 2\n"
+                        "jalr x0, 0(x1)\n"
+                        "orphan: addi x7, x0, 3\n"
+                        "jalr x0, 0(x1)\n"
+                        "end: ecall\n";
+
+  assembleSource(source);
+  auto report = removeDead();
+  REQUIRE(report.instructionsAfter == 5);
+  REQUIRE(labels.lookup("_start"));
+  REQUIRE(labels.lookup("isr"));
+  REQUIRE_FALSE(labels.lookup("orphan"));
+
+  // Asked for another entry, _start is just another label.
+  assembleSource(source);
+  report = removeDead({}, "end");
+  REQUIRE(report.instructionsAfter == 4);
+  REQUIRE_FALSE(labels.lookup("_start"));
+  REQUIRE(labels.lookup("isr"));
+}
+
+TEST_CASE("Alignment is padded out again once dead code has gone", "[DeadCode]")
+{
+  assembleSource("addi x5, x0, 3\n"
+                 "jal x0, loop\n"
+                 "dead: addi x6, x0, 1\n"
+                 ".p2align 4\n"
+                 "loop: addi x5, x5, -1\n"
+                 "bne x5, x0, loop\n"
+                 "ecall\n");
+  REQUIRE(alignmentSites[0].padding == 1);
+
+  const auto report = removeDead();
+  REQUIRE(report.blocks == 1);
+  REQUIRE(report.instructionsAfter == 7);
+  REQUIRE(alignmentSites[0].padding == 2);
+  REQUIRE(labels.lookup("loop")->instructionIndex == 4);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 0);
+  REQUIRE(s.x[6] == 0);
+}
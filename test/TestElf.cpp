@@ -0,0 +1,158 @@
+#include "Assemble.hpp"
+#include "Elf.hpp"
+#include "catch2.hpp"
+#include <cstring>
+#include <elf.h>
+#include <string>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto assemble(string text) -> void {
+  assembleSource(move(text), Format::elf);
+}
+
+template<typename T>
+static auto read(const vector<uint8_t>& elf, size_t offset) -> T {
+  T value;
+  memcpy(&value, elf.data() + offset, sizeof(T));
+  return value;
+}
+
+static auto section(const vector<uint8_t>& elf, const char* name) -> Elf32_Shdr {
+  const auto header = read<Elf32_Ehdr>(elf, 0);
+  const auto names = read<Elf32_Shdr>(elf, header.e_shoff + header.e_shstrndx * sizeof(Elf32_Shdr));
+  for (size_t i = 0; i < header.e_shnum; i++) {
+    const auto s = read<Elf32_Shdr>(elf, header.e_shoff + i * sizeof(Elf32_Shdr));
+    if (strcmp((const char*) elf.data() + names.sh_offset + s.sh_name, name) == 0) return s;
+  }
+  FAIL("No section " << name);
+  return {};
+}
+
+static const char* callsOut =
+  "main:\n"
+  "    addi x10, x0, 1\n"
+  "loop:\n"
+  "    jal x1, print_int\n"
+  "    bne x10, x0, loop\n"
+  "    beq x10, x11, exit\n";
+
+TEST_CASE("ELF objects have an RV32 relocatable header", "[Elf]")
+{
+  assemble(callsOut);
+  const auto elf = buildRelocatableElf(image, labels);
+  const auto header = read<Elf32_Ehdr>(elf, 0);
+
+  REQUIRE(memcmp(header.e_ident, ELFMAG, SELFMAG) == 0);
+  REQUIRE(header.e_ident[EI_CLASS] == ELFCLASS32);
+  REQUIRE(header.e_ident[EI_DATA] == ELFDATA2LSB);
+  REQUIRE(header.e_type == ET_REL);
+  REQUIRE(header.e_machine == EM_RISCV);
+
+  const auto text = section(elf, ".text");
+  REQUIRE(text.sh_size == 16);
+  REQUIRE(memcmp(elf.data() + text.sh_offset, image.bytes.data(), 16) == 0);
+}
+
+TEST_CASE("Labels are local symbols, unresolved targets undefined globals", "[Elf]")
+{
+  assemble(callsOut);
+  const auto elf = buildRelocatableElf(image, labels);
+  const auto symtab = section(elf, ".symtab");
+  const auto strtab = section(elf, ".strtab");
+
+  auto symbol = [&](const char* name) -> optional<pair<size_t, Elf32_Sym>> {
+    for (size_t i = 0; i < symtab.sh_size / sizeof(Elf32_Sym); i++) {
+      const auto s = read<Elf32_Sym>(elf, symtab.sh_offset + i * sizeof(Elf32_Sym));
+      if (strcmp((const char*) elf.data() + strtab.sh_offset + s.st_name, name) == 0) return pair{ i, s };
+    }
+    return {};
+  };
+
+  REQUIRE(symbol("loop"));
+  REQUIRE(symbol("loop")->second.st_value == 4);
+  REQUIRE(ELF32_ST_BIND(symbol("loop")->second.st_info) == STB_LOCAL);
+  REQUIRE(symbol("loop")->first < symtab.sh_info);
+
+  REQUIRE(symbol("print_int"));
+  REQUIRE(symbol("print_int")->second.st_shndx == SHN_UNDEF);
+  REQUIRE(ELF32_ST_BIND(symbol("print_int")->second.st_info) == STB_GLOBAL);
+  REQUIRE(symbol("print_int")->first >= symtab.sh_info);
+
+  const auto rela = section(elf, ".rela.text");
+  REQUIRE(rela.sh_size == 2 * sizeof(Elf32_Rela));
+
+  const auto jal = read<Elf32_Rela>(elf, rela.sh_offset);
+  REQUIRE(jal.r_offset == 4);
+  REQUIRE(ELF32_R_TYPE(jal.r_info) == R_RISCV_JAL);
+  REQUIRE(ELF32_R_SYM(jal.r_info) == symbol("print_int")->first);
+
+  const auto branch = read<Elf32_Rela>(elf, rela.sh_offset + sizeof(Elf32_Rela));
+  REQUIRE(branch.r_offset == 12);
+  REQUIRE(ELF32_R_TYPE(branch.r_info) == R_RISCV_BRANCH);
+  REQUIRE(ELF32_R_SYM(branch.r_info) == symbol("exit")->first);
+}
+
+TEST_CASE("ELF executables load the text at the start of memory", "[Elf]")
+{
+  assemble("    addi x1, x0, 1\n_start:\n    addi x2, x0, 2\n    ecall\n");
+  const auto elf = buildExecutableElf(image, labels, 0x10054, *entryPointFor(labels, {}, 0x10054));
+  const auto header = read<Elf32_Ehdr>(elf, 0);
+
+  REQUIRE(header.e_type == ET_EXEC);
+  REQUIRE(header.e_entry == 0x10058);
+  REQUIRE(header.e_phnum == 1);
+
+  const auto program = read<Elf32_Phdr>(elf, header.e_phoff);
+  REQUIRE(program.p_type == PT_LOAD);
+  REQUIRE(program.p_vaddr == 0x10054);
+  REQUIRE(program.p_filesz == 12);
+  REQUIRE(program.p_offset % program.p_align == program.p_vaddr % program.p_align);
+  REQUIRE(memcmp(elf.data() + program.p_offset, image.bytes.data(), 12) == 0);
+
+  REQUIRE(section(elf, ".text").sh_addr == 0x10054);
+}
+
+TEST_CASE("ELF executables map the text right even from an address that isn't a multiple of 4", "[Elf]")
+{
+  assemble("_start:\n    addi x1, x0, 5\n    ecall\n");
+  const auto elf = buildExecutableElf(image, labels, 0x10056, 0x10056);
+  const auto program = read<Elf32_Phdr>(elf, read<Elf32_Ehdr>(elf, 0).e_phoff);
+
+  REQUIRE(program.p_vaddr == 0x10056);
+  REQUIRE(program.p_offset % 0x1000 == program.p_vaddr % 0x1000);
+  REQUIRE(memcmp(elf.data() + program.p_offset, image.bytes.data(), 8) == 0);
+}
+
+TEST_CASE("Aligned text in an executable still maps right, and only claims the alignment it has", "[Elf]")
+{
+  assemble("_start:\n    addi x1, x0, 5\n    .balign 16\nloop:\n    addi x1, x1, -1\n    bne x1, x0, loop\n");
+  const auto elf = buildExecutableElf(image, labels, 0x10054, 0x10054);
+  const auto program = read<Elf32_Phdr>(elf, read<Elf32_Ehdr>(elf, 0).e_phoff);
+
+  REQUIRE(program.p_vaddr == 0x10054);
+  REQUIRE(program.p_offset % 0x1000 == program.p_vaddr % 0x1000);
+  REQUIRE(memcmp(elf.data() + program.p_offset, image.bytes.data(), image.size()) == 0);
+
+  const auto text = section(elf, ".text");
+  REQUIRE(text.sh_addralign == 4);
+  REQUIRE(text.sh_addr % text.sh_addralign == 0);
+  REQUIRE(text.sh_offset == program.p_offset);
+}
+
+TEST_CASE("Aligned text in an object asks the linker for its alignment", "[Elf]")
+{
+  assemble("    addi x1, x0, 5\n    .balign 16\nloop:\n    bne x1, x0, loop\n");
+
+  REQUIRE(section(buildRelocatableElf(image, labels), ".text").sh_addralign == 16);
+}
+
+TEST_CASE("The entry point can be any label", "[Elf]")
+{
+  assemble("__begin:\n    addi x1, x0, 1\nother:\n    ecall\n");
+
+  REQUIRE(entryPointFor(labels, {}, 0x20000) == 0x20000u);
+  REQUIRE(entryPointFor(labels, "other", 0x20000) == 0x20004u);
+  REQUIRE_FALSE(entryPointFor(labels, "missing", 0x20000));
+}
@@ -0,0 +1,72 @@
+#include "Assemble.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+
+using namespace std;
+using namespace DcsEmbler;
+
+// Expected words are what llvm-mc --triple=riscv32 --show-encoding gives.
+
+TEST_CASE("R-type instructions have the opcode and funct7 the spec gives them", "[Encoding]")
+{
+  assembleSource("add x5, x6, x7\n"
+                 "xor x5, x6, x7\n"
+                 "srl x5, x6, x7\n"
+                 "sra x5, x6, x7\n"
+                 "sub x5, x6, x7\n");
+
+  REQUIRE(image.wordAt(0) == 0x007302b3);
+  REQUIRE(image.wordAt(4) == 0x007342b3);
+  REQUIRE(image.wordAt(8) == 0x007352b3);
+  REQUIRE(image.wordAt(12) == 0x407352b3);
+  REQUIRE(image.wordAt(16) == 0x407302b3);
+}
+
+TEST_CASE("xor and sra run as xor and an arithmetic shift", "[Encoding]")
+{
+  assembleSource("addi x6, x0, -16\n"
+                 "addi x7, x0, 2\n"
+                 "xor x5, x6, x7\n"
+                 "sra x8, x6, x7\n"
+                 "ecall\n");
+
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[5] == uint32_t(-14));
+  REQUIRE(s.x[8] == uint32_t(-4));
+}
+
+TEST_CASE("Store offsets are split into imm[11:5] and imm[4:0]", "[Encoding]")
+{
+  assembleSource("sw x9, 4(x10)\n"
+                 "sw x9, 124(x10)\n"
+                 "sw x9, -4(x10)\n"
+                 "sh x9, 2047(x10)\n"
+                 "sb x9, -2048(x10)\n");
+
+  REQUIRE(image.wordAt(0) == 0x00952223);
+  REQUIRE(image.wordAt(4) == 0x06952e23);
+  REQUIRE(image.wordAt(8) == 0xfe952e23);
+  REQUIRE(image.wordAt(12) == 0x7e951fa3);
+  REQUIRE(image.wordAt(16) == 0x80950023);
+}
+
+TEST_CASE("A word stored 32 bytes or more away is loaded back from there", "[Encoding]")
+{
+  assembleSource("addi x10, x0, 256\n"
+                 "addi x9, x0, 77\n"
+                 "sw x9, 64(x10)\n"
+                 "sw x9, -8(x10)\n"
+                 "lw x11, 64(x10)\n"
+                 "lw x12, 248(x0)\n"
+                 "ecall\n");
+
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[11] == 77);
+  REQUIRE(s.x[12] == 77);
+}
@@ -0,0 +1,76 @@
+#include "Assemble.hpp"
+#include "Linker.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static const char* mainSource =
+  ".globl _start\n"
+  "_start:\n"
+  "    addi x10, x0, 3\n"
+  "    jal x1, double\n"
+  "loop:\n"
+  "    beq x10, x0, done\n"
+  "    addi x10, x10, -1\n"
+  "    jal x0, loop\n";
+
+static const char* librarySource =
+  ".globl double\n"
+  ".globl done\n"
+  "double:\n"
+  "    add x10, x10, x10\n"
+  "    jalr x0, 0(x1)\n"
+  "done:\n"
+  "    ecall\n";
+
+TEST_CASE("Linking objects gives what assembling them together does", "[Linker]")
+{
+  vector<ObjectFile> objects{ objectFrom("main.o", mainSource), objectFrom("library.o", librarySource) };
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE(link(objects, 0, 4, linked, globals));
+
+  assembleSource(string{ mainSource } + librarySource);
+  REQUIRE(linked.bytes == image.bytes);
+
+  REQUIRE(globals.find("double"));
+  REQUIRE(globals.find("double")->offset == 20);
+  REQUIRE_FALSE(globals.find("loop"));
+}
+
+TEST_CASE("Global symbols may only be defined once", "[Linker]")
+{
+  vector<ObjectFile> objects{ objectFrom("a.o", librarySource), objectFrom("b.o", librarySource) };
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE_FALSE(link(objects, 0, 2, linked, globals));
+}
+
+TEST_CASE("Undefined symbols fail the link", "[Linker]")
+{
+  vector<ObjectFile> objects{ objectFrom("main.o", mainSource) };
+
+  Image linked{};
+  ConcurrentSymbolTable globals{};
+  REQUIRE_FALSE(link(objects, 0, 1, linked, globals));
+}
+
+TEST_CASE("Branch and jump immediates are patched in", "[Linker]")
+{
+  // beq x1, x2, . - 8 and jal x1, . + 2048, as the assembler encodes them.
+  uint32_t beq = 0x00208063;
+  REQUIRE(patchBranch(beq, -8));
+  REQUIRE(beq == 0xfe208ce3);
+
+  uint32_t jal = 0x000000ef;
+  REQUIRE(patchJal(jal, 2048));
+  REQUIRE(jal == 0x001000ef);
+
+  REQUIRE_FALSE(patchBranch(beq, 4096));
+  REQUIRE_FALSE(patchJal(jal, 3));
+}
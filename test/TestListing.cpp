@@ -0,0 +1,63 @@
+#include "Assemble.hpp"
+#include "Listing.hpp"
+#include "catch2.hpp"
+#include <string>
+
+using namespace std;
+using namespace DcsEmbler;
+
+/// The listing for `text`, assembled from `startOfMemory`.
+static auto listingFor(string text, int startOfMemory = 0) -> string {
+  resetAssembler();
+  opts.startOfMemory = startOfMemory;
+  out = tmpfile();
+
+  labelPassOver(text);
+
+  FILE* listing = tmpfile();
+  instructionIndex = 0;
+  REQUIRE(emitWithListing(text.data(), text.size(), listing));
+  fclose(out);
+
+  string written(ftell(listing), '\0');
+  rewind(listing);
+  REQUIRE(fread(written.data(), 1, written.size(), listing) == written.size());
+  fclose(listing);
+  return written;
+}
+
+TEST_CASE("A listing has the address, encoding and source of each line", "[Listing]")
+{
+  const string listing = listingFor("# Counts down\n"
+                                    "\n"
+                                    "start: addi x1, x0, 5\n"
+                                    "loop:\n"
+                                    "    addi x1, x1, -1\n"
+                                    "    bne x1, x0, loop\n",
+                                    0x100);
+
+  REQUIRE(listing == "                    # Counts down\n"
+                     "\n"
+                     "00000100  00500093  start: addi x1, x0, 5\n"
+                     "                    loop:\n"
+                     "00000104  FFF08093      addi x1, x1, -1\n"
+                     "00000108  FE009EE3      bne x1, x0, loop\n");
+}
+
+TEST_CASE("A line that comes out as two instructions lists both", "[Listing]")
+{
+  const string listing = listingFor("li x1, 4097\r\necall\n");
+
+  REQUIRE(listing == "00000000  000010B7  li x1, 4097\n"
+                     "00000004  00108093\n"
+                     "00000008  00000073  ecall\n");
+}
+
+TEST_CASE("The listing file is named after the output file", "[Listing]")
+{
+  Options o{ .inputFileName = "prog.s", .outputFileName = "prog.bin" };
+  REQUIRE(o.getListingFileName() == "prog.bin.lst");
+
+  o.listingFileName = "elsewhere.lst";
+  REQUIRE(o.getListingFileName() == "elsewhere.lst");
+}
@@ -0,0 +1,255 @@
+#include "Assemble.hpp"
+#include "LiteralPool.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+/// Turning --literalPool on and laying a pool out is left in the globals for a test to look at -
+/// this puts it all back once the test's done, so nothing after it gets a pool it didn't ask for.
+struct RestoresAssembler {
+  ~RestoresAssembler() { resetAssembler(); }
+};
+
+/// assembleSource, with --literalPool - the label pass run as many times as main runs it.
+static auto assembleWithPool(string text, int startOfMemory = 0, Format format = Format::binary) -> void {
+  resetAssembler();
+  opts.literalPool = true;
+  opts.startOfMemory = startOfMemory;
+  opts.format = format;
+  out = tmpfile();
+
+  layOutLiteralPool([&] {
+    labels.clear();
+    relaxableSites.clear();
+    alignmentSites.clear();
+    instructionIndex = 0;
+    string labelPassText = text;
+    forEachLine(labelPassText.data(), labelPassText.size(), [](char* line, int lineNumber) {
+      huntForLabels(firstToken(line), lineNumber);
+    });
+    noteLiteralPoolEnd();
+    vector<Checkpoint> unused;
+    return instructionIndex + relaxSites(unused);
+  });
+
+  instructionIndex = 0;
+  forEachLine(text.data(), text.size(), [](char* line, int lineNumber) {
+    handleLine(firstToken(line), lineNumber);
+  });
+  if (literalPool.lineNumber == 0) emitLiteralPool();
+  fclose(out);
+}
+
+static auto runToEcall(uint32_t loadAddress = 0) -> Simulator {
+  Simulator s{ image, loadAddress };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+static auto report() -> string {
+  FILE* f = tmpfile();
+  printLiteralPoolReport(f);
+  string text(ftell(f), '\0');
+  rewind(f);
+  REQUIRE(fread(text.data(), 1, text.size(), f) == text.size());
+  fclose(f);
+  return text;
+}
+
+static auto nops(int count) -> string {
+  string text;
+  for (int i = 0; i < count; i++) text += "nop\n";
+  return text;
+}
+
+TEST_CASE("x0 reaches the bottom and top 2 KiB of memory", "[LiteralPool]")
+{
+  REQUIRE(withinReachOfX0(0, 2048));
+  REQUIRE(withinReachOfX0(2044, 4));
+  REQUIRE_FALSE(withinReachOfX0(2044, 8));
+  REQUIRE_FALSE(withinReachOfX0(0x1000, 4));
+  REQUIRE(withinReachOfX0(0xfffff800, 2048));
+  REQUIRE_FALSE(withinReachOfX0(0xfffff7fc, 8));
+  REQUIRE_FALSE(withinReachOfX0(0xfffffffc, 8));
+}
+
+TEST_CASE("A constant loaded more than once goes in the pool after the code", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  assembleWithPool("li x5, 0x12345678\n"
+                   "li x6, 0x12345678\n"
+                   "li x7, 0xdeadbeef\n"
+                   "li x8, 0x12345678\n"
+                   "ecall\n");
+
+  // Three lw's, the lui and addi used once, the ecall, and the pool.
+  REQUIRE(literalPool.constants == vector<uint32_t>{ 0x12345678 });
+  REQUIRE(literalPool.loads == 3);
+  REQUIRE(literalPool.address == 24);
+  REQUIRE(image.size() == 7 * 4);
+  REQUIRE(image.wordAt(0) == 0x01802283); // lw x5, 24(x0)
+  REQUIRE(image.wordAt(24) == 0x12345678);
+  REQUIRE(labels.lookup(literalPoolLabel)->instructionIndex == 6);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 0x12345678);
+  REQUIRE(s.x[6] == 0x12345678);
+  REQUIRE(s.x[7] == 0xdeadbeef);
+  REQUIRE(s.x[8] == 0x12345678);
+}
+
+TEST_CASE("The pool goes at the first .ltorg, moving what's after it", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  assembleWithPool("jal x0, start\n"
+                   ".ltorg\n"
+                   "start: li x5, -559038737\n"
+                   "li x6, 0xdeadbeef\n"
+                   ".ltorg\n"
+                   "ecall\n");
+
+  REQUIRE(literalPool.address == 4);
+  REQUIRE(image.wordAt(4) == 0xdeadbeef);
+  REQUIRE(labels.lookup("start")->instructionIndex == 2);
+  REQUIRE(image.size() == 5 * 4);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 0xdeadbeef);
+  REQUIRE(s.x[6] == 0xdeadbeef);
+}
+
+TEST_CASE("Only as much of the pool as is in reach is used, most used first", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  // The pool starts 8 bytes short of 2 KiB - room for two.
+  assembleWithPool("jal x0, start\n" + nops(509) + ".ltorg\n"
+                   "start:\n"
+                   "li x5, 0x11111111\n"
+                   "li x6, 0x22222222\n"
+                   "li x7, 0x33333333\n"
+                   "li x5, 0x11111111\n"
+                   "li x6, 0x22222222\n"
+                   "li x7, 0x33333333\n"
+                   "li x5, 0x11111111\n"
+                   "li x5, 0x11111111\n"
+                   "li x6, 0x22222222\n"
+                   "ecall\n");
+
+  REQUIRE(literalPool.address == 2040);
+  REQUIRE(literalPool.constants == vector<uint32_t>{ 0x11111111, 0x22222222 });
+  REQUIRE(literalPool.leftOut == 1);
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 0x11111111);
+  REQUIRE(s.x[6] == 0x22222222);
+  REQUIRE(s.x[7] == 0x33333333);
+}
+
+TEST_CASE("Nothing is pooled out of reach, or when it wouldn't be smaller", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  const string source = "li x5, 0x12345678\n"
+                        "li x6, 0x12345678\n"
+                        "li x7, 0xdeadbeef\n"
+                        "ecall\n";
+
+  assembleWithPool(source, 0x1000);
+  REQUIRE(literalPool.constants.empty());
+  REQUIRE(literalPool.leftOut == 1);
+  REQUIRE(image.size() == 7 * 4);
+  REQUIRE_FALSE(labels.lookup(literalPoolLabel));
+
+  // Used once, it's two words either way - so it stays where it's used.
+  assembleWithPool(source);
+  REQUIRE(literalPool.constants == vector<uint32_t>{ 0x12345678 });
+  REQUIRE(literalPool.leftOut == 0);
+  REQUIRE(image.size() == 6 * 4);
+}
+
+TEST_CASE("A pool alignment pushes out of reach is laid out again without it", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  // Counting instructions, it fits at 1212 - but the padding puts it at 2228.
+  assembleWithPool("li x5, 0x12345678\n"
+                   "li x6, 0x12345678\n"
+                   ".p2align 10\n" +
+                   nops(300) + "ecall\n");
+
+  REQUIRE(literalPool.constants.empty());
+  REQUIRE(literalPool.leftOut == 1);
+  REQUIRE(image.size() == (4 + 252 + 301) * 4);
+  REQUIRE(image.wordAt(0) == 0x123452b7); // lui x5, 0x12345
+
+  const auto s = runToEcall();
+  REQUIRE(s.x[5] == 0x12345678);
+  REQUIRE(s.x[6] == 0x12345678);
+}
+
+static const char* twoConstantsFiveTimes = "li x5, 0x12345678\n"
+                                           "li x6, 0x12345678\n"
+                                           "li x7, 0xdeadbeef\n"
+                                           "li x8, 0xdeadbeef\n"
+                                           "li x9, 0x12345678\n"
+                                           "ecall\n";
+
+TEST_CASE("Out of x0's reach, the pool is loaded off x3, set up in front of the first instruction", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+  assembleWithPool(string{ ".globl _start\n"
+                           "_start:\n" } +
+                     twoConstantsFiveTimes,
+                   0x20000, Format::executable);
+
+  // The setup, five lw's, the ecall, and the pool - two words smaller than inline.
+  REQUIRE(literalPool.base == gpRegister);
+  REQUIRE(literalPool.constants == vector<uint32_t>{ 0x12345678, 0xdeadbeef });
+  REQUIRE(literalPool.address == 0x20020);
+  REQUIRE(literalPool.baseAddress == 0x20820);
+  REQUIRE(image.size() == 10 * 4);
+  REQUIRE(labels.lookup("_start")->instructionIndex == 0);
+  REQUIRE(image.wordAt(0) == 0x000211b7); // lui x3, 0x21
+  REQUIRE(image.wordAt(4) == 0x82018193); // addi x3, x3, -2016
+  REQUIRE(image.wordAt(8) == 0x8001a283); // lw x5, -2048(x3)
+  REQUIRE(report().find("loaded off x3") != string::npos);
+
+  const auto s = runToEcall(0x20000);
+  REQUIRE(s.x[3] == 0x20820);
+  REQUIRE(s.x[5] == 0x12345678);
+  REQUIRE(s.x[7] == 0xdeadbeef);
+  REQUIRE(s.x[8] == 0xdeadbeef);
+  REQUIRE(s.x[9] == 0x12345678);
+}
+
+TEST_CASE("x3 is left alone where the program needs it, and the report says why", "[LiteralPool]")
+{
+  const RestoresAssembler restore{};
+
+  assembleWithPool(string{ "addi x3, x0, 1\n" } + twoConstantsFiveTimes, 0x20000);
+  REQUIRE(literalPool.base == 0);
+  REQUIRE(literalPool.constants.empty());
+  REQUIRE(literalPool.leftOut == 2);
+  REQUIRE(image.size() == 12 * 4);
+  REQUIRE(report().find("the program uses x3 itself") != string::npos);
+
+  // An executable that starts further in would never set it up.
+  assembleWithPool(string{ "jal x0, _start\n"
+                           "_start:\n" } +
+                     twoConstantsFiveTimes,
+                   0x20000, Format::executable);
+  REQUIRE(literalPool.base == 0);
+  REQUIRE(literalPool.constants.empty());
+  REQUIRE(report().find("starts at its entry label") != string::npos);
+
+  // And with only one constant used twice, setting it up would cost more than it saves.
+  assembleWithPool("li x5, 0x12345678\n"
+                   "li x6, 0x12345678\n",
+                   0x20000);
+  REQUIRE(literalPool.constants.empty());
+  REQUIRE(report().find("wouldn't save enough") != string::npos);
+}
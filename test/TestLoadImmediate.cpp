@@ -0,0 +1,59 @@
+#include "Assemble.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+
+using namespace std;
+using namespace DcsEmbler;
+
+/// What x5 holds after running `li x5, <value>`.
+static auto loaded(const string& value) -> uint32_t {
+  assembleSource("li x5, " + value + "\necall\n");
+
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s.x[5];
+}
+
+TEST_CASE("li loads every kind of value", "[LoadImmediate]")
+{
+  for (int64_t value : { 0ll, 1ll, -1ll, 2047ll, -2048ll, 2048ll, -2049ll, 4096ll, 4095ll, 0x800ll, 0xfffll,
+                         0x12345fffll, 0x12345800ll, 0x7fffffffll, -0x80000000ll, 0x7ffff800ll }) {
+    INFO(value);
+    REQUIRE(loaded(to_string(value)) == (uint32_t) value);
+  }
+
+  REQUIRE(loaded("0xdeadbeef") == 0xdeadbeef);
+  REQUIRE(loaded("0xfffff800") == 0xfffff800);
+}
+
+TEST_CASE("li uses the fewest instructions it can", "[LoadImmediate]")
+{
+  assembleSource("li x1, -2048\n");
+  REQUIRE(image.size() == 4);
+  REQUIRE(image.wordAt(0) == 0x80000093); // addi x1, x0, -2048
+
+  assembleSource("li x1, 0x12345000\n");
+  REQUIRE(image.size() == 4);
+  REQUIRE(image.wordAt(0) == 0x123450b7); // lui x1, 0x12345
+
+  assembleSource("li x1, 0x12345800\n");
+  REQUIRE(image.size() == 8);
+  REQUIRE(image.wordAt(0) == 0x123460b7); // lui x1, 0x12346
+  REQUIRE(image.wordAt(4) == 0x80008093); // addi x1, x1, -2048
+}
+
+TEST_CASE("Labels after an li are where the emit pass puts them", "[LoadImmediate]")
+{
+  assembleSource("li x1, 5\n"
+                 "one: li x2, 0x10000\n"
+                 "two: li x3, 0x10001\n"
+                 "three: beq x0, x0, one\n");
+
+  REQUIRE(labels.lookup("one")->instructionIndex == 1);
+  REQUIRE(labels.lookup("two")->instructionIndex == 2);
+  REQUIRE(labels.lookup("three")->instructionIndex == 4);
+  REQUIRE(image.size() == 5 * 4);
+}
@@ -0,0 +1,168 @@
+#include "Alignment.hpp"
+#include "Assemble.hpp"
+#include "Corpus.hpp"
+#include "MappedOutput.hpp"
+#include "Packing.hpp"
+#include "Relaxation.hpp"
+#include "catch2.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto labelPass(const string& text, vector<Checkpoint>& checkpoints, uint32_t loopAlignment = 0) -> int {
+  string copy = text;
+  instructionIndex = 0;
+  forEachLine(copy.data(), copy.size(), [&](char* line, int lineNumber) {
+    if ((lineNumber - 1) % linesPerCheckpoint == 0) {
+      checkpoints.push_back({ (size_t) (line - copy.data()), lineNumber, instructionIndex });
+    }
+    huntForLabels(firstToken(line), lineNumber);
+  });
+  if (loopAlignment != 0) alignLoopHeads(loopAlignment);
+  return instructionIndex + relaxSites(checkpoints);
+}
+
+static auto readBack(FILE* f) -> string {
+  fflush(f);
+  string bytes(ftell(f), '\0');
+  rewind(f);
+  fread(bytes.data(), 1, bytes.size(), f);
+  return bytes;
+}
+
+static auto assembleSerially(string text, Format format, const Packing& packing = {}, uint32_t loopAlignment = 0) -> string {
+  resetAssembler();
+  opts.format = format;
+  opts.wordWidth = (int) packing.bytesPerWord * 8;
+  opts.byteOrder = packing.byteOrder;
+  vector<Checkpoint> unused;
+  labelPass(text, unused, loopAlignment);
+
+  image.clear();
+  out = tmpfile();
+  instructionIndex = 0;
+  forEachLine(text.data(), text.size(), [](char* line, int lineNumber) {
+    handleLine(firstToken(line), lineNumber);
+  });
+  if (format == Format::binary) REQUIRE(writePacked(out, image, packing));
+  if (format == Format::hex) REQUIRE(writeHexLines(out, image));
+
+  auto bytes = readBack(out);
+  fclose(out);
+  return bytes;
+}
+
+static auto assembleInParallel(string text, Format format, unsigned jobs, const Packing& packing = {},
+                               uint32_t loopAlignment = 0) -> string {
+  resetAssembler();
+  opts.format = format;
+  opts.wordWidth = (int) packing.bytesPerWord * 8;
+  opts.byteOrder = packing.byteOrder;
+  vector<Checkpoint> checkpoints;
+  const int count = labelPass(text, checkpoints, loopAlignment);
+
+  image.clear();
+  image.bytes.resize(count * 4);
+  out = tmpfile();
+  {
+    MappedOutput mapped{};
+    size_t size = count * outputBytesPerInstruction(format);
+    if (format == Format::binary) size = packedSize(size, packing);
+    REQUIRE(mapped.open(out, size));
+    mappedOut = mapped.data;
+    emitInParallel(text.data(), text.size(), checkpoints, jobs);
+    mappedOut = nullptr;
+  }
+
+  fseek(out, 0, SEEK_END);
+  auto bytes = readBack(out);
+  fclose(out);
+  return bytes;
+}
+
+TEST_CASE("Parallel mapped output matches writing it serially", "[MappedOutput]")
+{
+  CorpusSpec spec{};
+  spec.lines = 5 * linesPerCheckpoint;
+  spec.directiveRatio = 0.05;
+  spec.commentRatio = 0.05;
+  const auto text = generateCorpus(spec);
+
+  for (auto format : { Format::binary, Format::hex }) {
+    const auto serial = assembleSerially(text, format);
+    const auto serialImage = image.bytes;
+
+    const auto parallel = assembleInParallel(text, format, 4);
+
+    INFO("format " << (int) format);
+    REQUIRE(parallel.size() == serial.size());
+    REQUIRE(parallel == serial);
+    REQUIRE(image.bytes == serialImage);
+  }
+}
+
+TEST_CASE("Parallel mapped output is packed the same as serial output", "[MappedOutput]")
+{
+  CorpusSpec spec{};
+  spec.lines = 3 * linesPerCheckpoint + 1;
+  const auto text = generateCorpus(spec);
+
+  for (unsigned bytesPerWord : { 4u, 8u, 16u }) {
+    const Packing packing{ bytesPerWord, Endianness::big };
+    const auto serial = assembleSerially(text, Format::binary, packing);
+    const auto parallel = assembleInParallel(text, Format::binary, 4, packing);
+
+    INFO("bytes per word " << bytesPerWord);
+    REQUIRE(serial.size() % bytesPerWord == 0);
+    REQUIRE(parallel == serial);
+  }
+}
+
+TEST_CASE("Parallel mapped output pads alignment the same as serial output", "[MappedOutput]")
+{
+  CorpusSpec spec{};
+  spec.lines = 3 * linesPerCheckpoint;
+  istringstream corpus{ generateCorpus(spec) };
+
+  // Some straight on a checkpoint's line, which is before the padding, and some on the line after.
+  string text;
+  string line;
+  int lineNumber = 1;
+  for (int n = 1; getline(corpus, line); n++) {
+    if (n % 997 == 0 or (lineNumber - 1) % linesPerCheckpoint == 0) {
+      text += ".p2align 5\n";
+      lineNumber++;
+    } else if ((lineNumber - 2) % linesPerCheckpoint == 0) {
+      text += ".balign 16\n";
+      lineNumber++;
+    }
+    text += line + '\n';
+    lineNumber++;
+  }
+
+  for (uint32_t loopAlignment : { 0u, 16u }) {
+    const auto serial = assembleSerially(text, Format::binary, {}, loopAlignment);
+    const auto parallel = assembleInParallel(text, Format::binary, 4, {}, loopAlignment);
+
+    INFO("loop alignment " << loopAlignment);
+    REQUIRE(serial.size() > spec.lines * 4);
+    REQUIRE(parallel == serial);
+  }
+}
+
+TEST_CASE("The label pass counts what the emit pass emits", "[MappedOutput]")
+{
+  auto count = [](vector<const char*> tokens) {
+    return instructionCountFor(const_cast<char* const*>(tokens.data()), tokens.size());
+  };
+  REQUIRE(count({ "addi", "x1", "x0", "1" }) == 1);
+  REQUIRE(count({ "li", "x1", "2047" }) == 1);
+  REQUIRE(count({ "li", "x1", "4096" }) == 1);
+  REQUIRE(count({ "li", "x1", "4097" }) == 2);
+  REQUIRE(count({ ".text" }) == 0);
+  REQUIRE(count({ "#" }) == 0);
+  REQUIRE(count({}) == 0);
+}
@@ -0,0 +1,78 @@
+#include "MemoryInit.hpp"
+#include "catch2.hpp"
+#include <string>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto written(const Image& image, Format format, const MemoryGeometry& geometry) -> string {
+  FILE* f = tmpfile();
+  REQUIRE(writeMemoryInit(f, image, format, geometry));
+
+  string text(ftell(f), '\0');
+  rewind(f);
+  REQUIRE(fread(text.data(), 1, text.size(), f) == text.size());
+  fclose(f);
+  return text;
+}
+
+static auto twoInstructions() -> Image {
+  Image image{};
+  image.appendWord(0x00100093);
+  image.appendWord(0x00000073);
+  return image;
+}
+
+TEST_CASE("readmemh and readmemb write a word per line", "[MemoryInit]")
+{
+  const auto image = twoInstructions();
+
+  REQUIRE(written(image, Format::readmemh, {}) == "00100093\n00000073\n");
+  REQUIRE(written(image, Format::readmemh, { .depth = 3, .fill = 0x13 }) == "00100093\n00000073\n00000013\n");
+  REQUIRE(written(image, Format::readmemb, { .depth = 1, .wordWidth = 8 }) == "10010011\n");
+}
+
+TEST_CASE("Wide words hold consecutive instructions", "[MemoryInit]")
+{
+  REQUIRE(written(twoInstructions(), Format::readmemh, { .wordWidth = 64 }) == "0000007300100093\n");
+}
+
+TEST_CASE("COE and MIF files have their headers", "[MemoryInit]")
+{
+  const auto image = twoInstructions();
+
+  REQUIRE(written(image, Format::coe, {}) ==
+          "memory_initialization_radix=16;\nmemory_initialization_vector=\n00100093,\n00000073;\n");
+
+  REQUIRE(written(image, Format::mif, { .depth = 16 }) ==
+          "WIDTH=32;\nDEPTH=16;\n\nADDRESS_RADIX=HEX;\nDATA_RADIX=HEX;\n\nCONTENT BEGIN\n"
+          "\t0 : 00100093;\n\t1 : 00000073;\n\t[2..F] : 00000000;\nEND;\n");
+}
+
+TEST_CASE("Intel HEX records are checksummed", "[MemoryInit]")
+{
+  REQUIRE(written(twoInstructions(), Format::ihex, {}) ==
+          ":040000000010009359\n:040001000000007388\n:00000001FF\n");
+}
+
+TEST_CASE("Intel HEX moves on the upper address past 64Ki words", "[MemoryInit]")
+{
+  const auto text = written(twoInstructions(), Format::ihex, { .depth = 0x10001 });
+  REQUIRE(text.find(":020000040001F9\n:0400000000000000FC\n:00000001FF\n") != string::npos);
+}
+
+TEST_CASE("Big memories come out whole across blocks", "[MemoryInit]")
+{
+  const auto text = written(twoInstructions(), Format::readmemh, { .depth = 100000, .fill = 0x13 });
+  REQUIRE(text.size() == 100000 * 9);
+  REQUIRE(text.substr(text.size() - 9) == "00000013\n");
+}
+
+TEST_CASE("Memories the program doesn't fit in are refused", "[MemoryInit]")
+{
+  const auto image = twoInstructions();
+
+  REQUIRE(checkMemoryGeometry({ .depth = 2 }, image));
+  REQUIRE_FALSE(checkMemoryGeometry({ .depth = 1 }, image));
+  REQUIRE_FALSE(checkMemoryGeometry({ .wordWidth = 12 }, image));
+}
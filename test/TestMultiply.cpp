@@ -0,0 +1,98 @@
+#include "Assemble.hpp"
+#include "Scheduler.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+TEST_CASE("M extension encodings match llvm-mc", "[Multiply]")
+{
+  assembleSource("mul x1, x2, x3\n"
+                 "mulh x1, x2, x3\n"
+                 "mulhsu x1, x2, x3\n"
+                 "mulhu x1, x2, x3\n"
+                 "div x1, x2, x3\n"
+                 "divu x1, x2, x3\n"
+                 "rem x1, x2, x3\n"
+                 "REMU x1, x2, x3\n",
+                 Format::binary, 0, Isa::rv32im);
+
+  const vector<uint32_t> expected{ 0x023100b3, 0x023110b3, 0x023120b3, 0x023130b3,
+                                   0x023140b3, 0x023150b3, 0x023160b3, 0x023170b3 };
+  REQUIRE(image.size() == expected.size() * 4);
+  for (size_t i = 0; i < expected.size(); i++) REQUIRE(image.wordAt(i * 4) == expected[i]);
+}
+
+TEST_CASE("The R-type instructions next to them are encoded right too", "[Multiply]")
+{
+  assembleSource("xor x1, x2, x3\n"
+                 "sra x1, x2, x3\n"
+                 "sub x1, x2, x3\n");
+  REQUIRE(image.wordAt(0) == 0x003140b3);
+  REQUIRE(image.wordAt(4) == 0x403150b3);
+  REQUIRE(image.wordAt(8) == 0x403100b3);
+}
+
+TEST_CASE("Multiplies and divides run as the spec says, edge cases included", "[Multiply]")
+{
+  assembleSource("li x5, -7\n"
+                 "li x6, 2\n"
+                 "li x12, 0x80000000\n"
+                 "li x13, -1\n"
+                 "mul x7, x5, x6\n"
+                 "div x8, x5, x6\n"
+                 "rem x9, x5, x6\n"
+                 "divu x10, x5, x0\n"
+                 "rem x11, x5, x0\n"
+                 "div x14, x12, x13\n"
+                 "rem x15, x12, x13\n"
+                 "mulhu x16, x12, x12\n"
+                 "mulh x17, x5, x6\n"
+                 "mulhsu x18, x13, x13\n"
+                 "remu x19, x6, x5\n"
+                 "ecall\n",
+                 Format::binary, 0, Isa::rv32im);
+
+  const auto s = runToEcall();
+  REQUIRE((int32_t) s.x[7] == -14);
+  REQUIRE((int32_t) s.x[8] == -3);
+  REQUIRE((int32_t) s.x[9] == -1);
+  REQUIRE(s.x[10] == 0xffffffff);
+  REQUIRE((int32_t) s.x[11] == -7);
+  REQUIRE(s.x[14] == 0x80000000);
+  REQUIRE(s.x[15] == 0);
+  REQUIRE(s.x[16] == 0x40000000);
+  REQUIRE(s.x[17] == 0xffffffff);
+  REQUIRE(s.x[18] == 0xffffffff);
+  REQUIRE(s.x[19] == 2);
+}
+
+TEST_CASE("Scheduling waits out a divide, and not a multiply", "[Multiply]")
+{
+  assembleSource("div x5, x6, x7\n"
+                 "add x8, x5, x5\n"
+                 "mul x9, x6, x7\n"
+                 "add x10, x9, x9\n",
+                 Format::binary, 0, Isa::rv32im);
+
+  vector<DecodedInstruction> decoded;
+  for (size_t at = 0; at < image.size(); at += 4) decoded.push_back(decode(image.wordAt(at)));
+  REQUIRE(countStalls(decoded.data(), decoded.size(), {}) == 31);
+  REQUIRE(countStalls(decoded.data(), decoded.size(), { .divide = 4 }) == 3);
+
+  // The multiply and its use go in the divide's shadow.
+  const auto report = scheduleImage(image, labels, {});
+  REQUIRE(report.stallsAfter == 29);
+  REQUIRE(image.wordAt(12) == decoded[1].word);
+}
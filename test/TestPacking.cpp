@@ -0,0 +1,94 @@
+#include "Packing.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto counting(size_t size) -> vector<uint8_t> {
+  vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < size; i++) bytes[i] = (uint8_t) (i * 37 + 11);
+  return bytes;
+}
+
+/// A byte at a time, for the shuffles to be checked against.
+static auto reversedWords(const vector<uint8_t>& bytes, unsigned bytesPerWord) -> vector<uint8_t> {
+  vector<uint8_t> reversed(bytes.size());
+  for (size_t i = 0; i < bytes.size(); i++) {
+    const size_t word = i / bytesPerWord * bytesPerWord;
+    reversed[i] = bytes[word + bytesPerWord - 1 - (i - word)];
+  }
+  return reversed;
+}
+
+TEST_CASE("Big-endian packing reverses every word", "[Packing]")
+{
+  for (unsigned bytesPerWord : { 4u, 8u, 16u }) {
+    // Enough for the vector loops, and an odd number of words left over for the scalar one.
+    for (size_t words : { 1, 3, 7, 64, 1001 }) {
+      const auto bytes = counting(words * bytesPerWord);
+      const Packing packing{ bytesPerWord, Endianness::big };
+
+      vector<uint8_t> packed(bytes.size());
+      packWords(bytes.data(), packed.data(), bytes.size(), packing);
+
+      auto inPlace = bytes;
+      packWords(inPlace.data(), inPlace.data(), inPlace.size(), packing);
+
+      INFO(bytesPerWord << " bytes a word, " << words << " words");
+      REQUIRE(packed == reversedWords(bytes, bytesPerWord));
+      REQUIRE(inPlace == packed);
+    }
+  }
+}
+
+TEST_CASE("Little-endian packing leaves the image as it is", "[Packing]")
+{
+  const auto bytes = counting(64);
+  vector<uint8_t> packed(bytes.size());
+  packWords(bytes.data(), packed.data(), bytes.size(), { 16, Endianness::little });
+  REQUIRE(packed == bytes);
+}
+
+TEST_CASE("Each instruction's packed offset agrees with packing the whole image", "[Packing]")
+{
+  for (unsigned bytesPerWord : { 4u, 8u, 16u }) {
+    const Packing packing{ bytesPerWord, Endianness::big };
+    const auto bytes = counting(64);
+    vector<uint8_t> packed(bytes.size());
+    packWords(bytes.data(), packed.data(), bytes.size(), packing);
+
+    for (size_t offset = 0; offset < bytes.size(); offset += 4) {
+      const size_t at = packedOffsetOf(offset, packing);
+      INFO(bytesPerWord << " bytes a word, instruction at " << offset);
+      for (size_t b = 0; b < 4; b++) REQUIRE(packed[at + b] == bytes[offset + 3 - b]);
+    }
+  }
+}
+
+TEST_CASE("A partly filled last word is padded with zeros", "[Packing]")
+{
+  Image image{};
+  image.appendWord(0x00500093);
+  image.appendWord(0xfff08093);
+  image.appendWord(0x00000073);
+
+  FILE* f = tmpfile();
+  REQUIRE(writePacked(f, image, { 8, Endianness::big }));
+  vector<uint8_t> written(ftell(f));
+  rewind(f);
+  REQUIRE(fread(written.data(), 1, written.size(), f) == written.size());
+  fclose(f);
+
+  REQUIRE(written == vector<uint8_t>{ 0xff, 0xf0, 0x80, 0x93, 0x00, 0x50, 0x00, 0x93,
+                                      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x73 });
+}
+
+TEST_CASE("Only 32, 64 and 128 bit words are packed into", "[Packing]")
+{
+  REQUIRE(checkPacking({ 4, Endianness::little }));
+  REQUIRE(checkPacking({ 16, Endianness::big }));
+  REQUIRE_FALSE(checkPacking({ 2, Endianness::big }));
+  REQUIRE_FALSE(checkPacking({ 12, Endianness::big }));
+}
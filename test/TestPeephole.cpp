@@ -0,0 +1,144 @@
+#include "Assemble.hpp"
+#include "Peephole.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+
+using namespace std;
+using namespace DcsEmbler;
+
+/// Assembles and optimizes `text`, leaving the result in the image and labels.
+static auto optimized(const string& text, Format format = Format::binary) -> PeepholeReport {
+  assembleSource(text, format);
+  const auto report = optimizeImage(image, labels);
+  REQUIRE(report);
+  REQUIRE(report->instructionsAfter * 4 == (int) image.size());
+  return *report;
+}
+
+static auto hitsFor(const PeepholeReport& report, const string& rule) -> uint64_t {
+  for (size_t r = 0; r < peepholeRules.size(); r++) {
+    if (peepholeRules[r].name == rule) return report.hits[r];
+  }
+  FAIL("no rule " << rule);
+  return 0;
+}
+
+TEST_CASE("Instructions that don't do anything are removed", "[Peephole]")
+{
+  const auto report = optimized("mv x5, x5\n"
+                                "or x6, x6, x0\n"
+                                "addi x0, x1, 5\n"
+                                "add x0, x1, x2\n"
+                                "nop\n"
+                                "nop\n"
+                                "nop\n"
+                                "addi x7, x7, 1\n"
+                                "ecall\n");
+
+  REQUIRE(report.instructionsBefore == 9);
+  REQUIRE(report.instructionsAfter == 3);
+  REQUIRE(hitsFor(report, "self-move") == 2);
+  REQUIRE(hitsFor(report, "zero-write") == 2);
+  REQUIRE(hitsFor(report, "nop-run") == 2);
+  REQUIRE(image.wordAt(0) == 0x00000013); // one nop left
+  REQUIRE(image.wordAt(4) == 0x00138393); // addi x7, x7, 1
+}
+
+TEST_CASE("Branches and labels are moved to where things end up", "[Peephole]")
+{
+  optimized("top: mv x5, x5\n"
+            "beq x1, x2, end\n"
+            "mv x6, x6\n"
+            "nop\n"
+            "nop\n"
+            "end: bne x1, x2, top\n");
+
+  REQUIRE(labels.lookup("top")->instructionIndex == 0);
+  REQUIRE(labels.lookup("end")->instructionIndex == 2);
+  REQUIRE(image.size() == 3 * 4);
+  REQUIRE(decode(image.wordAt(0)).immediate == 8);
+  REQUIRE(decode(image.wordAt(8)).immediate == -8);
+}
+
+TEST_CASE("A jump to what comes next goes, even once it only comes next after other removals", "[Peephole]")
+{
+  const auto report = optimized("beq x1, x2, done\n"
+                                "jal x0, done\n"
+                                "mv x5, x5\n"
+                                "done: ecall\n");
+
+  REQUIRE(hitsFor(report, "jump-to-next") == 2);
+  REQUIRE(image.size() == 4);
+  REQUIRE(image.wordAt(0) == 0x00000073);
+}
+
+TEST_CASE("A jal that links isn't a jump to next", "[Peephole]")
+{
+  optimized("jal x1, next\n"
+            "next: ecall\n");
+  REQUIRE(image.size() == 2 * 4);
+}
+
+TEST_CASE("Back-to-back addis are fused, unless something jumps between them", "[Peephole]")
+{
+  auto report = optimized("addi x5, x1, 1000\n"
+                          "addi x5, x5, 1000\n"
+                          "ecall\n");
+  REQUIRE(hitsFor(report, "addi-fusion") == 1);
+  REQUIRE(image.wordAt(0) == 0x7d008293); // addi x5, x1, 2000
+
+  report = optimized("addi x5, x1, 1000\n"
+                     "addi x5, x5, 2000\n"
+                     "ecall\n");
+  REQUIRE(hitsFor(report, "addi-fusion") == 0);
+
+  report = optimized("addi x5, x1, 1\n"
+                     "again: addi x5, x5, 1\n"
+                     "bne x5, x6, again\n");
+  REQUIRE(hitsFor(report, "addi-fusion") == 0);
+}
+
+TEST_CASE("A far call still gets there once what's between has gone", "[Peephole]")
+{
+  string nops;
+  for (int i = 0; i < 300000; i++) nops += "nop\n";
+  const auto report = optimized("call far\n"
+                                "addi x6, x0, 3\n"
+                                "ecall\n" +
+                                nops +
+                                "far: addi x5, x0, 9\n"
+                                "ret\n");
+
+  REQUIRE(report.instructionsAfter == 7);
+  REQUIRE(labels.lookup("far")->instructionIndex == 5);
+
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  REQUIRE(s.x[5] == 9);
+  REQUIRE(s.x[6] == 3);
+}
+
+TEST_CASE("An auipc that might be taking an address leaves everything alone", "[Peephole]")
+{
+  assembleSource("auipc x5, 0\n"
+                 "mv x6, x6\n");
+  const auto before = image.bytes;
+
+  REQUIRE_FALSE(optimizeImage(image, labels));
+  REQUIRE(image.bytes == before);
+}
+
+TEST_CASE("Relocations move with their instructions", "[Peephole]")
+{
+  optimized("nop\n"
+            "nop\n"
+            "call printf\n",
+            Format::elf);
+
+  REQUIRE(image.relocations.size() == 1);
+  REQUIRE(image.relocations[0].offset == 4);
+  REQUIRE(image.wordAt(4) == 0x000000ef);
+}
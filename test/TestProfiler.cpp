@@ -0,0 +1,81 @@
+#include "Assemble.hpp"
+#include "Profiler.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+
+using namespace std;
+using namespace DcsEmbler;
+
+static const char* loopWithCall =
+  "__begin:\n"
+  "    addi x10, x0, 0\n"
+  "    addi x11, x0, 10\n"
+  "loop:\n"
+  "    addi x10, x10, 1\n"
+  "    jal x1, helper\n"
+  "    blt x10, x11, loop\n"
+  "    ecall\n"
+  "helper:\n"
+  "    addi x12, x12, 3\n"
+  "    jalr x0, 0(x1)\n";
+
+TEST_CASE("Simulator runs an assembled program to its ecall", "[Profiler]")
+{
+  assembleSource(loopWithCall);
+  Simulator s{ image, 0 };
+
+  optional<StopReason> stop;
+  for (int i = 0; i < 1000 and not stop; i++) {
+    stop = s.step().stop;
+  }
+
+  REQUIRE(stop == StopReason::ecall);
+  REQUIRE(s.x[10] == 10);
+  REQUIRE(s.x[12] == 30);
+}
+
+TEST_CASE("Profiler attributes instructions to the preceding label", "[Profiler]")
+{
+  assembleSource(loopWithCall);
+  Simulator s{ image, 0 };
+  Profiler p{ labels };
+
+  REQUIRE(p.run(s, 1000) == StopReason::ecall);
+
+  REQUIRE(p.flat[p.symbolFor(0)].instructions == 2);  // __begin
+  REQUIRE(p.flat[p.symbolFor(8)].instructions == 31); // loop, including the ecall
+  REQUIRE(p.flat[p.symbolFor(24)].instructions == 20); // helper
+}
+
+TEST_CASE("Profiler symbol lookup picks the nearest label at or before an address",
+          "[Profiler]")
+{
+  LabelSet l{};
+  l["a"] = Label{ 0, 1 };
+  l["b"] = Label{ 4, 5 };
+  Profiler p{ l };
+
+  REQUIRE(string{ p.symbolName(p.symbolFor(0)) } == "a");
+  REQUIRE(string{ p.symbolName(p.symbolFor(12)) } == "a");
+  REQUIRE(string{ p.symbolName(p.symbolFor(16)) } == "b");
+  REQUIRE(string{ p.symbolName(p.symbolFor(4000)) } == "b");
+}
+
+TEST_CASE("Collapsed stacks follow calls and returns", "[Profiler]")
+{
+  assembleSource(loopWithCall);
+  Simulator s{ image, 0 };
+  Profiler p{ labels };
+  p.run(s, 1000);
+
+  FILE* f = tmpfile();
+  p.writeCollapsedStacks(f);
+  rewind(f);
+  char buffer[1024] = {};
+  fread(buffer, 1, sizeof(buffer) - 1, f);
+  fclose(f);
+
+  string stacks{ buffer };
+  REQUIRE(stacks.find("__begin;loop ") != string::npos);
+  REQUIRE(stacks.find("__begin;helper ") != string::npos);
+}
@@ -0,0 +1,133 @@
+#include "Assemble.hpp"
+#include "MappedOutput.hpp"
+#include "Relaxation.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto nops(int count) -> string {
+  string lines;
+  for (int i = 0; i < count; i++) lines += "nop\n";
+  return lines;
+}
+
+/// The byte offset a B-type instruction branches by.
+static auto branchOffset(uint32_t instruction) -> int32_t {
+  const uint32_t imm = ((instruction >> 31) & 0x1) << 12 | ((instruction >> 7) & 0x1) << 11
+                     | ((instruction >> 25) & 0x3f) << 5 | ((instruction >> 8) & 0xf) << 1;
+  return (int32_t) (imm << 19) >> 19;
+}
+
+/// The byte offset a J-type instruction jumps by.
+static auto jalOffset(uint32_t instruction) -> int32_t {
+  const uint32_t imm = ((instruction >> 31) & 0x1) << 20 | ((instruction >> 12) & 0xff) << 12
+                     | ((instruction >> 20) & 0x1) << 11 | ((instruction >> 21) & 0x3ff) << 1;
+  return (int32_t) (imm << 11) >> 11;
+}
+
+static auto funct3(uint32_t instruction) -> uint32_t { return (instruction >> 12) & 0x7; }
+
+TEST_CASE("A branch that reaches is left alone", "[Relaxation]")
+{
+  assembleSource("beq x1, x2, near\n" + nops(1000) + "near: ecall\n");
+
+  REQUIRE(relaxedSites.empty());
+  REQUIRE(image.size() == 1002 * 4);
+  REQUIRE(branchOffset(image.wordAt(0)) == 1001 * 4);
+}
+
+TEST_CASE("A branch too far forward becomes the opposite branch over a jal", "[Relaxation]")
+{
+  assembleSource("beq x1, x2, far\n" + nops(1100) + "far: ecall\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 0 });
+  REQUIRE(image.size() == 1103 * 4);
+  REQUIRE(labels.lookup("far")->instructionIndex == 1102);
+
+  const auto skip = image.wordAt(0);
+  REQUIRE(funct3(skip) == 0b001); // bne
+  REQUIRE(branchOffset(skip) == 8);
+
+  const auto jal = image.wordAt(4);
+  REQUIRE((jal & 0xfff) == 0b1101111); // jal x0
+  REQUIRE(jalOffset(jal) == 1101 * 4);
+}
+
+TEST_CASE("A branch too far back is relaxed too", "[Relaxation]")
+{
+  assembleSource("top: nop\n" + nops(1100) + "bltu x1, x2, top\necall\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 1101 });
+  REQUIRE(funct3(image.wordAt(1101 * 4)) == 0b111); // bgeu
+  REQUIRE(jalOffset(image.wordAt(1102 * 4)) == -1102 * 4);
+}
+
+TEST_CASE("Relaxing one branch can push another out of reach", "[Relaxation]")
+{
+  // `end` starts off exactly as far as a branch can go, until the branch to `far` grows.
+  assembleSource("beq x1, x2, end\n"
+                 "bne x3, x4, far\n" +
+                 nops(1021) +
+                 "end: ecall\n" +
+                 nops(1100) +
+                 "far: ecall\n");
+
+  REQUIRE(relaxedSites == vector<int>{ 0, 2 });
+  REQUIRE(labels.lookup("end")->instructionIndex == 1025);
+  REQUIRE(jalOffset(image.wordAt(4)) == 1024 * 4);
+  REQUIRE(image.size() == (1025 + 1 + 1100 + 1) * 4);
+}
+
+TEST_CASE("Relaxed branches still go where they should", "[Relaxation]")
+{
+  for (const char* branch : { "beq", "bne" }) {
+    assembleSource(string{ "addi x1, x0, 1\n" } + branch + " x1, x0, far\n"
+                   "addi x5, x0, 7\n"
+                   "ecall\n" +
+                   nops(1100) +
+                   "far: addi x5, x0, 9\n"
+                   "ecall\n");
+
+    Simulator s{ image, 0 };
+    optional<StopReason> stop;
+    while (not stop) stop = s.step().stop;
+
+    INFO(branch);
+    REQUIRE(*stop == StopReason::ecall);
+    REQUIRE(s.x[5] == (string{ branch } == "bne" ? 9u : 7u));
+  }
+}
+
+TEST_CASE("Relaxation moves the parallel emit pass's checkpoints too", "[Relaxation]")
+{
+  const string source = "beq x1, x2, far\n" + nops(3 * linesPerCheckpoint) + "far: ecall\n";
+
+  assembleSource(source);
+  const auto serial = image.bytes;
+
+  resetAssembler();
+  vector<Checkpoint> checkpoints;
+  string labelPassText = source;
+  instructionIndex = 0;
+  forEachLine(labelPassText.data(), labelPassText.size(), [&](char* line, int lineNumber) {
+    if ((lineNumber - 1) % linesPerCheckpoint == 0) {
+      checkpoints.push_back({ (size_t) (line - labelPassText.data()), lineNumber, instructionIndex });
+    }
+    huntForLabels(firstToken(line), lineNumber);
+  });
+  const int count = instructionIndex + relaxSites(checkpoints);
+
+  image.clear();
+  image.bytes.resize((size_t) count * 4);
+  vector<uint8_t> output((size_t) count * 4);
+  mappedOut = output.data();
+  string text = source;
+  emitInParallel(text.data(), text.size(), checkpoints, 4);
+  mappedOut = nullptr;
+
+  REQUIRE(image.bytes == serial);
+}
@@ -0,0 +1,173 @@
+#include "Assemble.hpp"
+#include "Corpus.hpp"
+#include "Scheduler.hpp"
+#include "Simulator.hpp"
+#include "catch2.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static auto program() -> vector<DecodedInstruction> {
+  vector<DecodedInstruction> decoded;
+  for (size_t at = 0; at < image.size(); at += 4) decoded.push_back(decode(image.wordAt(at)));
+  return decoded;
+}
+
+static auto stalls(const Latencies& latencies = {}) -> int {
+  const auto decoded = program();
+  return countStalls(decoded.data(), decoded.size(), latencies);
+}
+
+static auto words() -> vector<uint32_t> {
+  vector<uint32_t> all;
+  for (size_t at = 0; at < image.size(); at += 4) all.push_back(image.wordAt(at));
+  return all;
+}
+
+static auto runToEcall() -> Simulator {
+  Simulator s{ image, 0 };
+  optional<StopReason> stop;
+  while (not stop) stop = s.step().stop;
+  REQUIRE(*stop == StopReason::ecall);
+  return s;
+}
+
+TEST_CASE("A load's result used straight away stalls for its delay slots", "[Scheduler]")
+{
+  assembleSource("lw x5, 0(x2)\n"
+                 "add x6, x5, x5\n");
+  REQUIRE(stalls() == 1);
+  REQUIRE(stalls({ .load = 3 }) == 2);
+  REQUIRE(stalls({ .load = 1 }) == 0);
+
+  // A branch wants its operands a cycle early, as asked.
+  assembleSource("addi x5, x0, 1\n"
+                 "bne x5, x0, 8\n");
+  REQUIRE(stalls() == 0);
+  REQUIRE(stalls({ .branch = 1 }) == 1);
+}
+
+TEST_CASE("Something independent fills a load delay slot", "[Scheduler]")
+{
+  const string source = "addi x2, x0, 256\n"
+                        "addi x9, x0, 40\n"
+                        "sw x9, 0(x2)\n"
+                        "lw x5, 0(x2)\n"
+                        "add x6, x5, x5\n"
+                        "addi x7, x0, 1\n"
+                        "sw x6, 4(x2)\n"
+                        "ecall\n";
+
+  assembleSource(source);
+  const auto before = runToEcall();
+  const auto unscheduled = words();
+
+  const auto report = scheduleImage(image, labels, {});
+  REQUIRE(report.reordered == 1);
+  REQUIRE(report.stallsBefore == 1);
+  REQUIRE(report.stallsAfter == 0);
+  REQUIRE(report.mostImproved.size() == 1);
+  REQUIRE(report.mostImproved[0].offset == 0);
+  REQUIRE(stalls() == 0);
+
+  // The addi went between the load and its use, and nothing else moved.
+  const auto scheduled = words();
+  REQUIRE(scheduled[4] == unscheduled[5]);
+  REQUIRE(scheduled[5] == unscheduled[4]);
+  REQUIRE(equal(scheduled.begin(), scheduled.begin() + 4, unscheduled.begin()));
+
+  const auto after = runToEcall();
+  REQUIRE(after.x == before.x);
+  REQUIRE(after.x[6] == 80);
+}
+
+TEST_CASE("Loads and stores keep their order", "[Scheduler]")
+{
+  assembleSource("sw x7, 0(x2)\n"
+                 "lw x5, 4(x2)\n"
+                 "add x6, x5, x5\n"
+                 "lw x8, 8(x2)\n");
+  const auto unscheduled = words();
+
+  REQUIRE(scheduleImage(image, labels, {}).stallsAfter == 0);
+  const auto scheduled = words();
+  REQUIRE(scheduled == vector<uint32_t>{ unscheduled[0], unscheduled[1], unscheduled[3], unscheduled[2] });
+}
+
+TEST_CASE("Nothing moves past what it depends on, a label, or the branch ending its block", "[Scheduler]")
+{
+  // The addi would fill the slot, but it writes what the add reads.
+  assembleSource("lw x5, 0(x2)\n"
+                 "add x6, x5, x5\n"
+                 "addi x5, x0, 1\n");
+  auto unscheduled = words();
+  auto report = scheduleImage(image, labels, {});
+  REQUIRE(report.reordered == 0);
+  REQUIRE(report.stallsAfter == 1);
+  REQUIRE(words() == unscheduled);
+
+  // Something else could jump to the add.
+  assembleSource("lw x5, 0(x2)\n"
+                 "there: add x6, x5, x5\n"
+                 "addi x7, x0, 1\n");
+  unscheduled = words();
+  report = scheduleImage(image, labels, {});
+  REQUIRE(report.blocks == 2);
+  REQUIRE(words() == unscheduled);
+
+  // Branch latency: the independent addi goes first, and the branch stays last.
+  assembleSource("addi x6, x0, 2\n"
+                 "addi x5, x0, 1\n"
+                 "bne x5, x0, out\n"
+                 "addi x7, x0, 3\n"
+                 "out: ecall\n");
+  unscheduled = words();
+  report = scheduleImage(image, labels, { .branch = 1 });
+  REQUIRE(report.stallsBefore == 1);
+  REQUIRE(report.stallsAfter == 0);
+  REQUIRE(words() == vector<uint32_t>{ unscheduled[1], unscheduled[0], unscheduled[2], unscheduled[3], unscheduled[4] });
+}
+
+TEST_CASE("Latency files are name = cycles lines", "[Scheduler]")
+{
+  const auto latencies = parseLatencies("# The DCS core, as of the last synthesis\n"
+                                        "load = 3\n"
+                                        "\n"
+                                        "  branch=1   # no forwarding into the comparator\n",
+                                        "test.lat");
+  REQUIRE(latencies);
+  REQUIRE(latencies->load == 3);
+  REQUIRE(latencies->branch == 1);
+  REQUIRE(latencies->alu == 1);
+
+  REQUIRE_FALSE(parseLatencies("store = 3\n", "test.lat"));
+  REQUIRE_FALSE(parseLatencies("load = three\n", "test.lat"));
+  REQUIRE_FALSE(parseLatencies("load 3\n", "test.lat"));
+  REQUIRE_FALSE(parseLatencies("load = -1\n", "test.lat"));
+}
+
+TEST_CASE("Scheduling generated code only ever takes stalls away", "[Scheduler]")
+{
+  CorpusSpec spec{};
+  spec.lines = 20000;
+  assembleSource(generateCorpus(spec));
+  auto unscheduled = words();
+  const auto before = stalls({ .load = 3, .branch = 1 });
+
+  const auto report = scheduleImage(image, labels, { .load = 3, .branch = 1 });
+  REQUIRE(report.stallsAfter < report.stallsBefore);
+  REQUIRE(report.reordered > 0);
+  // Blocks are counted from scratch, but run straight through the program stalls less too.
+  REQUIRE(stalls({ .load = 3, .branch = 1 }) < before);
+  REQUIRE(report.mostImproved.size() == mostImprovedBlocks);
+
+  // The same instructions, just in a different order.
+  auto scheduled = words();
+  REQUIRE(scheduled != unscheduled);
+  sort(scheduled.begin(), scheduled.end());
+  sort(unscheduled.begin(), unscheduled.end());
+  REQUIRE(scheduled == unscheduled);
+}
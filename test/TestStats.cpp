@@ -0,0 +1,61 @@
+#include "Stats.hpp"
+#include "catch2.hpp"
+
+using namespace std;
+using namespace DcsEmbler;
+
+TEST_CASE("Phase timers do nothing when stats are off", "[Stats]")
+{
+  stats = Stats{};
+  {
+    PhaseTimer t{ Phase::emitPass };
+  }
+  REQUIRE(stats.phases[(size_t)Phase::emitPass].wallSeconds == 0);
+}
+
+TEST_CASE("Phase timers add up time when stats are on", "[Stats]")
+{
+  stats = Stats{ .enabled = true };
+  {
+    PhaseTimer t{ Phase::read };
+    volatile int spin = 0;
+    for (int i = 0; i < 100000; i++) spin = spin + i;
+  }
+  REQUIRE(stats.phases[(size_t)Phase::read].wallSeconds > 0);
+  stats = Stats{};
+}
+
+TEST_CASE("Mnemonics are counted by name", "[Stats]")
+{
+  Stats s{};
+  s.countMnemonic("addi");
+  s.countMnemonic("addi");
+  s.countMnemonic("mv");
+  REQUIRE(s.mnemonics["addi"] == 2);
+  REQUIRE(s.mnemonics["mv"] == 1);
+}
+
+TEST_CASE("Label table shape accounts for every label", "[Stats]")
+{
+  LabelSet l{};
+  for (int i = 0; i < 100; i++) l["label" + to_string(i)] = Label{ i, i };
+
+  const auto shape = labelTableShape(l);
+  REQUIRE(shape.labels == 100);
+  REQUIRE(shape.buckets == l.bucket_count());
+  REQUIRE(shape.meanProbeLength >= 1.0);
+  REQUIRE(shape.maxProbeLength >= 1);
+}
+
+TEST_CASE("Perf counters read as zero where they can't be opened", "[Stats]")
+{
+  PerfCounters counters{};
+  counters.open();
+
+  const auto values = counters.read();
+  for (size_t i = 0; i < counterCount; i++) {
+    if (not counters.available((Counter)i)) REQUIRE(values[i] == 0);
+  }
+  counters.close();
+  REQUIRE(not counters.anyAvailable());
+}
@@ -0,0 +1,114 @@
+#include "Assemble.hpp"
+#include "SymbolMap.hpp"
+#include "catch2.hpp"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace DcsEmbler;
+
+static const char* source =
+  "_start:\n"
+  "    addi x1, x0, 5\n"
+  "loop:\n"
+  "again:\n"
+  "    addi x1, x1, -1\n"
+  "    bne x1, x0, loop\n"
+  "done: ecall\n"
+  "end:\n";
+
+TEST_CASE("Symbols come out sorted by address, then by line", "[SymbolMap]")
+{
+  assembleSource(source);
+  const auto symbols = sortedSymbols(labels, (uint32_t) image.size());
+
+  REQUIRE(symbols.size() == 5);
+  REQUIRE(symbols[0].name == "_start");
+  REQUIRE(symbols[1].name == "loop");
+  REQUIRE(symbols[2].name == "again");
+  REQUIRE(symbols[3].name == "done");
+  REQUIRE(symbols[4].name == "end");
+
+  REQUIRE(symbols[0].address == 0);
+  REQUIRE(symbols[0].size == 4);
+  REQUIRE(symbols[1].address == 4);
+  REQUIRE(symbols[1].size == 8);
+  REQUIRE(symbols[2].size == 8);
+  REQUIRE(symbols[3].address == 12);
+  REQUIRE(symbols[3].size == 4);
+  REQUIRE(symbols[4].address == 16);
+  REQUIRE(symbols[4].size == 0);
+}
+
+TEST_CASE("Radix sorting agrees with a comparison sort on many labels", "[SymbolMap]")
+{
+  // Labels declared out of address order can't happen in one file, so make them up.
+  LabelSet many{};
+  for (int i = 0; i < 5000; i++) {
+    const int index = (i * 7919) % 5000;
+    many.insert_or_assign("L" + to_string(i), Label{ index / 2, i + 1 });
+  }
+
+  const auto symbols = sortedSymbols(many, 20000);
+  REQUIRE(symbols.size() == many.size());
+  for (size_t i = 1; i < symbols.size(); i++) {
+    const auto& a = symbols[i - 1];
+    const auto& b = symbols[i];
+    REQUIRE((a.address < b.address or (a.address == b.address and a.line < b.line)));
+  }
+}
+
+TEST_CASE("The text map has a line per symbol", "[SymbolMap]")
+{
+  assembleSource(source);
+  const auto symbols = sortedSymbols(labels, (uint32_t) image.size());
+
+  FILE* f = tmpfile();
+  REQUIRE(writeMapText(f, symbols));
+  string written(ftell(f), '\0');
+  rewind(f);
+  REQUIRE(fread(written.data(), 1, written.size(), f) == written.size());
+  fclose(f);
+
+  REQUIRE(written == "# address  size      line    name\n"
+                     "00000000  00000004       1  _start\n"
+                     "00000004  00000008       3  loop\n"
+                     "00000004  00000008       4  again\n"
+                     "0000000C  00000004       7  done\n"
+                     "00000010  00000000       8  end\n");
+}
+
+TEST_CASE("The map index finds the symbol an address is in", "[SymbolMap]")
+{
+  assembleSource(source);
+  vector<uint8_t> bytes;
+  buildMapIndex(sortedSymbols(labels, (uint32_t) image.size()), bytes);
+
+  SymbolMap map{};
+  REQUIRE(map.openFrom({ (const char*) bytes.data(), bytes.size() }, "test.map.idx"));
+  REQUIRE(map.symbolCount() == 5);
+
+  REQUIRE(map.find(0)->name == "_start");
+  REQUIRE(map.find(3)->name == "_start");
+  // Two labels on the same instruction - the later one wins.
+  REQUIRE(map.find(4)->name == "again");
+  REQUIRE(map.find(11)->name == "again");
+  REQUIRE(map.find(12)->name == "done");
+  REQUIRE(map.find(16)->name == "end");
+  REQUIRE_FALSE(map.find(17));
+  REQUIRE(map.find(12)->line == 7);
+}
+
+TEST_CASE("A map index that isn't one is refused", "[SymbolMap]")
+{
+  vector<uint8_t> bytes;
+  buildMapIndex({}, bytes);
+
+  SymbolMap empty{};
+  REQUIRE(empty.openFrom({ (const char*) bytes.data(), bytes.size() }, "empty.idx"));
+  REQUIRE_FALSE(empty.find(0));
+
+  bytes[0] = 'x';
+  SymbolMap broken{};
+  REQUIRE_FALSE(broken.openFrom({ (const char*) bytes.data(), bytes.size() }, "broken.idx"));
+}
@@ -0,0 +1,37 @@
+#define CATCH_CONFIG_RUNNER // We bring our own main, to take the corpus options.
+
+#include "Bench.hpp"
+#include "catch2.hpp"
+
+DcsEmbler::CorpusSpec benchCorpus{};
+
+auto main(int argc, char** argv) -> int {
+    Catch::Session session;
+
+    int lines = (int) benchCorpus.lines;
+    string mix{};
+    string size{};
+    int seed = (int) benchCorpus.seed;
+
+    using namespace Catch::clara;
+    session.cli(session.cli()
+        | Opt(lines, "lines")["--corpus-lines"]("instruction lines in the synthetic corpus")
+        | Opt(size, "bytes")["--corpus-size"]("size of the synthetic corpus instead, e.g. 64M")
+        | Opt(mix, "mnemonic=weight,...")["--corpus-mix"]("mnemonic mix of the synthetic corpus")
+        | Opt(seed, "seed")["--corpus-seed"]("seed for the synthetic corpus"));
+
+    if (int error = session.applyCommandLine(argc, argv); error != 0) {
+        return error;
+    }
+
+    benchCorpus.lines = lines;
+    benchCorpus.seed = seed;
+    if (not size.empty()) {
+        benchCorpus.bytes = DcsEmbler::parseByteSize(size);
+    }
+    if (not mix.empty()) {
+        benchCorpus.mix = DcsEmbler::parseMnemonicMix(mix);
+    }
+
+    return session.run();
+}
@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Archive.hpp"
+
+#include "structopt/structopt.hpp"
+
+using namespace std;
+
+/// Bundles dcsembler objects (`-f elf`) into an archive with a symbol index, for dcs-ld.
+/// e.g. `dcs-ar libmaths.a mul.o div.o sqrt.o`, or `dcs-ar --list libmaths.a`
+struct ArchiverOptions {
+    string archiveFileName{};
+    vector<string> objectFileNames{};
+
+    /// Print the archive's members and symbol index instead of making one.
+    optional<bool> list = false;
+};
+
+STRUCTOPT(ArchiverOptions, archiveFileName, objectFileNames, list);
+
+auto main(int argc, char** argv) -> int {
+    using namespace DcsEmbler;
+
+    auto app = structopt::app("dcs-ar", "0.0.1");
+    ArchiverOptions options;
+    try {
+        options = app.parse<ArchiverOptions>(argc, argv);
+    } catch (structopt::exception& e) {
+        cout << e.what();
+        cout << " Usage: ";
+        cout << app.help();
+        return EXIT_FAILURE;
+    }
+
+    if (*options.list) {
+        Archive archive{};
+        if (not archive.open(options.archiveFileName)) return EXIT_FAILURE;
+
+        printf("Members:\n");
+        for (size_t i = 0; i < archive.memberCount(); i++) {
+            const auto name = archive.memberName(i);
+            printf("  %.*s\n", (int) name.size(), name.data());
+        }
+        printf("Symbols:\n");
+        for (size_t i = 0; i < archive.symbolCount(); i++) {
+            const auto name = archive.symbolName(i);
+            const auto member = archive.memberName(archive.symbolMember(i));
+            printf("  %-32.*s %.*s\n", (int) name.size(), name.data(), (int) member.size(), member.data());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    vector<ArchiveMember> members{};
+    for (const auto& fileName : options.objectFileNames) {
+        ArchiveMember member{filesystem::path{fileName}.filename().string(), readFileToString(fileName)};
+        if (member.contents.empty()) {
+            cerr << " [Error]: Failed to read '" << fileName << "'.\n";
+            return EXIT_FAILURE;
+        }
+        members.push_back(move(member));
+    }
+
+    vector<uint8_t> archive{};
+    if (not buildArchive(members, archive)) return EXIT_FAILURE;
+
+    FILE* out = fopen(options.archiveFileName.c_str(), "w");
+    if (not out) {
+        cerr << " [Error]: Failed to open output file. Path attempted: '" << options.archiveFileName << "'\n";
+        return EXIT_FAILURE;
+    }
+    const bool written = fwrite(archive.data(), 1, archive.size(), out) == archive.size();
+    if (fclose(out) != 0 or not written) {
+        cerr << " [Error]: Failed to write the archive out.\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
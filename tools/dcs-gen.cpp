@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "Corpus.hpp"
+
+#include "structopt/structopt.hpp"
+
+using namespace std;
+
+/// Writes seeded, valid dcsembler sources, from a kilobyte up to as big as the disk allows.
+/// e.g. `dcs-gen --size 1G --seed 7 --commentRatio 0.1 -o big.S`
+struct GeneratorOptions {
+    /// Written to stdout if not given.
+    optional<string> outputFileName{};
+
+    /// Number of instruction lines.
+    optional<unsigned long long> lines = 10000;
+    /// Approximate output size instead of a line count, e.g. 64K, 10M, 10G.
+    optional<string> size{};
+    optional<unsigned long long> seed = 1;
+
+    /// e.g. addi=4,lw=1,beq=1
+    optional<string> mix{};
+
+    optional<double> labelDensity = 1.0 / 16;
+    optional<double> forwardBranchRatio = 0.5;
+    optional<double> meanBranchDistance = 16;
+    optional<double> meanJumpDistance = 256;
+    optional<double> commentRatio = 0.0;
+    optional<double> directiveRatio = 0.0;
+};
+
+STRUCTOPT(GeneratorOptions, outputFileName, lines, size, seed, mix, labelDensity, forwardBranchRatio,
+          meanBranchDistance, meanJumpDistance, commentRatio, directiveRatio);
+
+auto main(int argc, char** argv) -> int {
+    using namespace DcsEmbler;
+
+    auto app = structopt::app("dcs-gen", "0.0.1");
+    GeneratorOptions options;
+    try {
+        options = app.parse<GeneratorOptions>(argc, argv);
+    } catch (structopt::exception& e) {
+        cout << e.what();
+        cout << " Usage: ";
+        cout << app.help();
+        return EXIT_FAILURE;
+    }
+
+    CorpusSpec spec{};
+    spec.lines = *options.lines;
+    spec.bytes = options.size ? parseByteSize(*options.size) : 0;
+    spec.seed = *options.seed;
+    if (options.mix) spec.mix = parseMnemonicMix(*options.mix);
+    spec.labelDensity = *options.labelDensity;
+    spec.forwardBranchRatio = *options.forwardBranchRatio;
+    spec.meanBranchDistance = *options.meanBranchDistance;
+    spec.meanJumpDistance = *options.meanJumpDistance;
+    spec.commentRatio = *options.commentRatio;
+    spec.directiveRatio = *options.directiveRatio;
+
+    FILE* f = stdout;
+    if (options.outputFileName) {
+        f = fopen(options.outputFileName->c_str(), "w");
+        if (not f) {
+            cerr << " [Error]: Failed to open output file. Path attempted: '" << *options.outputFileName << "'\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    static char buffer[1 << 20];
+    setvbuf(f, buffer, _IOFBF, sizeof(buffer));
+
+    generateCorpus(spec, f);
+
+    if (fclose(f) != 0) {
+        cerr << " [Error]: Failed to write the corpus out.\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Archive.hpp"
+#include "Elf.hpp"
+#include "Linker.hpp"
+#include "Options.hpp"
+#include "Packing.hpp"
+#include "Parallel.hpp"
+
+#include "structopt/structopt.hpp"
+
+using namespace std;
+
+/// Links dcsembler objects (`-f elf`) into one program, pulling in whatever it needs from dcs-ar
+/// archives given alongside them.
+/// e.g. `dcs-ld -s 0x20000 -o firmware.elf main.o uart.o libmaths.a`
+struct LinkerOptions {
+    /// Objects and archives.
+    vector<string> inputFileNames{};
+
+    optional<string> outputFileName{"a.out"};
+    /// binary, hex or executable.
+    optional<DcsEmbler::Format> format = DcsEmbler::Format::executable;
+    /// Where the first object's text goes, in bytes.
+    optional<int> startOfMemory = 0;
+    /// For executables - `_start` or `__begin` if not given.
+    optional<string> entry{};
+    /// 0 is one per hardware thread.
+    optional<int> jobs = 0;
+    /// How binary output is packed into memory words, as for dcsembler.
+    optional<int> wordWidth = 32;
+    optional<DcsEmbler::Endianness> byteOrder = DcsEmbler::Endianness::little;
+};
+
+STRUCTOPT(LinkerOptions, inputFileNames, outputFileName, format, startOfMemory, entry, jobs, wordWidth, byteOrder);
+
+auto main(int argc, char** argv) -> int {
+    using namespace DcsEmbler;
+
+    auto app = structopt::app("dcs-ld", "0.0.1");
+    LinkerOptions options;
+    try {
+        options = app.parse<LinkerOptions>(argc, argv);
+    } catch (structopt::exception& e) {
+        cout << e.what();
+        cout << " Usage: ";
+        cout << app.help();
+        return EXIT_FAILURE;
+    }
+
+    const auto format = *options.format;
+    if (format != Format::binary and format != Format::bin and format != Format::hex
+        and format != Format::hexadecimal and format != Format::executable) {
+        cerr << " [Error]: dcs-ld writes binary, hex or executable output.\n";
+        return EXIT_FAILURE;
+    }
+    const Packing packing{(unsigned) *options.wordWidth / 8, *options.byteOrder};
+    if ((format == Format::binary or format == Format::bin) and not checkPacking(packing)) return EXIT_FAILURE;
+
+    const auto& names = options.inputFileNames;
+    const unsigned jobs = (unsigned) *options.jobs;
+    const auto base = (uint32_t) *options.startOfMemory;
+
+    // Archives are told apart by their magic, and only mapped in - members are read as they're needed.
+    vector<string> objectNames{};
+    vector<unique_ptr<Archive>> archives{};
+    for (const auto& name : names) {
+        char magic[sizeof(archiveMagic)] = {};
+        if (FILE* f = fopen(name.c_str(), "r")) {
+            fread(magic, 1, sizeof(magic), f);
+            fclose(f);
+        }
+        if (isArchive(string_view{magic, sizeof(magic)})) {
+            archives.push_back(make_unique<Archive>());
+            if (not archives.back()->open(name)) return EXIT_FAILURE;
+        } else {
+            objectNames.push_back(name);
+        }
+    }
+
+    vector<ObjectFile> objects(objectNames.size());
+    atomic<bool> readAll{true};
+    parallelFor(objectNames.size(), jobs, [&](size_t i) {
+        if (not readObjectFile(objectNames[i], objects[i])) readAll = false;
+    });
+    if (not readAll) return EXIT_FAILURE;
+
+    if (not pullArchiveMembers(objects, archives)) return EXIT_FAILURE;
+
+    Image image{};
+    ConcurrentSymbolTable globals{};
+    if (not link(objects, base, jobs, image, globals)) return EXIT_FAILURE;
+
+    FILE* out = fopen(options.outputFileName->c_str(), "w");
+    if (not out) {
+        cerr << " [Error]: Failed to open output file. Path attempted: '" << *options.outputFileName << "'\n";
+        return EXIT_FAILURE;
+    }
+
+    bool written = true;
+    if (format == Format::executable) {
+        // The symbols of the linked program are its globals.
+        LabelSet symbols{};
+        SymbolNames symbolNames{};
+        globals.forEach([&](string_view name, const ConcurrentSymbolTable::Definition& definition) {
+            symbols.emplace(name, Label{(int) definition.offset / 4, 0});
+            symbolNames.emplace(name);
+        });
+
+        const auto entry = entryPointFor(symbols, options.entry, base);
+        if (not entry) {
+            cerr << " [Error]: No entry symbol '" << *options.entry << "'.\n";
+            return EXIT_FAILURE;
+        }
+        written = writeExecutableElf(fileno(out), image, symbols, base, *entry, symbolNames);
+    } else if (format == Format::hex or format == Format::hexadecimal) {
+        written = writeHexLines(out, image);
+    } else {
+        written = writePacked(out, image, packing);
+    }
+
+    if (fclose(out) != 0 or not written) {
+        cerr << " [Error]: Failed to write the output file. Path attempted: '" << *options.outputFileName << "'\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}